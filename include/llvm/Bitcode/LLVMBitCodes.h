@@ -52,7 +52,12 @@ enum BlockIDs {
 
   OPERAND_BUNDLE_TAGS_BLOCK_ID,
 
-  METADATA_KIND_BLOCK_ID
+  METADATA_KIND_BLOCK_ID,
+
+  // Top-level block holding the symbol table of the module that follows it,
+  // see llvm/Object/IRSymtab.h. Numbered well clear of the IDs that follow
+  // METADATA_KIND_BLOCK_ID elsewhere (STRTAB_BLOCK_ID is 23, for example).
+  SYMTAB_BLOCK_ID = 64
 };
 
 /// Identification block contains a string that describes the producer details,
@@ -533,6 +538,10 @@ enum ComdatSelectionKindCodes {
   COMDAT_SELECTION_KIND_SAME_SIZE = 5,
 };
 
+enum SymtabCodes {
+  SYMTAB_BLOB = 1, // BLOB: [blob]
+};
+
 } // End bitc namespace
 } // End llvm namespace
 
@@ -23,6 +23,7 @@
 #include <string>
 
 namespace llvm {
+  class BitstreamCursor;
   class BitstreamWriter;
   class DataStreamer;
   class LLVMContext;
@@ -99,10 +100,15 @@ namespace llvm {
   ///
   /// \p GenerateHash enables hashing the Module and including the hash in the
   /// bitcode (currently for use in ThinLTO incremental build).
+  ///
+  /// \p GenerateSymtab emits a symbol table in front of the module, so that
+  /// tools such as llvm-nm and llvm-ar can read the module's symbols without
+  /// loading it. It is meant for bitcode used as an object file.
   void WriteBitcodeToFile(const Module *M, raw_ostream &Out,
                           bool ShouldPreserveUseListOrder = false,
                           const ModuleSummaryIndex *Index = nullptr,
-                          bool GenerateHash = false);
+                          bool GenerateHash = false,
+                          bool GenerateSymtab = false);
 
   /// Write the specified module summary index to the given raw output stream,
   /// where it will be written in a new bitcode block. This is used when
@@ -150,6 +156,10 @@ namespace llvm {
            isRawBitcode(BufPtr, BufEnd);
   }
 
+  /// hasValidBitcodeHeader - Read the signature common to all bitcode files
+  /// from the start of Stream and return true if it matches.
+  bool hasValidBitcodeHeader(BitstreamCursor &Stream);
+
   /// SkipBitcodeWrapperHeader - Some systems wrap bc files with a special
   /// header for padding or other reasons.  The format of this header is:
   ///
@@ -47,6 +47,12 @@ public:
 
   bool extract();
   void dump(raw_ostream &OS) const;
+
+  /// Append to DIEOffsets the .debug_info offset of every DIE that the table
+  /// lists under Key. Only the bucket that Key hashes to is read. Tables
+  /// that don't use the DJB hash function, or have no DIE offset atom,
+  /// never match.
+  void lookup(StringRef Key, SmallVectorImpl<uint32_t> &DIEOffsets) const;
 };
 
 }
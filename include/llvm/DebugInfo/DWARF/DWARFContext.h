@@ -26,6 +26,8 @@
 
 namespace llvm {
 
+class ThreadPool;
+
 // In place of applying the relocations to the data we've read from disk we use
 // a separate mapping table to the side and checking that at locations in the
 // dwarf where we expect relocated values. This adds a bit of complexity to the
@@ -51,6 +53,7 @@ class DWARFContext : public DIContext {
   std::unique_ptr<DWARFDebugFrame> DebugFrame;
   std::unique_ptr<DWARFDebugFrame> EHFrame;
   std::unique_ptr<DWARFDebugMacro> Macro;
+  bool LazyLineTables = false;
 
   DWARFUnitSection<DWARFCompileUnit> DWOCUs;
   std::deque<DWARFUnitSection<DWARFTypeUnit>> DWOTUs;
@@ -150,6 +153,19 @@ public:
     return DWOCUs[index].get();
   }
 
+  /// Return the compile unit that includes an offset (relative to .debug_info).
+  DWARFCompileUnit *getCompileUnitForOffset(uint32_t Offset);
+
+  /// Return the compile unit which contains instruction with provided
+  /// address.
+  DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
+
+  /// Extract the DIEs of every compile and type unit in this context, including
+  /// the DWO ones, spreading the units over the threads of Pool. Consumers
+  /// that walk every DIE (e.g. llvm-dwarfdump) can call this up front; DIEs
+  /// are otherwise extracted one unit at a time as the units are visited.
+  void extractAllUnitDIEs(ThreadPool &Pool);
+
   const DWARFUnitIndex &getCUIndex();
   DWARFGdbIndex &getGdbIndex();
   const DWARFUnitIndex &getTUIndex();
@@ -181,6 +197,11 @@ public:
   /// Get a pointer to a parsed line table corresponding to a compile unit.
   const DWARFDebugLine::LineTable *getLineTableForUnit(DWARFUnit *cu);
 
+  /// Parse the line tables returned by getLineTableForUnit() lazily, so that
+  /// their Rows are empty and only getRow() and the lookups can be used.
+  /// Must be set before the first line table is parsed.
+  void setLazyLineTables(bool Lazy) { LazyLineTables = Lazy; }
+
   DILineInfo getLineInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) override;
   DILineInfoTable getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
@@ -230,12 +251,6 @@ public:
     return version == 2 || version == 3 || version == 4 || version == 5;
   }
 private:
-  /// Return the compile unit that includes an offset (relative to .debug_info).
-  DWARFCompileUnit *getCompileUnitForOffset(uint32_t Offset);
-
-  /// Return the compile unit which contains instruction with provided
-  /// address.
-  DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
 };
 
 /// DWARFContextInMemory is the simplest possible implementation of a
@@ -14,6 +14,8 @@
 #include "llvm/DebugInfo/DWARF/DWARFRelocMap.h"
 #include "llvm/Support/DataExtractor.h"
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -152,6 +154,8 @@ public:
     uint64_t HighPC;
     unsigned FirstRowIndex;
     unsigned LastRowIndex;
+    // The offset in .debug_line of the first opcode of the sequence.
+    uint32_t ProgramOffset;
     bool Empty;
 
     Sequence();
@@ -188,6 +192,13 @@ public:
     bool lookupAddressRange(uint64_t address, uint64_t size,
                             std::vector<uint32_t> &result) const;
 
+    // Returns the row at the given index, which must be below getNumRows().
+    // The rows of a lazily parsed table are decoded a sequence at a time,
+    // when they are first needed. If they can't be decoded again (which only
+    // happens if the section data changed), a row without a line is returned.
+    Row getRow(uint32_t Index) const;
+    uint32_t getNumRows() const { return NumRows; }
+
     bool hasFileAtIndex(uint64_t FileIndex) const;
 
     // Extracts filename by its index in filename table in prologue.
@@ -209,35 +220,94 @@ public:
     bool parse(DataExtractor debug_line_data, const RelocAddrMap *RMap,
                uint32_t *offset_ptr);
 
+    /// Parse the prologue and find the sequences, but don't keep the rows:
+    /// Rows stays empty and getRow() must be used instead. The line number
+    /// program is already a compact encoding of the rows, so a lookup decodes
+    /// the rows of its sequence from it again, and only a few recently used
+    /// sequences are kept decoded. Lookups on a lazy table may run
+    /// concurrently. debug_line_data and RMap must outlive the table.
+    bool parseLazily(DataExtractor debug_line_data, const RelocAddrMap *RMap,
+                     uint32_t *offset_ptr);
+
+    bool isLazy() const { return Lazy; }
+
     struct Prologue Prologue;
     typedef std::vector<Row> RowVector;
     typedef RowVector::const_iterator RowIter;
     typedef std::vector<Sequence> SequenceVector;
     typedef SequenceVector::const_iterator SequenceIter;
+    // All the rows, unless the table was parsed lazily. Use getRow() to
+    // access the rows of either kind of table.
     RowVector Rows;
     SequenceVector Sequences;
 
   private:
+    bool parseImpl(DataExtractor debug_line_data, const RelocAddrMap *RMap,
+                   uint32_t *offset_ptr, bool Lazy);
     uint32_t findRowInSeq(const DWARFDebugLine::Sequence &seq,
                           uint64_t address) const;
+    // Returns the rows of seq, decoding them if the table is lazy. The rows
+    // stay valid while the returned pointer is held. Returns null if the rows
+    // can't be decoded again.
+    std::shared_ptr<const Row>
+    getSequenceRows(const DWARFDebugLine::Sequence &seq) const;
+
+    enum { MaxDecodedSequences = 8 };
+
+    uint32_t NumRows;
+    bool Lazy;
+    // For lazy tables, what's needed to decode their sequences again.
+    DataExtractor LineData;
+    const RelocAddrMap *RelocMap;
+    uint32_t ProgramEndOffset;
+    // Every sequence in row order, including the invalid ones left out of
+    // Sequences and an unterminated last one, so that each row below NumRows
+    // can be decoded again.
+    SequenceVector RowSequences;
+    // The most recently decoded sequences, oldest first, keyed by their
+    // FirstRowIndex, and the mutex guarding them.
+    mutable std::vector<std::pair<unsigned, std::shared_ptr<const RowVector>>>
+        DecodedSequences;
+    mutable std::mutex DecodedSequencesMutex;
   };
 
   const LineTable *getLineTable(uint32_t offset) const;
+  // Returns the table at offset, parsing it first if needed. Tables are
+  // parsed with all their rows, unless Lazy is set (see parseLazily()); Lazy
+  // only matters when the table is first parsed.
   const LineTable *getOrParseLineTable(DataExtractor debug_line_data,
-                                       uint32_t offset);
+                                       uint32_t offset, bool Lazy = false);
 
 private:
   struct ParsingState {
+    // Parse the program of LT, keeping its rows unless LT is lazy.
     ParsingState(struct LineTable *LT);
+    // Decode one sequence of the lazy table LT again into SeqRows.
+    ParsingState(const struct LineTable *LT, std::vector<struct Row> &SeqRows);
 
     void resetRowAndSequence();
     void appendRowToMatrix(uint32_t offset);
+    // Run the line number program from *offset_ptr up to end_offset, or
+    // only to the end of the first sequence when decoding a sequence again.
+    void run(DataExtractor debug_line_data, const RelocAddrMap *RMap,
+             uint32_t *offset_ptr, uint32_t end_offset);
 
     // Line table we're currently parsing.
-    struct LineTable *LineTable;
+    const struct LineTable *LineTable;
+    // The table that sequences and file names are added to; null when
+    // decoding a sequence again.
+    struct LineTable *Target;
+    // Where rows are appended; null if they are only counted.
+    std::vector<struct Row> *Rows;
+    // Where every terminated sequence is appended, valid or not; may be null.
+    std::vector<struct Sequence> *AllSequences;
     // The row number that starts at zero for the prologue, and increases for
     // each row added to the matrix.
     unsigned RowNumber;
+    // The offset of the first opcode of the current sequence.
+    uint32_t SequenceOffset;
+    // Set when the sequence being decoded again has ended.
+    bool Done;
     struct Row Row;
     struct Sequence Sequence;
   };
@@ -60,6 +60,10 @@ public:
   void dump(raw_ostream &OS);
   void parse(DataExtractor Data);
 
+  /// Append to CUOffsets the .debug_info offset of every CU that the symbol
+  /// table lists as defining Name. Only the hash chain for Name is probed.
+  void lookupSymbol(StringRef Name, SmallVectorImpl<uint64_t> &CUOffsets) const;
+
   bool HasContent = false;
   bool HasError = false;
 };
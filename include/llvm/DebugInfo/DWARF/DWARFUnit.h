@@ -258,6 +258,18 @@ public:
     return it == DieArray.end() ? nullptr : &*it;
   }
 
+  /// \brief Extract the DIE at the given offset, and the chain of DIEs from
+  /// the unit DIE down to it, without extracting the rest of the unit.
+  ///
+  /// Subtrees that can't contain Offset are skipped with DW_AT_sibling where
+  /// the producer emitted it; other DIEs are decoded but not stored. On
+  /// success, Path holds the unit DIE first and the requested DIE last. The
+  /// DIEs in Path are copies: their attributes can be read, but they can't
+  /// be used to navigate to their children or siblings. Returns false if no
+  /// DIE in this unit starts at Offset.
+  bool extractDIEPath(uint32_t Offset,
+                      SmallVectorImpl<DWARFDebugInfoEntryMinimal> &Path) const;
+
   uint32_t getLineTableOffset() const {
     if (IndexEntry)
       if (const auto *Contrib = IndexEntry->getOffset(DW_SECT_LINE))
@@ -12,7 +12,6 @@
 #define LLVM_DEBUGINFO_MSF_MAPPEDBLOCKSTREAM_H
 
 #include "llvm/ADT/ArrayRef.h"
-#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/DebugInfo/MSF/MSFStreamLayout.h"
 #include "llvm/DebugInfo/MSF/StreamInterface.h"
@@ -20,6 +19,7 @@
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
 #include <cstdint>
+#include <map>
 #include <vector>
 
 namespace llvm {
@@ -89,9 +89,18 @@ private:
   const MSFStreamLayout StreamLayout;
   const ReadableStream &MsfData;
 
+  /// For each block of the stream, the index of the first block after it
+  /// which doesn't directly follow its predecessor in the MSF file, so that
+  /// the contiguous extent of any read is found without walking the blocks.
+  std::vector<uint32_t> RunEnds;
+
   typedef MutableArrayRef<uint8_t> CacheEntry;
   mutable llvm::BumpPtrAllocator Pool;
-  mutable DenseMap<uint32_t, std::vector<CacheEntry>> CacheMap;
+  /// Copies of reads which crossed a discontiguity, keyed and ordered by
+  /// stream offset.
+  mutable std::map<uint32_t, std::vector<CacheEntry>> CacheMap;
+  /// The size of the largest copy in CacheMap.
+  mutable uint32_t MaxCachedSize = 0;
 };
 
 class WritableMappedBlockStream : public WritableStream {
@@ -102,8 +102,15 @@ public:
   uint32_t bytesRemaining() const { return getLength() - getOffset(); }
 
 private:
+  bool readFromChunk(ArrayRef<uint8_t> &Buffer, uint32_t Size);
+
   ReadableStreamRef Stream;
   uint32_t Offset;
+  /// The contiguous bytes of Stream last returned by
+  /// readLongestContiguousChunk, starting at ChunkOffset.  Reads that fall
+  /// inside them are served without going through the stream.
+  ArrayRef<uint8_t> Chunk;
+  uint32_t ChunkOffset = 0;
 };
 } // namespace msf
 } // namespace llvm
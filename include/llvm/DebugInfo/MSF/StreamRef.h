@@ -89,7 +89,8 @@ public:
     if (Offset >= Length)
       return make_error<MSFError>(msf_error_code::insufficient_buffer);
 
-    if (auto EC = Stream->readLongestContiguousChunk(Offset, Buffer))
+    if (auto EC = Stream->readLongestContiguousChunk(ViewOffset + Offset,
+                                                     Buffer))
       return EC;
     // This StreamRef might refer to a smaller window over a larger stream.  In
     // that case we will have read out more bytes than we should return, because
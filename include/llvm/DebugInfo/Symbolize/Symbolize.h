@@ -14,8 +14,10 @@
 #define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
+#include "llvm/DebugInfo/Symbolize/SymbolizerIndex.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/ErrorOr.h"
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
@@ -36,6 +38,16 @@ public:
     bool RelativeAddresses : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
+    /// If set, code is symbolized through address indices, which are kept in
+    /// this directory under the build ID of each binary. See SymbolizerIndex.
+    std::string IndexCacheDir;
+    /// Approximate memory budget in bytes for the modules and indices kept
+    /// in memory; the least recently used ones are dropped to stay within
+    /// it. A module is counted as the size of its debug info object. The
+    /// binaries and object files a module was created from are not counted
+    /// separately; they are released along with the last module that uses
+    /// them. Zero means no limit.
+    uint64_t MaxCacheSize = 0;
     Options(FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool UseSymbolTable = true, bool Demangle = true,
             bool RelativeAddresses = false, std::string DefaultArch = "")
@@ -60,6 +72,8 @@ public:
                                   const SymbolizableModule *ModInfo);
 
 private:
+  static std::string DemangleName(const std::string &Name, bool IsWin32Module);
+
   // Bundles together object file with code/data and object file with
   // corresponding debug info. These objects can be the same.
   typedef std::pair<ObjectFile*, ObjectFile*> ObjectPair;
@@ -71,6 +85,26 @@ private:
   Expected<SymbolizableModule *>
   getOrCreateModuleInfo(const std::string &ModuleName);
 
+  /// Returns the address index of a module, reading it from the index cache
+  /// directory or building and writing it there if needed. Returns nullptr
+  /// if the module can't have an index, e.g. because it has no build ID or
+  /// no DWARF; the module itself must be used then.
+  Expected<SymbolizerIndex *> getOrCreateIndex(const std::string &ModuleName);
+
+  struct CacheEntry;
+
+  /// Marks the cached data for a module as most recently used.
+  CacheEntry &touchCacheEntry(const std::string &ModuleName);
+
+  /// Drops the least recently used modules and indices until the cache fits
+  /// in Opts.MaxCacheSize, sparing only the most recently used module, then
+  /// releases the binaries and object files no remaining module uses.
+  void pruneCache();
+
+  /// Drops the cached binaries, object files and object pairs that no module
+  /// in Modules refers to. Indices don't refer to them once built.
+  void releaseUnusedObjects();
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -90,6 +124,22 @@ private:
 
   std::map<std::string, std::unique_ptr<SymbolizableModule>> Modules;
 
+  /// \brief Address indices for module names, or nullptr for modules that
+  /// have none.
+  std::map<std::string, std::unique_ptr<SymbolizerIndex>> Indices;
+
+  /// \brief Memory held for each module name, in Modules and Indices. The
+  /// size of a module is approximated by the size of its debug info object.
+  struct CacheEntry {
+    uint64_t ModuleSize = 0;
+    uint64_t IndexSize = 0;
+    std::list<std::string>::iterator LRUPos;
+  };
+  std::map<std::string, CacheEntry> CacheEntries;
+  /// \brief Module names, most recently used first.
+  std::list<std::string> CacheLRU;
+  uint64_t CacheSize = 0;
+
   /// \brief Contains cached results of getOrCreateObjectPair().
   std::map<std::pair<std::string, std::string>, ObjectPair>
       ObjectPairForPathArch;
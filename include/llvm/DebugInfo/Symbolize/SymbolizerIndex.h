@@ -0,0 +1,98 @@
+//===-- SymbolizerIndex.h --------------------------------------- C++ -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header for the address indices that LLVMSymbolizer caches on disk.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZERINDEX_H
+#define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZERINDEX_H
+
+#include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+namespace object {
+class ObjectFile;
+}
+
+namespace symbolize {
+
+/// An address index for one module: a sorted array of address ranges, each
+/// with the results of symbolizing any address in it.
+///
+/// The index is stored in a flat, position-independent buffer that can be
+/// written to disk and used in place once read back (large files are mapped
+/// rather than copied), so each build of a binary only needs to have its
+/// debug info parsed once. Lookups are a binary search over the ranges.
+class SymbolizerIndex {
+public:
+  /// Build the index for Module, whose debug info is DICtx. The start of
+  /// every line table row is symbolized once through Module, with the given
+  /// options, and neighbouring rows with the same results are merged.
+  /// Returns null if DICtx holds no DWARF line tables.
+  static std::unique_ptr<SymbolizerIndex>
+  build(const SymbolizableModule &Module, DIContext &DICtx,
+        FunctionNameKind FNKind, bool UseSymbolTable);
+
+  /// Create an index from the contents of an index file. Fails if Buffer is
+  /// malformed, or was built with different options.
+  static Expected<std::unique_ptr<SymbolizerIndex>>
+  create(std::unique_ptr<MemoryBuffer> Buffer, FunctionNameKind FNKind,
+         bool UseSymbolTable);
+
+  /// Return the name under which the index for Obj is cached: its build ID
+  /// (ELF) or UUID (Mach-O) in hex. Returns an empty string if Obj has
+  /// neither, in which case its index can't be cached.
+  static std::string getCacheKey(const object::ObjectFile &Obj);
+
+  /// Write the index to Path, atomically replacing any existing file so
+  /// that concurrent symbolizers never read a partial index.
+  Error writeToFile(StringRef Path) const;
+
+  /// Set Result to what SymbolizableModule::symbolizeCode returns for
+  /// Address. Returns false if Address isn't covered by the index.
+  bool symbolizeCode(uint64_t Address, DILineInfo &Result) const;
+
+  /// Set Result to what SymbolizableModule::symbolizeInlinedCode returns
+  /// for Address. Returns false if Address isn't covered by the index.
+  bool symbolizeInlinedCode(uint64_t Address, DIInliningInfo &Result) const;
+
+  bool isWin32Module() const;
+  uint64_t getModulePreferredBase() const;
+
+  /// Return the size in bytes of the index data.
+  size_t getSize() const { return Buffer->getBufferSize(); }
+
+private:
+  struct Range;
+  struct Frame;
+  class Writer;
+
+  SymbolizerIndex(std::unique_ptr<MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  const Range *findRange(uint64_t Address) const;
+  DILineInfo getFrame(uint32_t Index) const;
+  const char *getString(uint32_t Offset) const;
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  const Range *Ranges = nullptr;
+  const Frame *Frames = nullptr;
+  uint32_t NumRanges = 0;
+  uint32_t NumFrames = 0;
+  StringRef Strings;
+};
+
+} // namespace symbolize
+} // namespace llvm
+
+#endif
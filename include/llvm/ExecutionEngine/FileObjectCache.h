@@ -0,0 +1,110 @@
+//===- FileObjectCache.h - Persistent on-disk JIT object cache --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of an ObjectCache that stores compiled
+// objects in a directory on disk, keyed on a hash of the module's IR.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CachePruning.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// An ObjectCache that persists objects in a directory on disk, so that they
+/// can be reused by later runs of the JIT.
+///
+/// Entries are keyed on a SHA1 hash of the module's bitcode, a configuration
+/// string describing the target and code generation options, and the LLVM
+/// version. The module's source file name (which defaults to its identifier)
+/// is left out of the hash, so identical IR generated under different names
+/// shares one entry.
+///
+/// Entries are written to a temporary file and renamed into place, and read
+/// back through (possibly memory-mapped) MemoryBuffers, so several processes
+/// may share a cache directory. The directory should not be used for anything
+/// else, since it is pruned with CachePruning after new entries are written.
+class FileObjectCache : public ObjectCache {
+public:
+  /// Create a cache in CacheDir (which is created if necessary). Config is
+  /// mixed into every key; see getTargetConfig.
+  FileObjectCache(StringRef CacheDir, StringRef Config);
+
+  /// Create a cache in CacheDir for objects compiled by TM.
+  FileObjectCache(StringRef CacheDir, const TargetMachine &TM);
+
+  /// Return a configuration string covering the properties of TM, including
+  /// its TargetOptions and optimization level, that affect the generated code.
+  static std::string getTargetConfig(const TargetMachine &TM);
+
+  /// Set the minimum time in seconds between two prunings of the directory.
+  FileObjectCache &setPruningInterval(int PruningInterval) {
+    Pruner.setPruningInterval(PruningInterval);
+    return *this;
+  }
+
+  /// Remove entries that haven't been accessed for ExpireAfter seconds.
+  FileObjectCache &setEntryExpiration(unsigned ExpireAfter) {
+    Pruner.setEntryExpiration(ExpireAfter);
+    return *this;
+  }
+
+  /// Limit the cache to the given percentage of the available disk space.
+  FileObjectCache &setMaxSize(unsigned Percentage) {
+    Pruner.setMaxSize(Percentage);
+    return *this;
+  }
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Return the path of the cache entry for M.
+  std::string getEntryPath(const Module &M) const;
+
+  unsigned getNumHits() const { return NumHits; }
+  unsigned getNumMisses() const { return NumMisses; }
+
+private:
+  std::string getEntryPathForKey(StringRef Key) const;
+  std::string computeKey(const Module &M) const;
+
+  std::string CacheDir;
+  std::string Config;
+  CachePruning Pruner;
+
+  // The key computed by getObject for the last module that missed on each
+  // thread. The JIT may modify the IR while compiling it, so
+  // notifyObjectCompiled uses this rather than rehashing the module. The JIT
+  // compiles a module on the thread that looked it up, and each miss replaces
+  // the thread's previous entry, so a key left behind by a failed compile
+  // can't be picked up by a later module that reuses the same address.
+  struct PendingKey {
+    const Module *M;
+    std::string Key;
+  };
+  std::mutex PendingKeysMutex;
+  std::map<std::thread::id, PendingKey> PendingKeys;
+
+  std::atomic<unsigned> NumHits;
+  std::atomic<unsigned> NumMisses;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
@@ -74,6 +74,12 @@ public:
   virtual void NotifyObjectEmitted(const object::ObjectFile &Obj,
                                    const RuntimeDyld::LoadedObjectInfo &L) {}
 
+  /// NotifyObjectFinalized - Called once the code of an object passed to
+  /// NotifyObjectEmitted has been relocated and given its final memory
+  /// permissions. Listeners that read the emitted code should do so here:
+  /// during NotifyObjectEmitted it is not relocated yet.
+  virtual void NotifyObjectFinalized(const object::ObjectFile &Obj) {}
+
   /// NotifyFreeingObject - Called just before the memory associated with
   /// a previously emitted object is released.
   virtual void NotifyFreeingObject(const object::ObjectFile &Obj) {}
@@ -81,6 +87,16 @@ public:
   // Get a pointe to the GDB debugger registration listener.
   static JITEventListener *createGDBRegistrationListener();
 
+  // Construct a PerfJITEventListener, which describes JIT'd code to the Linux
+  // perf tool in /tmp/perf-<pid>.map and /tmp/jit-<pid>.dump. Returns null on
+  // hosts that perf does not support. The listener reads the code it reports
+  // when it is finalized, so it can only be used with JITs that run code in
+  // this process and call NotifyObjectFinalized.
+  static JITEventListener *createPerfJITEventListener();
+
+  // Construct a PerfJITEventListener that writes its files to OutputDir.
+  static JITEventListener *createPerfJITEventListener(StringRef OutputDir);
+
 #if LLVM_USE_INTEL_JITEVENTS
   // Construct an IntelJITEventListener
   static JITEventListener *createIntelJITEventListener();
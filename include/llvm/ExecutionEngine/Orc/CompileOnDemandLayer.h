@@ -17,11 +17,21 @@
 
 #include "IndirectionUtils.h"
 #include "LambdaResolver.h"
+#include "OrcError.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <chrono>
+#include <condition_variable>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <utility>
 
@@ -35,6 +45,14 @@ namespace orc {
 /// added to the layer below. When a stub is called it triggers the extraction
 /// of the function body from the original module. The extracted body is then
 /// compiled and executed.
+///
+///   If a ThreadPool is supplied at construction time the layer will also
+/// compile every function eagerly on that pool as soon as its module is added.
+/// Stubs are switched to the compiled body as each background compile
+/// finishes, so callers only block if they reach a stub whose body is still
+/// being compiled. All layer operations (including background compiles) are
+/// serialized on a single layer mutex, since the source modules share an
+/// LLVMContext and the base layer is not required to be thread-safe.
 template <typename BaseLayerT,
           typename CompileCallbackMgrT = JITCompileCallbackManager,
           typename IndirectStubsMgrT = IndirectStubsManager>
@@ -146,20 +164,32 @@ private:
       : ExternalSymbolResolver(std::move(Other.ExternalSymbolResolver)),
         MemMgr(std::move(Other.MemMgr)),
         StubsMgr(std::move(Other.StubsMgr)),
+        StubNames(std::move(Other.StubNames)),
         StaticRenamer(std::move(Other.StaticRenamer)),
         ModuleAdder(std::move(Other.ModuleAdder)),
         SourceModules(std::move(Other.SourceModules)),
-        BaseLayerHandles(std::move(Other.BaseLayerHandles)) {}
+        BaseLayerHandles(std::move(Other.BaseLayerHandles)),
+        FunctionBodies(std::move(Other.FunctionBodies)),
+        PendingCallbacks(std::move(Other.PendingCallbacks)),
+        InFlight(std::move(Other.InFlight)),
+        PendingBackgroundCompiles(Other.PendingBackgroundCompiles),
+        Abandoned(Other.Abandoned) {}
 
     // Explicit move assignment operator to make MSVC happy.
     LogicalDylib& operator=(LogicalDylib &&Other) {
       ExternalSymbolResolver = std::move(Other.ExternalSymbolResolver);
       MemMgr = std::move(Other.MemMgr);
       StubsMgr = std::move(Other.StubsMgr);
+      StubNames = std::move(Other.StubNames);
       StaticRenamer = std::move(Other.StaticRenamer);
       ModuleAdder = std::move(Other.ModuleAdder);
       SourceModules = std::move(Other.SourceModules);
       BaseLayerHandles = std::move(Other.BaseLayerHandles);
+      FunctionBodies = std::move(Other.FunctionBodies);
+      PendingCallbacks = std::move(Other.PendingCallbacks);
+      InFlight = std::move(Other.InFlight);
+      PendingBackgroundCompiles = Other.PendingBackgroundCompiles;
+      Abandoned = Other.Abandoned;
       return *this;
     }
 
@@ -192,10 +222,30 @@ private:
     std::unique_ptr<JITSymbolResolver> ExternalSymbolResolver;
     std::unique_ptr<ResourceOwner<RuntimeDyld::MemoryManager>> MemMgr;
     std::unique_ptr<IndirectStubsMgrT> StubsMgr;
+    // Names of the stubs created in StubsMgr for this dylib.
+    std::vector<std::string> StubNames;
     StaticGlobalRenamer StaticRenamer;
     ModuleAdderFtor ModuleAdder;
     SourceModulesList SourceModules;
     std::vector<BaseLayerModuleSetHandleT> BaseLayerHandles;
+
+    // Addresses of the compiled bodies for functions in this dylib.
+    std::map<Function*, JITTargetAddress> FunctionBodies;
+
+    // Trampolines of the compile callbacks reserved for this dylib's stubs
+    // that have not fired yet, keyed on the function they compile.
+    std::map<Function*, JITTargetAddress> PendingCallbacks;
+
+    // Functions whose partitions have been extracted and are being compiled
+    // with the layer mutex released.
+    std::set<Function*> InFlight;
+
+    // Number of background compiles queued for this dylib but not yet run.
+    unsigned PendingBackgroundCompiles = 0;
+
+    // Set when the dylib is being removed: queued background compiles for it
+    // will bail out without touching its modules.
+    bool Abandoned = false;
   };
 
   typedef std::list<LogicalDylib> LogicalDylibList;
@@ -212,15 +262,48 @@ public:
   typedef std::function<std::unique_ptr<IndirectStubsMgrT>()>
     IndirectStubsManagerBuilderT;
 
+  /// @brief Compile latency record for a single function.
+  struct FunctionCompileMetrics {
+    /// Mangled name of the function.
+    std::string Name;
+    /// Time spent extracting and compiling the function's partition.
+    std::chrono::nanoseconds CompileTime{0};
+    /// Time the first caller spent blocked in the function's stub waiting for
+    /// a body. Zero if the stub was switched before it was ever called.
+    std::chrono::nanoseconds StallTime{0};
+    /// True if the body was compiled on the background thread pool.
+    bool CompiledInBackground = false;
+  };
+
   /// @brief Construct a compile-on-demand layer instance.
+  ///
+  ///   If CompileThreads is non-null, functions will be compiled eagerly on
+  /// that pool as their modules are added. The pool must outlive the layer.
+  /// Partitions are then compiled in parallel: each is moved into its own
+  /// LLVMContext and added to the base layer without the layer's lock held,
+  /// so the base layer's addModuleSet must be safe to call concurrently with
+  /// itself and with this layer's other calls into the base layer, and must
+  /// be done with the module when it returns (as IRCompileLayer is).
   CompileOnDemandLayer(BaseLayerT &BaseLayer, PartitioningFtor Partition,
                        CompileCallbackMgrT &CallbackMgr,
                        IndirectStubsManagerBuilderT CreateIndirectStubsManager,
-                       bool CloneStubsIntoPartitions = true)
+                       bool CloneStubsIntoPartitions = true,
+                       ThreadPool *CompileThreads = nullptr)
       : BaseLayer(BaseLayer), Partition(std::move(Partition)),
         CompileCallbackMgr(CallbackMgr),
         CreateIndirectStubsManager(std::move(CreateIndirectStubsManager)),
-        CloneStubsIntoPartitions(CloneStubsIntoPartitions) {}
+        CloneStubsIntoPartitions(CloneStubsIntoPartitions),
+        CompileThreads(CompileThreads) {}
+
+  /// @brief Wait for any background compiles that still refer to this layer,
+  ///        and release its unused compile callbacks.
+  ~CompileOnDemandLayer() {
+    std::unique_lock<std::recursive_mutex> Lock(LayerMutex);
+    for (auto &LD : LogicalDylibs) {
+      abandonBackgroundCompiles(Lock, LD);
+      releaseCompileCallbacks(LD);
+    }
+  }
 
   /// @brief Add a module to the compile-on-demand layer.
   template <typename ModuleSetT, typename MemoryManagerPtrT,
@@ -228,11 +311,16 @@ public:
   ModuleSetHandleT addModuleSet(ModuleSetT Ms,
                                 MemoryManagerPtrT MemMgr,
                                 SymbolResolverPtrT Resolver) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
 
     LogicalDylibs.push_back(LogicalDylib());
     auto &LD = LogicalDylibs.back();
     LD.ExternalSymbolResolver = std::move(Resolver);
-    LD.StubsMgr = CreateIndirectStubsManager();
+    if (!FreeStubsMgrs.empty()) {
+      LD.StubsMgr = std::move(FreeStubsMgrs.back());
+      FreeStubsMgrs.pop_back();
+    } else
+      LD.StubsMgr = CreateIndirectStubsManager();
 
     auto &MemMgrRef = *MemMgr;
     LD.MemMgr = wrapOwnership<RuntimeDyld::MemoryManager>(std::move(MemMgr));
@@ -255,8 +343,23 @@ public:
   /// @brief Remove the module represented by the given handle.
   ///
   ///   This will remove all modules in the layers below that were derived from
-  /// the module represented by H.
+  /// the module represented by H, release the compile callbacks of functions
+  /// that were never called, and free the module set's memory manager. Its
+  /// stubs are removed and, if the stubs manager supports removal, the
+  /// manager is kept for the next module set added. Trampolines and stubs
+  /// are therefore recycled for modules added later, so no code from this
+  /// module set may run (or be on the stack) once it has been removed.
+  ///
+  ///   Background compiles that have not started yet for this module set are
+  /// cancelled; one that is already running is allowed to finish first.
   void removeModuleSet(ModuleSetHandleT H) {
+    std::unique_lock<std::recursive_mutex> Lock(LayerMutex);
+    abandonBackgroundCompiles(Lock, *H);
+    releaseCompileCallbacks(*H);
+    for (auto BLH : H->BaseLayerHandles)
+      BaseLayer.removeModuleSet(BLH);
+    if (removeStubs(*H))
+      FreeStubsMgrs.push_back(std::move(H->StubsMgr));
     LogicalDylibs.erase(H);
   }
 
@@ -265,6 +368,7 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     for (auto LDI = LogicalDylibs.begin(), LDE = LogicalDylibs.end();
          LDI != LDE; ++LDI) {
       if (auto Sym = LDI->StubsMgr->findStub(Name, ExportedSymbolsOnly))
@@ -279,9 +383,109 @@ public:
   ///        below this one.
   JITSymbol findSymbolIn(ModuleSetHandleT H, const std::string &Name,
                          bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     return H->findSymbol(BaseLayer, Name, ExportedSymbolsOnly);
   }
 
+  /// @brief Return the compile latency metrics recorded so far, one entry per
+  ///        function whose body has been compiled by this layer.
+  std::vector<FunctionCompileMetrics> getCompileMetrics() const {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    std::vector<FunctionCompileMetrics> Result;
+    Result.reserve(CompileMetrics.size());
+    for (auto &Entry : CompileMetrics)
+      Result.push_back(Entry.second);
+    return Result;
+  }
+
+  /// @brief Replace the definitions of the functions defined in M, each of
+  ///        which must already be defined in the module set H.
+  ///
+  ///   Only M is compiled. The stub of each function is then switched to the
+  /// new body with a single pointer-sized store, so callers are not touched
+  /// and pick the new definition up on their next call (a call that is
+  /// already running finishes in the old body). Compile callbacks and
+  /// uncompiled IR for the old definitions are released. The old bodies
+  /// themselves stay allocated until H is removed, since they may still be
+  /// on the stack.
+  ///
+  ///   M may declare anything, but must only define functions with external
+  /// linkage; otherwise a StringError is returned. If some function defined
+  /// in M has no stub in H, OrcErrorCode::RedefinedFunctionNotFound is
+  /// returned. In both cases H is unchanged.
+  Error redefineFunctions(ModuleSetHandleT H, std::unique_ptr<Module> M) {
+    std::unique_lock<std::recursive_mutex> Lock(LayerMutex);
+    LogicalDylib &LD = *H;
+
+    // Let any partition holding an old definition finish compiling first, so
+    // that publishing it cannot switch a stub back to the old body.
+    PartitionCompiled.wait(Lock, [&]() {
+      for (auto &F : *M)
+        if (!F.isDeclaration())
+          if (Function *OldF = findSourceFunction(LD, F.getName()))
+            if (LD.InFlight.count(OldF))
+              return false;
+      return true;
+    });
+
+    if (M->getDataLayout().isDefault() && !LD.SourceModules.empty())
+      M->setDataLayout(LD.getSourceModule(0).getDataLayout());
+    const DataLayout &DL = M->getDataLayout();
+
+    // Check every function before changing anything. Each is paired with its
+    // current definition in the source modules, if it hasn't been replaced.
+    if (!M->global_empty() || !M->alias_empty())
+      return make_error<StringError>(
+          "Redefinitions must only define functions",
+          inconvertibleErrorCode());
+    std::vector<std::pair<std::string, Function*>> Redefined;
+    for (auto &F : *M) {
+      if (F.isDeclaration())
+        continue;
+      if (!F.hasExternalLinkage())
+        return make_error<StringError>("Redefined function " + F.getName() +
+                                           " must have external linkage",
+                                       inconvertibleErrorCode());
+      std::string MangledName = mangle(F.getName(), DL);
+      if (!LD.StubsMgr->findStub(MangledName, false))
+        return orcError(OrcErrorCode::RedefinedFunctionNotFound);
+      Redefined.push_back(
+          std::make_pair(MangledName, findSourceFunction(LD, F.getName())));
+    }
+
+    // Retire the old definitions, so that neither their compile callbacks
+    // nor a partition or background compile of another function can compile
+    // them and switch the stubs back.
+    for (auto &R : Redefined) {
+      Function *OldF = R.second;
+      if (!OldF)
+        continue;
+      auto CallbackI = LD.PendingCallbacks.find(OldF);
+      if (CallbackI != LD.PendingCallbacks.end()) {
+        CompileCallbackMgr.releaseCompileCallback(CallbackI->second);
+        LD.PendingCallbacks.erase(CallbackI);
+      }
+      if (!OldF->isDeclaration())
+        OldF->deleteBody();
+    }
+
+    auto NewH = LD.ModuleAdder(BaseLayer, std::move(M),
+                               createLogicalDylibResolver(LD));
+    LD.BaseLayerHandles.push_back(NewH);
+
+    for (auto &R : Redefined) {
+      auto FnBodySym = BaseLayer.findSymbolIn(NewH, R.first, false);
+      assert(FnBodySym && "Couldn't find function body.");
+      JITTargetAddress FnBodyAddr = FnBodySym.getAddress();
+      if (R.second)
+        LD.FunctionBodies[R.second] = FnBodyAddr;
+      if (auto Err = LD.StubsMgr->updatePointer(R.first, FnBodyAddr))
+        return Err;
+    }
+
+    return Error::success();
+  }
+
   /// @brief Update the stub for the given function to point at FnBodyAddr.
   /// This can be used to support re-optimization.
   /// @return true if the function exists and the stub is updated, false
@@ -289,20 +493,22 @@ public:
   //
   // FIXME: We should track and free associated resources (unused compile
   //        callbacks, uncompiled IR, and no-longer-needed/reachable function
-  //        implementations).
+  //        implementations), as redefineFunctions does for the first two.
   // FIXME: Return Error once the JIT APIs are Errorized.
   bool updatePointer(std::string FuncName, JITTargetAddress FnBodyAddr) {
-    //Find out which logical dylib contains our symbol
-    auto LDI = LogicalDylibs.begin();
-    for (auto LDE = LogicalDylibs.end(); LDI != LDE; ++LDI) {
-      if (auto LMResources = LDI->getLogicalModuleResourcesForSymbol(FuncName, false)) {
-        Module &SrcM = LMResources->SourceModule->getResource();
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    // Find out which logical dylib contains our symbol.
+    for (auto &LD : LogicalDylibs) {
+      for (auto &SME : LD.SourceModules) {
+        Module &SrcM = SME.SourceMod->getResource();
         std::string CalledFnName = mangle(FuncName, SrcM.getDataLayout());
-        if (auto EC = LMResources->StubsMgr->updatePointer(CalledFnName, FnBodyAddr)) {
+        if (!LD.StubsMgr->findStub(CalledFnName, false))
+          continue;
+        if (auto Err = LD.StubsMgr->updatePointer(CalledFnName, FnBodyAddr)) {
+          consumeError(std::move(Err));
           return false;
         }
-        else
-          return true;
+        return true;
       }
     }
     return false;
@@ -352,12 +558,20 @@ private:
         StubInits[MangledName] =
           std::make_pair(CCInfo.getAddress(),
                          JITSymbolFlags::fromGlobalValue(F));
+        LD.PendingCallbacks[&F] = CCInfo.getAddress();
         CCInfo.setCompileAction([this, &LD, LMId, &F]() {
-          return this->extractAndCompile(LD, LMId, F);
+          return this->compileFromStub(LD, LMId, F);
         });
+
+        // If we have a compile pool, start on the body right away. The task
+        // will not run until we release the layer mutex.
+        if (CompileThreads)
+          scheduleBackgroundCompile(LD, LMId, F);
       }
 
       auto EC = LD.StubsMgr->createStubs(StubInits);
+      for (auto &Entry : StubInits)
+        LD.StubNames.push_back(Entry.first());
       (void)EC;
       // FIXME: This should be propagated back to the user. Stub creation may
       //        fail for remote JITs.
@@ -464,25 +678,152 @@ private:
     return MangledName;
   }
 
+  // Compile action for a function's stub. Runs on the thread that called the
+  // stub.
   JITTargetAddress
-  extractAndCompile(LogicalDylib &LD,
-                    typename LogicalDylib::SourceModuleHandle LMId,
-                    Function &F) {
-    Module &SrcM = LD.getSourceModule(LMId);
+  compileFromStub(LogicalDylib &LD,
+                  typename LogicalDylib::SourceModuleHandle LMId,
+                  Function &F) {
+    std::unique_lock<std::recursive_mutex> Lock(LayerMutex);
+    // Only count the time spent getting this function's body, not time spent
+    // waiting for the lock while other partitions were claimed or published.
+    auto Start = std::chrono::steady_clock::now();
+
+    // The callback manager has already released the trampoline.
+    LD.PendingCallbacks.erase(&F);
+
+    JITTargetAddress Addr = compileFunction(Lock, LD, LMId, F, false);
+    if (Addr) {
+      Module &SrcM = LD.getSourceModule(LMId);
+      std::string Name = mangle(F.getName(), SrcM.getDataLayout());
+      CompileMetrics[Name].StallTime = std::chrono::steady_clock::now() - Start;
+    }
+    return Addr;
+  }
+
+  void scheduleBackgroundCompile(LogicalDylib &LD,
+                                 typename LogicalDylib::SourceModuleHandle LMId,
+                                 Function &F) {
+    ++LD.PendingBackgroundCompiles;
+    CompileThreads->async([this, &LD, LMId, &F]() {
+      std::unique_lock<std::recursive_mutex> Lock(LayerMutex);
+      if (!LD.Abandoned)
+        compileFunction(Lock, LD, LMId, F, true);
+      if (--LD.PendingBackgroundCompiles == 0)
+        BackgroundCompilesDone.notify_all();
+    });
+  }
+
+  // Cancel queued background compiles for LD and wait for any that are
+  // running. Must be called with the layer mutex held exactly once.
+  void abandonBackgroundCompiles(std::unique_lock<std::recursive_mutex> &Lock,
+                                 LogicalDylib &LD) {
+    LD.Abandoned = true;
+    if (!LD.PendingBackgroundCompiles)
+      return;
+#if LLVM_ENABLE_THREADS
+    BackgroundCompilesDone.wait(
+        Lock, [&LD]() { return LD.PendingBackgroundCompiles == 0; });
+#else
+    // Without threads the pool runs its queue on this thread in wait(). The
+    // layer mutex is recursive, so the tasks can still take it.
+    CompileThreads->wait();
+#endif
+  }
+
+  // Return the trampolines of LD's callbacks that have not fired to the
+  // callback manager. Must be called with the layer mutex held.
+  void releaseCompileCallbacks(LogicalDylib &LD) {
+    for (auto &KV : LD.PendingCallbacks)
+      CompileCallbackMgr.releaseCompileCallback(KV.second);
+    LD.PendingCallbacks.clear();
+  }
+
+  // Remove every stub LD created, so that its stubs manager can be reused.
+  // Returns false if the manager doesn't support removing stubs.
+  bool removeStubs(LogicalDylib &LD) {
+    for (auto &Name : LD.StubNames)
+      if (auto Err = LD.StubsMgr->removeStub(Name)) {
+        consumeError(std::move(Err));
+        return false;
+      }
+    return true;
+  }
 
-    // If F is a declaration we must already have compiled it.
+  // Return the address of F's body, compiling F (and the rest of its
+  // partition) if nobody has yet, and record latency metrics. If another
+  // thread is already compiling F, wait for it to publish the body instead.
+  // Must be called with the layer mutex held exactly once.
+  JITTargetAddress
+  compileFunction(std::unique_lock<std::recursive_mutex> &Lock,
+                  LogicalDylib &LD,
+                  typename LogicalDylib::SourceModuleHandle LMId,
+                  Function &F, bool InBackground) {
+    PartitionCompiled.wait(Lock, [&]() { return !LD.InFlight.count(&F); });
+
+    auto BodyI = LD.FunctionBodies.find(&F);
+    if (BodyI != LD.FunctionBodies.end())
+      return BodyI->second;
+
+    // If F is a declaration here, its definition has been retired by
+    // redefineFunctions.
     if (F.isDeclaration())
       return 0;
 
-    // Grab the name of the function being called here.
-    std::string CalledFnName = mangle(F.getName(), SrcM.getDataLayout());
+    Module &SrcM = LD.getSourceModule(LMId);
+    const DataLayout &DL = SrcM.getDataLayout();
 
+    // Claim the partition. Drop any members that have already been compiled,
+    // or are being compiled, by a partition of their own.
     auto Part = Partition(F);
-    auto PartH = emitPartition(LD, LMId, Part);
+    for (auto I = Part.begin(); I != Part.end();)
+      if ((*I)->isDeclaration() || LD.InFlight.count(*I))
+        I = Part.erase(I);
+      else
+        ++I;
+
+    auto Start = std::chrono::steady_clock::now();
+    std::chrono::nanoseconds CompileTime{0};
+    BaseLayerModuleSetHandleT PartH;
+    if (!CompileThreads) {
+      PartH = LD.ModuleAdder(BaseLayer, extractPartition(LD, LMId, Part),
+                             createLogicalDylibResolver(LD));
+    } else {
+      // Move the partition into a private context and compile it with the
+      // lock released, so that other partitions can be compiled (and other
+      // stubs can be served) meanwhile.
+      SmallVector<char, 0> Bitcode;
+      std::string PartName;
+      {
+        auto PartM = extractPartition(LD, LMId, Part);
+        PartName = PartM->getModuleIdentifier();
+        writeModuleToBitcode(*PartM, Bitcode);
+      }
+      auto Resolver = createLogicalDylibResolver(LD);
+      LD.InFlight.insert(Part.begin(), Part.end());
+
+      Lock.unlock();
+      {
+        LLVMContext Context;
+        PartH = LD.ModuleAdder(BaseLayer,
+                               loadModuleFromBitcode(Bitcode, PartName,
+                                                     Context),
+                               std::move(Resolver));
+      }
+      CompileTime = std::chrono::steady_clock::now() - Start;
+      Lock.lock();
+
+      Start = std::chrono::steady_clock::now();
+      for (auto *SubF : Part)
+        LD.InFlight.erase(SubF);
+      PartitionCompiled.notify_all();
+    }
 
+    // Publish the bodies.
+    LD.BaseLayerHandles.push_back(PartH);
     JITTargetAddress CalledAddr = 0;
     for (auto *SubF : Part) {
-      std::string FnName = mangle(SubF->getName(), SrcM.getDataLayout());
+      std::string FnName = mangle(SubF->getName(), DL);
       auto FnBodySym = BaseLayer.findSymbolIn(PartH, FnName, false);
       assert(FnBodySym && "Couldn't find function body.");
 
@@ -492,20 +833,29 @@ private:
       // return it from this function.
       if (SubF == &F)
         CalledAddr = FnBodyAddr;
+      LD.FunctionBodies[SubF] = FnBodyAddr;
 
       // Update the function body pointer for the stub.
       if (auto EC = LD.StubsMgr->updatePointer(FnName, FnBodyAddr))
         return 0;
     }
+    CompileTime += std::chrono::steady_clock::now() - Start;
 
+    std::string Name = mangle(F.getName(), DL);
+    auto &Metrics = CompileMetrics[Name];
+    Metrics.Name = Name;
+    Metrics.CompileTime = CompileTime;
+    Metrics.CompiledInBackground = InBackground;
     return CalledAddr;
   }
 
+  // Move the bodies of the functions in Part out of their source module and
+  // into a new module in the same context, leaving declarations behind.
   template <typename PartitionT>
-  BaseLayerModuleSetHandleT
-  emitPartition(LogicalDylib &LD,
-                typename LogicalDylib::SourceModuleHandle LMId,
-                const PartitionT &Part) {
+  std::unique_ptr<Module>
+  extractPartition(LogicalDylib &LD,
+                   typename LogicalDylib::SourceModuleHandle LMId,
+                   const PartitionT &Part) {
     Module &SrcM = LD.getSourceModule(LMId);
 
     // Create the module.
@@ -564,27 +914,50 @@ private:
     for (auto *F : Part)
       moveFunctionBody(*F, VMap, &Materializer);
 
-    // Create memory manager and symbol resolver.
-    auto Resolver = createLambdaResolver(
-        [this, &LD, LMId](const std::string &Name) {
+    return M;
+  }
+
+  // Build a resolver for code compiled into LD: symbols defined in LD are
+  // found through its stubs where they have one.
+  std::unique_ptr<JITSymbolResolver>
+  createLogicalDylibResolver(LogicalDylib &LD) {
+    return createLambdaResolver(
+        [this, &LD](const std::string &Name) {
           if (auto Sym = LD.findSymbol(BaseLayer, Name, false))
             return Sym;
           return LD.ExternalSymbolResolver->findSymbolInLogicalDylib(Name);
         },
-        [this, &LD](const std::string &Name) {
+        [&LD](const std::string &Name) {
           return LD.ExternalSymbolResolver->findSymbol(Name);
         });
+  }
 
-    return LD.ModuleAdder(BaseLayer, std::move(M), std::move(Resolver));
+  // Find the source function named Name in LD that still provides its
+  // definition, whether or not it has been compiled yet.
+  Function *findSourceFunction(LogicalDylib &LD, StringRef Name) {
+    for (auto &SME : LD.SourceModules)
+      if (Function *F = SME.SourceMod->getResource().getFunction(Name))
+        if (!F->isDeclaration() || LD.FunctionBodies.count(F) ||
+            LD.InFlight.count(F))
+          return F;
+    return nullptr;
   }
 
   BaseLayerT &BaseLayer;
   PartitioningFtor Partition;
   CompileCallbackMgrT &CompileCallbackMgr;
   IndirectStubsManagerBuilderT CreateIndirectStubsManager;
+  // Emptied stubs managers of removed module sets, whose stubs are reused.
+  std::vector<std::unique_ptr<IndirectStubsMgrT>> FreeStubsMgrs;
 
   LogicalDylibList LogicalDylibs;
   bool CloneStubsIntoPartitions;
+
+  ThreadPool *CompileThreads;
+  mutable std::recursive_mutex LayerMutex;
+  std::condition_variable_any BackgroundCompilesDone;
+  std::condition_variable_any PartitionCompiled;
+  StringMap<FunctionCompileMetrics> CompileMetrics;
 };
 
 } // End namespace orc.
@@ -15,6 +15,7 @@
 #define LLVM_EXECUTIONENGINE_ORC_INDIRECTIONUTILS_H
 
 #include "LambdaResolver.h"
+#include "OrcError.h"
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/IR/IRBuilder.h"
@@ -102,7 +103,9 @@ public:
   ///
   ///   Note: Callbacks are auto-released after they execute. This method should
   /// only be called to manually release a callback that is not going to
-  /// execute.
+  /// execute, e.g. because the module it would have compiled was removed.
+  /// The trampoline is recycled for the next callback, so it must no longer
+  /// be reachable from any code that can still run.
   void releaseCompileCallback(JITTargetAddress TrampolineAddr) {
     auto I = ActiveTrampolines.find(TrampolineAddr);
     assert(I != ActiveTrampolines.end() && "Not an active trampoline.");
@@ -231,6 +234,15 @@ public:
   /// @brief Change the value of the implementation pointer for the stub.
   virtual Error updatePointer(StringRef Name, JITTargetAddress NewAddr) = 0;
 
+  /// @brief Remove the stub with the given name. Its memory will be reused by
+  ///        stubs created later, so it must no longer be reachable from any
+  ///        code that can still run.
+  ///
+  ///   Fails with OrcErrorCode::StubNotFound if there is no such stub. The
+  /// default implementation, for managers that never reuse stub memory,
+  /// fails with OrcErrorCode::StubRemovalUnsupported.
+  virtual Error removeStub(StringRef Name);
+
 private:
   virtual void anchor();
 };
@@ -297,6 +309,15 @@ public:
     return Error::success();
   }
 
+  Error removeStub(StringRef Name) override {
+    auto I = StubIndexes.find(Name);
+    if (I == StubIndexes.end())
+      return orcError(OrcErrorCode::StubNotFound);
+    FreeStubs.push_back(I->second.first);
+    StubIndexes.erase(I);
+    return Error::success();
+  }
+
 private:
   Error reserveStubs(unsigned NumStubs) {
     if (NumStubs <= FreeStubs.size())
@@ -419,6 +440,16 @@ GlobalAlias *cloneGlobalAliasDecl(Module &Dst, const GlobalAlias &OrigA,
 void cloneModuleFlagsMetadata(Module &Dst, const Module &Src,
                               ValueToValueMapTy &VMap);
 
+/// @brief Write M to Buffer as bitcode, so that it can be loaded into another
+///        LLVMContext with loadModuleFromBitcode.
+void writeModuleToBitcode(const Module &M, SmallVectorImpl<char> &Buffer);
+
+/// @brief Load a module written by writeModuleToBitcode into Ctx. Reports a
+///        fatal error if the bitcode can't be read.
+std::unique_ptr<Module> loadModuleFromBitcode(ArrayRef<char> Buffer,
+                                              StringRef Name,
+                                              LLVMContext &Ctx);
+
 } // End namespace orc.
 } // End namespace llvm.
 
@@ -20,6 +20,7 @@
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include <list>
 #include <memory>
+#include <mutex>
 
 namespace llvm {
 namespace orc {
@@ -275,6 +276,7 @@ public:
     // below.
     auto *LOSPtr = LOS.get();
 
+    std::lock_guard<std::mutex> Lock(LinkedObjSetListMutex);
     ObjSetHandleT Handle = LinkedObjSetList.insert(LinkedObjSetList.end(),
                                                    std::move(LOS));
     LOSPtr->setHandle(Handle);
@@ -292,6 +294,7 @@ public:
   /// layer.
   void removeObjectSet(ObjSetHandleT H) {
     // How do we invalidate the symbols in H?
+    std::lock_guard<std::mutex> Lock(LinkedObjSetListMutex);
     LinkedObjSetList.erase(H);
   }
 
@@ -300,6 +303,7 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::mutex> Lock(LinkedObjSetListMutex);
     for (auto I = LinkedObjSetList.begin(), E = LinkedObjSetList.end(); I != E;
          ++I)
       if (auto Symbol = findSymbolIn(I, Name, ExportedSymbolsOnly))
@@ -345,6 +349,9 @@ private:
     return *Obj.getBinary();
   }
 
+  // Guards the list itself, so that object sets may be added (e.g. by
+  // concurrent compiles) while others are being searched.
+  std::mutex LinkedObjSetListMutex;
   LinkedObjectSetListT LinkedObjSetList;
   NotifyLoadedFtor NotifyLoaded;
   NotifyFinalizedFtor NotifyFinalized;
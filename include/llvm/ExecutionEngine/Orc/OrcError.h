@@ -29,6 +29,13 @@ enum class OrcErrorCode : int {
   RemoteIndirectStubsOwnerIdAlreadyInUse,
   UnexpectedRPCCall,
   UnexpectedRPCResponse,
+  RPCChannelClosed,
+  InvalidRPCChannelRegion,
+  // Stub Errors
+  StubNotFound,
+  StubRemovalUnsupported,
+  // Layer Errors
+  RedefinedFunctionNotFound,
 };
 
 Error orcError(OrcErrorCode ErrCode);
@@ -499,6 +499,15 @@ public:
       return Remote.writePointer(getPtrAddr(Key), NewAddr);
     }
 
+    Error removeStub(StringRef Name) override {
+      auto I = StubIndexes.find(Name);
+      if (I == StubIndexes.end())
+        return orcError(OrcErrorCode::StubNotFound);
+      FreeStubs.push_back(I->second.first);
+      StubIndexes.erase(I);
+      return Error::success();
+    }
+
   private:
     struct RemoteIndirectStubsInfo {
       JITTargetAddress StubBase;
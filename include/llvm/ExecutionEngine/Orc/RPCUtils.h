@@ -200,6 +200,9 @@ protected:
         return Err;
       if (auto Err = serializeSeq(C, ResponseId, SeqNo, *Result))
         return Err;
+      // The caller is blocked on this response, so flush it now.
+      if (auto Err = C.send())
+        return Err;
       return endSendMessage(C);
     }
   };
@@ -258,6 +261,9 @@ protected:
         return Err;
       if (auto Err = serializeSeq(C, ResponseId, SeqNo))
         return Err;
+      // The caller is blocked on this response, so flush it now.
+      if (auto Err = C.send())
+        return Err;
       return endSendMessage(C);
     }
   };
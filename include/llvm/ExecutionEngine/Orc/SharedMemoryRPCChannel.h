@@ -0,0 +1,103 @@
+//===- SharedMemoryRPCChannel.h - RPC over shared memory --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An RPCByteChannel that exchanges bytes with a peer process through a pair of
+// ring buffers in a shared file mapping, avoiding a system call per read or
+// write.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYRPCCHANNEL_H
+#define LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYRPCCHANNEL_H
+
+#include "RPCByteChannel.h"
+#include "llvm/Support/FileSystem.h"
+#include <cstdint>
+#include <memory>
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+/// @brief RPC channel backed by two single-producer/single-consumer ring
+///        buffers in a shared memory mapping.
+///
+///   One end creates the region in a file descriptor (typically an unlinked
+/// temporary file that is inherited by a child process) and the other end
+/// attaches to it. Each end writes into one ring and reads from the other.
+///
+///   Appended bytes are copied straight into the ring, and only become
+/// visible to the peer on send() (or when the ring fills up), so that an RPC
+/// call costs one publication rather than one per serialized field. A reader
+/// that finds its ring empty spins briefly, then yields, then sleeps, so idle
+/// ends do not burn a core.
+///
+///   Destroying either end closes the channel: pending data can still be
+/// drained, after which reads and writes fail with
+/// OrcErrorCode::RPCChannelClosed.
+///
+///   A peer that dies without destroying its end never marks the region
+/// closed. To notice that, each end can be given the read end of a pipe
+/// whose only write end is held by the peer process: once the peer exits the
+/// pipe reports end-of-file, and a read or write that is waiting on the peer
+/// fails with OrcErrorCode::RPCChannelClosed instead of waiting forever.
+/// The check is only made while backing off, so it costs nothing while data
+/// is flowing. It is only available on Unix hosts.
+class SharedMemoryRPCChannel final : public RPCByteChannel {
+public:
+  /// Default capacity of each ring, in bytes.
+  static const uint64_t DefaultRingSize = 1 << 20;
+
+  /// @brief Initialize a channel region in the file open (for reading and
+  ///        writing) as FD, resizing it as needed, and return the creating
+  ///        end. RingSize must be a power of two.
+  ///
+  ///   If PeerFD is not -1 it is the read end of the peer's liveness pipe
+  /// (see above). The channel takes ownership of it.
+  static Expected<std::unique_ptr<SharedMemoryRPCChannel>>
+  create(int FD, uint64_t RingSize = DefaultRingSize, int PeerFD = -1);
+
+  /// @brief Map a region previously initialized by create and return the
+  ///        attaching end. PeerFD is as for create.
+  static Expected<std::unique_ptr<SharedMemoryRPCChannel>>
+  attach(int FD, int PeerFD = -1);
+
+  ~SharedMemoryRPCChannel() override;
+
+  Error readBytes(char *Dst, unsigned Size) override;
+  Error appendBytes(const char *Src, unsigned Size) override;
+  Error send() override;
+
+private:
+  struct RegionHeader;
+  struct Ring;
+
+  SharedMemoryRPCChannel(std::unique_ptr<sys::fs::mapped_file_region> Region,
+                         bool IsCreator, int PeerFD);
+
+  /// Make everything appended so far visible to the peer.
+  void publish();
+
+  /// Return true if the peer process is known to have exited.
+  bool peerExited() const;
+
+  std::unique_ptr<sys::fs::mapped_file_region> Region;
+  RegionHeader *Header;
+  Ring *In, *Out;
+  char *InData, *OutData;
+  uint64_t Mask;
+  uint64_t WritePos;
+  int PeerFD;
+};
+
+} // end namespace remote
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYRPCCHANNEL_H
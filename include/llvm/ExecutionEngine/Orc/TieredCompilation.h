@@ -0,0 +1,170 @@
+//===- TieredCompilation.h - Profile-driven re-optimization -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Utilities for tiered compilation on top of the compile-on-demand layer:
+// functions are first compiled quickly with cheap execution counters, and
+// functions that turn out to be hot are recompiled at a higher optimization
+// level and patched in through their stubs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILATION_H
+#define LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILATION_H
+
+#include "LambdaResolver.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorOr.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+namespace orc {
+
+/// @brief Collects execution counts for tier-0 code.
+///
+///   The instrument method is an IR transform intended to sit between a
+/// CompileOnDemandLayer and a fast (e.g. -O0 FastISel) compile layer, for
+/// example via an IRTransformLayer. For each partition that contains function
+/// bodies it saves a bitcode snapshot of the uninstrumented IR and adds a
+/// counter increment at function entry and at every loop header. Partitions
+/// whose counters reach the hot threshold are handed out (once) by
+/// takeHotModules.
+///
+///   The counters live in this object and are referenced by absolute address
+/// from the instrumented code, so this is only suitable for in-process JITs,
+/// and the profiler must outlive any code it has instrumented.
+class TierUpProfiler {
+public:
+  /// @brief A saved partition whose counters reached the hot threshold.
+  struct HotModule {
+    /// IR names of the functions defined by the partition.
+    std::vector<std::string> FunctionNames;
+    /// Bitcode for the uninstrumented partition.
+    SmallVector<char, 0> Bitcode;
+  };
+
+  /// @brief Construct a profiler. Functions become hot once the sum of their
+  ///        entry and backedge counts reaches HotThreshold.
+  TierUpProfiler(uint64_t HotThreshold) : HotThreshold(HotThreshold) {}
+
+  /// @brief Snapshot and instrument the given module. Modules without any
+  ///        function bodies are returned unchanged.
+  std::unique_ptr<Module> instrument(std::unique_ptr<Module> M);
+
+  /// @brief Return the partitions that have become hot since the last call.
+  std::vector<HotModule> takeHotModules();
+
+  /// @brief Parse the saved IR for a hot partition into the given context.
+  static ErrorOr<std::unique_ptr<Module>> loadHotModule(const HotModule &Hot,
+                                                        LLVMContext &Context);
+
+private:
+  struct ProfiledModule {
+    HotModule Saved;
+    std::vector<std::atomic<uint64_t> *> Counters;
+  };
+
+  uint64_t HotThreshold;
+  std::mutex ProfilerMutex;
+  std::deque<std::atomic<uint64_t>> Counters;
+  std::vector<ProfiledModule> ColdModules;
+};
+
+/// @brief Recompiles hot partitions reported by a TierUpProfiler and switches
+///        the corresponding CompileOnDemandLayer stubs to the new bodies.
+///
+///   Hot IR is parsed into a context owned by this object and compiled through
+/// OptLayer, which must not be shared with the compile-on-demand stack. This
+/// allows recompileHotFunctions to run on a background thread while the JIT
+/// keeps executing and compiling tier-0 code, provided that only one thread
+/// calls it at a time.
+template <typename CODLayerT, typename OptLayerT>
+class TierUpCompiler {
+public:
+  /// @brief Functor for optimizing a hot module before it is recompiled.
+  typedef std::function<std::unique_ptr<Module>(std::unique_ptr<Module>)>
+    OptimizeFtor;
+
+  /// @brief Construct a TierUpCompiler. Symbols that cannot be found in the
+  ///        compile-on-demand layer will be looked up in ExternalResolver.
+  TierUpCompiler(TierUpProfiler &Profiler, CODLayerT &CODLayer,
+                 OptLayerT &OptLayer, OptimizeFtor Optimize,
+                 std::unique_ptr<JITSymbolResolver> ExternalResolver)
+      : Profiler(Profiler), CODLayer(CODLayer), OptLayer(OptLayer),
+        Optimize(std::move(Optimize)),
+        ExternalResolver(std::move(ExternalResolver)) {}
+
+  /// @brief Recompile every partition that has become hot and update the
+  ///        stubs for the functions it defines.
+  /// @return The number of stubs that were switched to a recompiled body.
+  unsigned recompileHotFunctions() {
+    unsigned NumUpdated = 0;
+    for (auto &Hot : Profiler.takeHotModules()) {
+      auto M = TierUpProfiler::loadHotModule(Hot, Context);
+      // A snapshot that fails to load just stays at tier 0.
+      if (!M)
+        continue;
+
+      const DataLayout DL = (*M)->getDataLayout();
+      std::vector<std::unique_ptr<Module>> Ms;
+      Ms.push_back(Optimize(std::move(*M)));
+      auto H = OptLayer.addModuleSet(std::move(Ms), &MemMgr, createResolver());
+
+      for (auto &Name : Hot.FunctionNames) {
+        auto Sym = OptLayer.findSymbolIn(H, mangle(Name, DL), false);
+        if (Sym && CODLayer.updatePointer(Name, Sym.getAddress()))
+          ++NumUpdated;
+      }
+    }
+    return NumUpdated;
+  }
+
+private:
+  std::unique_ptr<JITSymbolResolver> createResolver() {
+    return createLambdaResolver(
+        [this](const std::string &Name) {
+          return CODLayer.findSymbol(Name, false);
+        },
+        [this](const std::string &Name) {
+          return ExternalResolver->findSymbol(Name);
+        });
+  }
+
+  static std::string mangle(StringRef Name, const DataLayout &DL) {
+    std::string MangledName;
+    {
+      raw_string_ostream MangledNameStream(MangledName);
+      Mangler::getNameWithPrefix(MangledNameStream, Name, DL);
+    }
+    return MangledName;
+  }
+
+  TierUpProfiler &Profiler;
+  CODLayerT &CODLayer;
+  OptLayerT &OptLayer;
+  OptimizeFtor Optimize;
+  std::unique_ptr<JITSymbolResolver> ExternalResolver;
+  LLVMContext Context;
+  SectionMemoryManager MemMgr;
+};
+
+} // End namespace orc.
+} // End namespace llvm.
+
+#endif // LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILATION_H
@@ -0,0 +1,196 @@
+//===- PooledSectionMemoryManager.h - Pooled JIT section memory -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of a memory manager that sub-allocates
+// sections from large, shared, huge-page backed slabs, and returns them for
+// reuse when the objects they hold are discarded.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/Memory.h"
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace llvm {
+
+/// A thread-safe pool of page-aligned, read-write memory for JIT sections.
+///
+/// Memory is reserved from the system in slabs of (by default) 32Mb, aligned
+/// to 2Mb so that transparent huge pages can back them where the platform
+/// supports it. Slabs are never returned to the system before the pool is
+/// destroyed; blocks handed back with deallocate are coalesced and reused.
+/// Each new slab is requested near the previous one, which keeps JIT'd code
+/// within range of 32-bit PC-relative relocations where possible.
+///
+/// Code, read-only data and read-write data are carved from separate slabs,
+/// so that blocks which end up with different permissions never share a huge
+/// page: a permission change in the middle of a huge page splits it back into
+/// small pages.
+///
+/// The pool must outlive every block allocated from it.
+class SectionMemoryPool {
+  SectionMemoryPool(const SectionMemoryPool&) = delete;
+  void operator=(const SectionMemoryPool&) = delete;
+
+public:
+  /// The alignment of each slab, and the size of a huge page on the common
+  /// JIT hosts.
+  static const size_t HugePageSize = 2 * 1024 * 1024;
+
+  /// The permission class a block is allocated for. Each has its own slabs.
+  enum class AllocationPurpose { Code, ROData, RWData };
+
+  /// Create a pool that reserves memory in slabs of SlabSize bytes (rounded
+  /// up to a multiple of HugePageSize). If UseHugePages is set, the slabs
+  /// are advised to be backed by huge pages.
+  explicit SectionMemoryPool(size_t SlabSize = 16 * HugePageSize,
+                             bool UseHugePages = true);
+  ~SectionMemoryPool();
+
+  /// Allocate a read-write block of at least Size bytes from the slabs for
+  /// Purpose. The block is page aligned and its size is a multiple of the
+  /// page size. On failure, a null block is returned and EC describes the
+  /// error.
+  sys::MemoryBlock allocate(size_t Size, AllocationPurpose Purpose,
+                            std::error_code &EC);
+
+  /// Return a block obtained from allocate with the same Purpose to the
+  /// pool. The block may have had its permissions changed; it is made
+  /// read-write again before reuse.
+  void deallocate(sys::MemoryBlock Block, AllocationPurpose Purpose);
+
+  /// Return the number of slabs reserved from the system.
+  size_t getNumSlabs() const;
+
+  /// Return the number of bytes in reserved slabs that are not allocated.
+  size_t getNumFreeBytes() const;
+
+private:
+  // The slabs of one permission class.
+  struct SlabClass {
+    // Free ranges, keyed on start address and mapped to their size. Adjacent
+    // ranges within a slab are coalesced.
+    std::map<uintptr_t, size_t> FreeRanges;
+    // The start of the usable part of each slab.
+    std::set<uintptr_t> SlabStarts;
+  };
+
+  SlabClass &getSlabClass(AllocationPurpose Purpose) {
+    return Classes[static_cast<unsigned>(Purpose)];
+  }
+
+  std::error_code addSlab(SlabClass &Class, size_t MinSize);
+
+  size_t SlabSize;
+  bool UseHugePages;
+  mutable std::mutex PoolMutex;
+  // All slabs, in the order they were reserved.
+  std::vector<sys::MemoryBlock> Slabs;
+  SlabClass Classes[3];
+};
+
+/// A memory manager that bump-allocates sections out of blocks taken from a
+/// SectionMemoryPool.
+///
+/// Code, read-only data and read-write data are allocated from separate
+/// blocks, which the pool takes from separate slabs. Memory stays read-write
+/// until finalizeMemory, which makes the code and read-only data allocated
+/// since the last call executable or read-only with one protection change
+/// per block (rather than one per section), and moves later allocations to
+/// fresh pages so that finalized memory is never writable again.
+///
+/// Destroying the memory manager returns all of its blocks to the pool, so
+/// a JIT that discards objects (e.g. via removeModuleSet) can reuse their
+/// memory. As with SectionMemoryManager, the memory manager must only be
+/// destroyed once the code it holds can no longer run, and after any EH
+/// frames it registered have been deregistered.
+class PooledSectionMemoryManager : public RTDyldMemoryManager {
+  PooledSectionMemoryManager(const PooledSectionMemoryManager&) = delete;
+  void operator=(const PooledSectionMemoryManager&) = delete;
+
+public:
+  /// The minimum size of the blocks requested from the pool.
+  static const size_t MinBlockSize = 64 * 1024;
+
+  PooledSectionMemoryManager(SectionMemoryPool &Pool)
+      : Pool(Pool), CodeMem(SectionMemoryPool::AllocationPurpose::Code),
+        RWDataMem(SectionMemoryPool::AllocationPurpose::RWData),
+        RODataMem(SectionMemoryPool::AllocationPurpose::ROData) {}
+  ~PooledSectionMemoryManager() override;
+
+  /// \brief Allocates a memory block of (at least) the given size suitable for
+  /// executable code.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID,
+                               StringRef SectionName) override;
+
+  /// \brief Allocates a memory block of (at least) the given size suitable for
+  /// data.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID, StringRef SectionName,
+                               bool isReadOnly) override;
+
+  /// \brief Apply the final permissions to the sections allocated since the
+  /// last call, and invalidate the instruction cache for new code.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+  /// \brief Invalidate the instruction cache for code that has not been
+  /// finalized yet.
+  ///
+  /// This method is called from finalizeMemory.
+  virtual void invalidateInstructionCache();
+
+private:
+  struct MemoryGroup {
+    MemoryGroup(SectionMemoryPool::AllocationPurpose Purpose)
+        : Purpose(Purpose) {}
+
+    SectionMemoryPool::AllocationPurpose Purpose;
+    // Blocks obtained from the pool.
+    SmallVector<sys::MemoryBlock, 4> Blocks;
+    // Allocated sections that have not had their final permissions applied,
+    // one range per block.
+    SmallVector<sys::MemoryBlock, 4> PendingMem;
+    // The free tail of the last block, and the start of the allocations in it
+    // that are still pending.
+    uintptr_t Cur = 0, End = 0, PendingStart = 0;
+  };
+
+  uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
+                           unsigned Alignment);
+
+  void closePendingRange(MemoryGroup &MemGroup);
+
+  std::error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
+                                              unsigned Permissions);
+
+  SectionMemoryPool &Pool;
+  MemoryGroup CodeMem;
+  MemoryGroup RWDataMem;
+  MemoryGroup RODataMem;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
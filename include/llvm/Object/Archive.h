@@ -14,6 +14,7 @@
 #ifndef LLVM_OBJECT_ARCHIVE_H
 #define LLVM_OBJECT_ARCHIVE_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator_range.h"
@@ -22,6 +23,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include <mutex>
 
 namespace llvm {
 namespace object {
@@ -165,6 +167,7 @@ public:
   };
 
   class Symbol {
+    friend class Archive;
     const Archive *Parent;
     uint32_t SymbolIndex;
     uint32_t StringIndex; // Extra index to the string.
@@ -236,8 +239,10 @@ public:
     return v->isArchive();
   }
 
-  // check if a symbol is in the archive
-  Expected<Optional<Child>> findSym(StringRef name) const;
+  /// Return the member that defines the symbol Name, if any. The first call
+  /// builds a hash index over the archive symbol table, so later lookups
+  /// don't scan the whole table. Safe to call from several threads.
+  Expected<Optional<Child>> findSym(StringRef Name) const;
 
   bool isEmpty() const;
   bool hasSymbolTable() const;
@@ -257,6 +262,14 @@ private:
   uint16_t FirstRegularStartOfFile = -1;
   void setFirstRegular(const Child &C);
 
+  /// Maps each symbol name to the symbol and string indices of its first
+  /// entry in the symbol table. Built by the first call to findSym, under
+  /// SymbolMapMutex, and only read once SymbolMapBuilt is set.
+  mutable DenseMap<StringRef, std::pair<uint32_t, uint32_t>> SymbolMap;
+  mutable std::mutex SymbolMapMutex;
+  mutable bool SymbolMapBuilt = false;
+  void buildSymbolMap() const;
+
   unsigned Format : 3;
   unsigned IsThin : 1;
   mutable std::vector<std::unique_ptr<MemoryBuffer>> ThinBuffers;
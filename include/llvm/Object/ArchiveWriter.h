@@ -46,10 +46,13 @@ struct NewArchiveMember {
                                             bool Deterministic);
 };
 
+/// Write an archive. When writing a symbol table, the members' symbols are
+/// read on up to NumThreads threads.
 std::pair<StringRef, std::error_code>
 writeArchive(StringRef ArcName, std::vector<NewArchiveMember> &NewMembers,
              bool WriteSymtab, object::Archive::Kind Kind, bool Deterministic,
-             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr);
+             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr,
+             unsigned NumThreads = 1);
 }
 
 #endif
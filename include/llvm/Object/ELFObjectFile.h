@@ -205,6 +205,15 @@ protected:
   const Elf_Shdr *DotSymtabSec = nullptr; // Symbol table section.
   ArrayRef<Elf_Word> ShndxTable;
 
+  // The section indices and string tables of the symbol tables above, found
+  // once when the object is opened so that the symbol accessors don't look
+  // them up and validate them again for every symbol. A string table that is
+  // missing or malformed is left empty and diagnosed by getSymbolName.
+  unsigned DotDynSymIndex = 0, DotSymtabIndex = 0;
+  StringRef DotDynSymStrTab, DotSymtabStrTab;
+
+  const Elf_Shdr *getSymbolTable(DataRefImpl Symb) const;
+
   void moveSymbolNext(DataRefImpl &Symb) const override;
   Expected<StringRef> getSymbolName(DataRefImpl Symb) const override;
   Expected<uint64_t> getSymbolAddress(DataRefImpl Symb) const override;
@@ -311,7 +320,7 @@ public:
   const Elf_Rela *getRela(DataRefImpl Rela) const;
 
   const Elf_Sym *getSymbol(DataRefImpl Sym) const {
-    return EF.template getEntry<Elf_Sym>(Sym.d.a, Sym.d.b);
+    return EF.template getEntry<Elf_Sym>(getSymbolTable(Sym), Sym.d.b);
   }
 
   const Elf_Shdr *getSection(DataRefImpl Sec) const {
@@ -361,13 +370,32 @@ void ELFObjectFile<ELFT>::moveSymbolNext(DataRefImpl &Sym) const {
   ++Sym.d.b;
 }
 
+template <class ELFT>
+const typename ELFObjectFile<ELFT>::Elf_Shdr *
+ELFObjectFile<ELFT>::getSymbolTable(DataRefImpl Symb) const {
+  if (DotSymtabSec && Symb.d.a == DotSymtabIndex)
+    return DotSymtabSec;
+  if (DotDynSymSec && Symb.d.a == DotDynSymIndex)
+    return DotDynSymSec;
+  ErrorOr<const Elf_Shdr *> SymTabOrErr = EF.getSection(Symb.d.a);
+  if (std::error_code EC = SymTabOrErr.getError())
+    report_fatal_error(EC.message());
+  return *SymTabOrErr;
+}
+
 template <class ELFT>
 Expected<StringRef> ELFObjectFile<ELFT>::getSymbolName(DataRefImpl Sym) const {
   const Elf_Sym *ESym = getSymbol(Sym);
-  const Elf_Shdr *SymTableSec = *EF.getSection(Sym.d.a);
-  const Elf_Shdr *StringTableSec = *EF.getSection(SymTableSec->sh_link);
-  StringRef SymTable = *EF.getStringTable(StringTableSec);
-  return ESym->getName(SymTable);
+  if (DotSymtabSec && Sym.d.a == DotSymtabIndex && !DotSymtabStrTab.empty())
+    return ESym->getName(DotSymtabStrTab);
+  if (DotDynSymSec && Sym.d.a == DotDynSymIndex && !DotDynSymStrTab.empty())
+    return ESym->getName(DotDynSymStrTab);
+
+  ErrorOr<StringRef> StrTabOrErr =
+      EF.getStringTableForSymtab(*getSymbolTable(Sym));
+  if (std::error_code EC = StrTabOrErr.getError())
+    return errorCodeToError(EC);
+  return ESym->getName(*StrTabOrErr);
 }
 
 template <class ELFT>
@@ -409,7 +437,7 @@ ELFObjectFile<ELFT>::getSymbolAddress(DataRefImpl Symb) const {
   }
 
   const Elf_Ehdr *Header = EF.getHeader();
-  const Elf_Shdr *SymTab = *EF.getSection(Symb.d.a);
+  const Elf_Shdr *SymTab = getSymbolTable(Symb);
 
   if (Header->e_type == ELF::ET_REL) {
     ErrorOr<const Elf_Shdr *> SectionOrErr =
@@ -495,9 +523,12 @@ uint32_t ELFObjectFile<ELFT>::getSymbolFlags(DataRefImpl Sym) const {
   if (ESym->st_shndx == ELF::SHN_ABS)
     Result |= SymbolRef::SF_Absolute;
 
+  // The null symbol at index 0 of either symbol table.
+  bool IsNullSymbol =
+      Sym.d.b == 0 && ((DotSymtabSec && Sym.d.a == DotSymtabIndex) ||
+                       (DotDynSymSec && Sym.d.a == DotDynSymIndex));
   if (ESym->getType() == ELF::STT_FILE || ESym->getType() == ELF::STT_SECTION ||
-      ESym == EF.symbol_begin(DotSymtabSec) ||
-      ESym == EF.symbol_begin(DotDynSymSec))
+      IsNullSymbol)
     Result |= SymbolRef::SF_FormatSpecific;
 
   if (EF.getHeader()->e_machine == ELF::EM_ARM) {
@@ -549,9 +580,7 @@ ELFObjectFile<ELFT>::getSymbolSection(const Elf_Sym *ESym,
 template <class ELFT>
 Expected<section_iterator>
 ELFObjectFile<ELFT>::getSymbolSection(DataRefImpl Symb) const {
-  const Elf_Sym *Sym = getSymbol(Symb);
-  const Elf_Shdr *SymTab = *EF.getSection(Symb.d.a);
-  return getSymbolSection(Sym, SymTab);
+  return getSymbolSection(getSymbol(Symb), getSymbolTable(Symb));
 }
 
 template <class ELFT>
@@ -785,6 +814,19 @@ ELFObjectFile<ELFT>::ELFObjectFile(MemoryBufferRef Object, std::error_code &EC)
     }
     }
   }
+
+  if (DotDynSymSec) {
+    DotDynSymIndex = toDRI(DotDynSymSec, 0).d.a;
+    if (ErrorOr<StringRef> StrTabOrErr =
+            EF.getStringTableForSymtab(*DotDynSymSec))
+      DotDynSymStrTab = *StrTabOrErr;
+  }
+  if (DotSymtabSec) {
+    DotSymtabIndex = toDRI(DotSymtabSec, 0).d.a;
+    if (ErrorOr<StringRef> StrTabOrErr =
+            EF.getStringTableForSymtab(*DotSymtabSec))
+      DotSymtabStrTab = *StrTabOrErr;
+  }
 }
 
 template <class ELFT>
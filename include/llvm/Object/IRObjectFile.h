@@ -14,6 +14,7 @@
 #ifndef LLVM_OBJECT_IROBJECTFILE_H
 #define LLVM_OBJECT_IROBJECTFILE_H
 
+#include "llvm/Object/IRSymtab.h"
 #include "llvm/Object/SymbolicFile.h"
 
 namespace llvm {
@@ -29,9 +30,13 @@ class IRObjectFile : public SymbolicFile {
   std::unique_ptr<Module> M;
   std::unique_ptr<Mangler> Mang;
   std::vector<std::pair<std::string, uint32_t>> AsmSymbols;
+  /// The bitcode symbol table, used instead of M if the file was created
+  /// with createFromSymtab().
+  irsymtab::Reader Symtab;
 
 public:
   IRObjectFile(MemoryBufferRef Object, std::unique_ptr<Module> M);
+  IRObjectFile(MemoryBufferRef Object, irsymtab::Reader Symtab);
   ~IRObjectFile() override;
   void moveSymbolNext(DataRefImpl &Symb) const override;
   std::error_code printSymbolName(raw_ostream &OS,
@@ -44,10 +49,20 @@ public:
   basic_symbol_iterator symbol_begin_impl() const override;
   basic_symbol_iterator symbol_end_impl() const override;
 
+  /// Return false if the symbols come from the bitcode symbol table, in
+  /// which case there is no module, and getSymbolGV returns null.
+  bool hasModule() const { return M != nullptr; }
+
+  /// Return the symbol table entry for Symb. Requires !hasModule().
+  irsymtab::Reader::Symbol getSymtabSymbol(DataRefImpl Symb) const;
+
+  StringRef getTargetTriple() const;
+
   const Module &getModule() const {
     return const_cast<IRObjectFile*>(this)->getModule();
   }
   Module &getModule() {
+    assert(M && "No module for a file created from its symbol table");
     return *M;
   }
   std::unique_ptr<Module> takeModule();
@@ -77,6 +92,20 @@ public:
 
   static ErrorOr<std::unique_ptr<IRObjectFile>> create(MemoryBufferRef Object,
                                                        LLVMContext &Context);
+
+  /// Create an IRObjectFile whose symbols are read from the symbol table
+  /// block of the bitcode in Object, without loading its module. Fails with
+  /// object_error::invalid_file_type if the bitcode has no symbol table, in
+  /// which case the caller should use create() instead.
+  static Expected<std::unique_ptr<IRObjectFile>>
+  createFromSymtab(MemoryBufferRef Object);
+
+  /// Return the flags getSymbolFlags returns for the symbol of GV.
+  static uint32_t getGlobalValueFlags(const GlobalValue &GV);
+
+  /// Print the name printSymbolName prints for the symbol of GV.
+  static void printGlobalValueName(raw_ostream &OS, const GlobalValue &GV,
+                                   Mangler &Mang);
 };
 }
 }
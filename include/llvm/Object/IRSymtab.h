@@ -0,0 +1,170 @@
+//===- IRSymtab.h - data definitions for IR symbol tables -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains data definitions and a reader and builder for a symbol
+// table for LLVM IR. Its purpose is to allow tools such as llvm-nm and llvm-ar
+// to list the symbols of a bitcode file without loading its module.
+//
+// The symbol table is stored in the SYMTAB_BLOCK of the bitcode file, before
+// the module block, as a single blob. All fields are little-endian and the blob
+// has no alignment requirements; all offsets are relative to the start of the
+// blob, which also holds the string table.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_OBJECT_IRSYMTAB_H
+#define LLVM_OBJECT_IRSYMTAB_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace llvm {
+class Module;
+
+namespace irsymtab {
+namespace storage {
+
+typedef support::ulittle32_t Word;
+typedef support::ulittle64_t Word64;
+
+/// A reference to a string in the symbol table.
+struct Str {
+  Word Offset, Size;
+
+  StringRef get(StringRef Symtab) const {
+    return Symtab.substr(Offset, Size);
+  }
+};
+
+/// A reference to a range of objects in the symbol table.
+template <typename T> struct Range {
+  Word Offset, Size;
+
+  ArrayRef<T> get(StringRef Symtab) const {
+    return {reinterpret_cast<const T *>(Symtab.data() + Offset), Size};
+  }
+};
+
+struct Comdat {
+  Str Name;
+};
+
+struct Symbol {
+  /// The mangled name of the symbol, as IRObjectFile::printSymbolName prints
+  /// it.
+  Str Name;
+
+  /// The index into the comdat table of the symbol's comdat, or -1.
+  Word ComdatIndex;
+
+  /// These bits are part of the file format and are independent of the
+  /// in-memory BasicSymbolRef::Flags values; Reader::Symbol::getSymbolFlags
+  /// maps between the two.
+  enum FlagBits {
+    FB_visibility, // 2 bits
+    FB_function = FB_visibility + 2,
+    FB_alias,
+    FB_undefined,
+    FB_global,
+    FB_weak,
+    FB_common,
+    FB_hidden,
+    FB_const,
+    FB_format_specific,
+  };
+
+  Word Flags;
+
+  /// The size and alignment of a common symbol, zero otherwise.
+  Word64 CommonSize, CommonAlign;
+};
+
+struct Header {
+  /// The version of the symbol table format. A reader rejects tables with a
+  /// different version, and falls back to loading the module.
+  Word Version;
+  enum { kCurrentVersion = 2 };
+
+  Str TargetTriple, SourceFileName;
+  Range<Comdat> Comdats;
+  Range<Symbol> Symbols;
+};
+
+} // end namespace storage
+
+/// Build the symbol table for M into Symtab. Returns false if the table can't
+/// be built without parsing M's module-level inline asm, in which case
+/// readers must load the module to list its symbols.
+bool build(const Module &M, SmallVectorImpl<char> &Symtab);
+
+/// Return the symbol table blob stored in the bitcode file Buffer, or an
+/// empty string if it has none.
+Expected<StringRef> findSymtab(MemoryBufferRef Buffer);
+
+/// A reader for a symbol table built by build().
+class Reader {
+  StringRef Symtab;
+  const storage::Header *Header = nullptr;
+  ArrayRef<storage::Comdat> Comdats;
+  ArrayRef<storage::Symbol> Symbols;
+
+public:
+  class Symbol {
+    const Reader *R;
+    const storage::Symbol *S;
+
+  public:
+    Symbol(const Reader *R, const storage::Symbol *S) : R(R), S(S) {}
+
+    StringRef getName() const { return S->Name.get(R->Symtab); }
+    /// Return the symbol's BasicSymbolRef::Flags, as
+    /// IRObjectFile::getGlobalValueFlags computes them.
+    uint32_t getSymbolFlags() const;
+    GlobalValue::VisibilityTypes getVisibility() const {
+      return GlobalValue::VisibilityTypes(
+          (S->Flags >> storage::Symbol::FB_visibility) & 3);
+    }
+    bool isFunction() const {
+      return (S->Flags >> storage::Symbol::FB_function) & 1;
+    }
+    bool isAlias() const { return (S->Flags >> storage::Symbol::FB_alias) & 1; }
+    /// Return the index of the symbol's comdat, or -1.
+    int getComdatIndex() const { return S->ComdatIndex; }
+    uint64_t getCommonSize() const { return S->CommonSize; }
+    uint64_t getCommonAlignment() const { return S->CommonAlign; }
+  };
+
+  Reader() = default;
+
+  /// Create a reader for Symtab, checking that it is well formed.
+  static Expected<Reader> create(StringRef Symtab);
+
+  size_t getNumSymbols() const { return Symbols.size(); }
+  Symbol getSymbol(size_t I) const { return Symbol(this, &Symbols[I]); }
+
+  StringRef getTargetTriple() const {
+    return Header->TargetTriple.get(Symtab);
+  }
+  StringRef getSourceFileName() const {
+    return Header->SourceFileName.get(Symtab);
+  }
+  size_t getNumComdats() const { return Comdats.size(); }
+  StringRef getComdatName(size_t I) const {
+    return Comdats[I].Name.get(Symtab);
+  }
+};
+
+} // end namespace irsymtab
+} // end namespace llvm
+
+#endif
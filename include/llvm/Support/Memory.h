@@ -109,6 +109,17 @@ namespace sys {
     static std::error_code protectMappedMemory(const MemoryBlock &Block,
                                                unsigned Flags);
 
+    /// This method advises the operating system that \p Block, which must
+    /// have been allocated using the allocateMappedMemory method, should be
+    /// backed by large (e.g. transparent huge) pages where possible. This is
+    /// only a hint: it has no effect on platforms without such a facility.
+    ///
+    /// \r error_success if the hint was accepted or is not supported, or an
+    /// error_code describing the failure if an error occurred.
+    ///
+    /// @brief Request large page backing.
+    static std::error_code adviseHugePages(const MemoryBlock &Block);
+
     /// This method allocates a block of Read/Write/Execute memory that is
     /// suitable for executing dynamically generated code (e.g. JIT). An
     /// attempt to allocate \p NumBytes bytes of virtual memory is made.
@@ -28,6 +28,7 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/UseListOrder.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Object/IRSymtab.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
@@ -116,6 +117,9 @@ class ModuleBitcodeWriter : public BitcodeWriter {
   /// True if a module hash record should be written.
   bool GenerateHash;
 
+  /// True if a symbol table block should be written before the module.
+  bool GenerateSymtab;
+
   /// The start bit of the module block, for use in generating a module hash
   uint64_t BitcodeStartBit = 0;
 
@@ -132,9 +136,11 @@ public:
   /// writing to the provided \p Buffer.
   ModuleBitcodeWriter(const Module *M, SmallVectorImpl<char> &Buffer,
                       bool ShouldPreserveUseListOrder,
-                      const ModuleSummaryIndex *Index, bool GenerateHash)
+                      const ModuleSummaryIndex *Index, bool GenerateHash,
+                      bool GenerateSymtab)
       : BitcodeWriter(Buffer), M(*M), VE(*M, ShouldPreserveUseListOrder),
-        Index(Index), GenerateHash(GenerateHash) {
+        Index(Index), GenerateHash(GenerateHash),
+        GenerateSymtab(GenerateSymtab) {
     // Save the start bit of the actual bitcode, in case there is space
     // saved at the start for the darwin header above. The reader stream
     // will start at the bitcode, and we need the offset of the VST
@@ -174,6 +180,10 @@ private:
   /// Emit the current module to the bitstream.
   void writeModule();
 
+  /// Emit the "SYMTAB_BLOCK_ID" holding the module's symbol table, unless it
+  /// can't be built without parsing inline asm.
+  void writeSymtab();
+
   uint64_t bitcodeStartBit() { return BitcodeStartBit; }
 
   void writeStringRecord(unsigned Code, StringRef Str, unsigned AbbrevToUse);
@@ -3636,9 +3646,27 @@ void BitcodeWriter::write() {
 
 void ModuleBitcodeWriter::writeBlocks() {
   writeIdentificationBlock();
+  if (GenerateSymtab)
+    writeSymtab();
   writeModule();
 }
 
+void ModuleBitcodeWriter::writeSymtab() {
+  SmallVector<char, 0> Symtab;
+  if (!irsymtab::build(M, Symtab))
+    return;
+
+  Stream.EnterSubblock(bitc::SYMTAB_BLOCK_ID, 3);
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::SYMTAB_BLOB));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+  unsigned BlobAbbrev = Stream.EmitAbbrev(Abbv);
+  SmallVector<uint64_t, 1> Vals = {bitc::SYMTAB_BLOB};
+  Stream.EmitRecordWithBlob(BlobAbbrev, Vals,
+                            StringRef(Symtab.data(), Symtab.size()));
+  Stream.ExitBlock();
+}
+
 void IndexBitcodeWriter::writeBlocks() {
   // Index contains only a single outer (module) block.
   writeIndex();
@@ -3788,7 +3816,7 @@ void BitcodeWriter::writeBitcodeHeader() {
 void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
                               bool ShouldPreserveUseListOrder,
                               const ModuleSummaryIndex *Index,
-                              bool GenerateHash) {
+                              bool GenerateHash, bool GenerateSymtab) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -3800,7 +3828,7 @@ void llvm::WriteBitcodeToFile(const Module *M, raw_ostream &Out,
 
   // Emit the module into the buffer.
   ModuleBitcodeWriter ModuleWriter(M, Buffer, ShouldPreserveUseListOrder, Index,
-                                   GenerateHash);
+                                   GenerateHash, GenerateSymtab);
   ModuleWriter.write();
 
   if (TT.isOSDarwin() || TT.isOSBinFormatMachO())
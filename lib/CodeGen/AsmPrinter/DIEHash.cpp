@@ -273,7 +273,15 @@ void DIEHash::hashLocList(const DIELocList &LocList) {
   HashingByteStreamer Streamer(*this);
   DwarfDebug &DD = *AP->getDwarfDebug();
   const DebugLocStream &Locs = DD.getDebugLocs();
-  for (const auto &Entry : Locs.getEntries(Locs.getList(LocList.getValue())))
+  // If the list has already been emitted, only its bytes are left, which is
+  // all that emitDebugLocEntry hashes.
+  const DebugLocStream::List &List = Locs.getList(LocList.getValue());
+  if (Locs.isDropped(LocList.getValue())) {
+    for (uint8_t Byte : Locs.getDroppedBytes(List))
+      Streamer.EmitInt8(Byte, "");
+    return;
+  }
+  for (const auto &Entry : Locs.getEntries(List))
     DD.emitDebugLocEntry(Streamer, Entry);
 }
 
@@ -38,6 +38,22 @@ void DebugLocStream::finalizeEntry() {
          "Popped off more entries than are in the list");
 }
 
+void DebugLocStream::dropEntries() {
+  for (size_t LI = NumDroppedLists, LE = Lists.size(); LI != LE; ++LI) {
+    List &L = Lists[LI];
+    L.DroppedByteOffset = DroppedBytes.size();
+    for (const Entry &E : getEntries(L)) {
+      ArrayRef<char> Bytes = getBytes(E);
+      DroppedBytes.append(Bytes.begin(), Bytes.end());
+    }
+    L.NumDroppedBytes = DroppedBytes.size() - L.DroppedByteOffset;
+  }
+  NumDroppedLists = Lists.size();
+  Entries.clear();
+  DWARFBytes.clear();
+  Comments.clear();
+}
+
 DebugLocStream::ListBuilder::~ListBuilder() {
   if (!Locs.finalizeList(Asm))
     return;
@@ -35,6 +35,10 @@ public:
     DwarfCompileUnit *CU;
     MCSymbol *Label = nullptr;
     size_t EntryOffset;
+    /// Once the entries have been dropped, where their bytes are kept in
+    /// DroppedBytes, for hashing the unit that refers to the list.
+    size_t DroppedByteOffset = 0;
+    size_t NumDroppedBytes = 0;
     List(DwarfCompileUnit *CU, size_t EntryOffset)
         : CU(CU), EntryOffset(EntryOffset) {}
   };
@@ -55,6 +59,11 @@ private:
   SmallString<256> DWARFBytes;
   SmallVector<std::string, 32> Comments;
 
+  /// The number of lists whose entries have been dropped, and the bytes of
+  /// those lists, one after the other.
+  size_t NumDroppedLists = 0;
+  SmallString<256> DroppedBytes;
+
   /// \brief Only verbose textual output needs comments.  This will be set to
   /// true for that case, and false otherwise.
   bool GenerateComments;
@@ -65,6 +74,28 @@ public:
   const List &getList(size_t LI) const { return Lists[LI]; }
   ArrayRef<List> getLists() const { return Lists; }
 
+  /// Return the lists whose entries haven't been dropped.
+  ArrayRef<List> getPendingLists() const {
+    return makeArrayRef(Lists).drop_front(NumDroppedLists);
+  }
+
+  /// Return true if the entries of the list at index \p LI were dropped.
+  bool isDropped(size_t LI) const { return LI < NumDroppedLists; }
+
+  /// \brief Drop the entries of all the lists.
+  ///
+  /// Once the pending lists have been emitted, only their labels are needed,
+  /// so their entries and comments can go.  The bytes of each list are kept
+  /// (see \a getDroppedBytes()), so that the unit's hash doesn't change.
+  void dropEntries();
+
+  /// Return the bytes of the entries of a dropped list, concatenated.
+  ArrayRef<char> getDroppedBytes(const List &L) const {
+    assert(isDropped(getIndex(L)) && "Entries weren't dropped");
+    return makeArrayRef(DroppedBytes.begin(), DroppedBytes.end())
+        .slice(L.DroppedByteOffset, L.NumDroppedBytes);
+  }
+
   class ListBuilder;
   class EntryBuilder;
 
@@ -107,6 +138,7 @@ public:
 
   ArrayRef<Entry> getEntries(const List &L) const {
     size_t LI = getIndex(L);
+    assert(!isDropped(LI) && "Entries were dropped");
     return makeArrayRef(Entries)
         .slice(Lists[LI].EntryOffset, getNumEntries(LI));
   }
@@ -77,6 +77,12 @@ static cl::opt<bool> GenerateARangeSection("generate-arange-section",
                                            cl::desc("Generate dwarf aranges"),
                                            cl::init(false));
 
+static cl::opt<bool> SplitDwarfIncrementalLoc(
+    "split-dwarf-incremental-loc", cl::Hidden,
+    cl::desc("Emit the .debug_loc.dwo lists of each function as soon as the "
+             "function is finished, rather than at the end of the module"),
+    cl::init(false));
+
 namespace {
 enum DefaultOnOff { Default, Enable, Disable };
 }
@@ -1168,6 +1174,18 @@ void DwarfDebug::endFunction(const MachineFunction *MF) {
         TheCU.getCUNode()->getSplitDebugInlining())
       SkelCU->constructSubprogramScopeDIE(FnScope);
 
+  // With split DWARF, location list entries use address pool indices rather
+  // than offsets from the unit's base address, so they are final as soon as
+  // the function is, and can be emitted and dropped now instead of being kept
+  // for the whole module.
+  if (useSplitDwarf() && SplitDwarfIncrementalLoc &&
+      !DebugLocs.getPendingLists().empty()) {
+    Asm->OutStreamer->PushSection();
+    emitDebugLocDWO();
+    Asm->OutStreamer->PopSection();
+    DebugLocs.dropEntries();
+  }
+
   // Clear debug info
   // Ownership of DbgVariables is a bit subtle - ScopeVariables owns all the
   // DbgVariables except those that are also in AbstractVariables (since they
@@ -1516,7 +1534,7 @@ void DwarfDebug::emitDebugLoc() {
 void DwarfDebug::emitDebugLocDWO() {
   Asm->OutStreamer->SwitchSection(
       Asm->getObjFileLowering().getDwarfLocDWOSection());
-  for (const auto &List : DebugLocs.getLists()) {
+  for (const auto &List : DebugLocs.getPendingLists()) {
     Asm->OutStreamer->EmitLabel(List.Label);
     for (const auto &Entry : DebugLocs.getEntries(List)) {
       // Just always use start_length for now - at least that's one address
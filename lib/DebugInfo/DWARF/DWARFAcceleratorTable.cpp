@@ -129,4 +129,71 @@ void DWARFAcceleratorTable::dump(raw_ostream &OS) const {
     }
   }
 }
+
+// The hash function used by the Apple accelerator tables (Bernstein's hash).
+static uint32_t djbHash(StringRef Str) {
+  uint32_t H = 5381;
+  for (unsigned char C : Str)
+    H = H * 33 + C;
+  return H;
+}
+
+void DWARFAcceleratorTable::lookup(
+    StringRef Key, SmallVectorImpl<uint32_t> &DIEOffsets) const {
+  if (Hdr.HashFunction != dwarf::DW_hash_function_djb || !Hdr.NumBuckets)
+    return;
+  bool HasDIEOffset = false;
+  SmallVector<DWARFFormValue, 3> AtomForms;
+  for (const auto &Atom : HdrData.Atoms) {
+    HasDIEOffset |= Atom.first == dwarf::DW_ATOM_die_offset;
+    AtomForms.push_back(DWARFFormValue(Atom.second));
+  }
+  if (!HasDIEOffset)
+    return;
+
+  uint32_t HashValue = djbHash(Key);
+  unsigned Bucket = HashValue % Hdr.NumBuckets;
+  uint32_t Offset = sizeof(Hdr) + Hdr.HeaderDataLength + Bucket * 4;
+  unsigned HashesBase = sizeof(Hdr) + Hdr.HeaderDataLength + Hdr.NumBuckets * 4;
+  unsigned OffsetsBase = HashesBase + Hdr.NumHashes * 4;
+
+  unsigned Index = AccelSection.getU32(&Offset);
+  if (Index == UINT32_MAX)
+    return;
+
+  // The hashes in a bucket are contiguous; several names can share a hash.
+  for (unsigned HashIdx = Index; HashIdx < Hdr.NumHashes; ++HashIdx) {
+    unsigned HashOffset = HashesBase + HashIdx*4;
+    unsigned OffsetsOffset = OffsetsBase + HashIdx*4;
+    uint32_t Hash = AccelSection.getU32(&HashOffset);
+    if (Hash % Hdr.NumBuckets != Bucket)
+      break;
+    if (Hash != HashValue)
+      continue;
+
+    unsigned DataOffset = AccelSection.getU32(&OffsetsOffset);
+    while (AccelSection.isValidOffsetForDataOfSize(DataOffset, 4)) {
+      unsigned StringOffset = AccelSection.getU32(&DataOffset);
+      RelocAddrMap::const_iterator Reloc = Relocs.find(DataOffset-4);
+      if (Reloc != Relocs.end())
+        StringOffset += Reloc->second.second;
+      if (!StringOffset)
+        break;
+      const char *Name = StringSection.getCStr(&StringOffset);
+      bool Matches = Name && Key == Name;
+      unsigned NumData = AccelSection.getU32(&DataOffset);
+      for (unsigned Data = 0; Data < NumData; ++Data) {
+        for (unsigned i = 0, e = AtomForms.size(); i != e; ++i) {
+          DWARFFormValue &Atom = AtomForms[i];
+          if (!Atom.extractValue(AccelSection, &DataOffset, nullptr))
+            return;
+          if (!Matches || HdrData.Atoms[i].first != dwarf::DW_ATOM_die_offset)
+            continue;
+          if (Optional<uint64_t> DIEOffset = Atom.getAsUnsignedConstant())
+            DIEOffsets.push_back(HdrData.DIEOffsetBase + *DIEOffset);
+        }
+      }
+    }
+  }
+}
 }
@@ -20,6 +20,7 @@
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
@@ -426,7 +427,7 @@ DWARFContext::getLineTableForUnit(DWARFUnit *U) {
   // We have to parse it first.
   DataExtractor lineData(U->getLineSection(), isLittleEndian(),
                          U->getAddressByteSize());
-  return Line->getOrParseLineTable(lineData, stmtOffset);
+  return Line->getOrParseLineTable(lineData, stmtOffset, LazyLineTables);
 }
 
 void DWARFContext::parseCompileUnits() {
@@ -455,6 +456,32 @@ void DWARFContext::parseDWOTypeUnits() {
   }
 }
 
+void DWARFContext::extractAllUnitDIEs(ThreadPool &Pool) {
+  // Parse the unit headers first: that fills in the unit lists, and the
+  // abbreviations they share, which must not happen concurrently.
+  std::vector<DWARFUnit *> Units;
+  for (const auto &CU : compile_units())
+    Units.push_back(CU.get());
+  for (const auto &TUS : type_unit_sections())
+    for (const auto &TU : TUS)
+      Units.push_back(TU.get());
+  for (const auto &DWOCU : dwo_compile_units())
+    Units.push_back(DWOCU.get());
+  for (const auto &DWOTUS : dwo_type_unit_sections())
+    for (const auto &DWOTU : DWOTUS)
+      Units.push_back(DWOTU.get());
+
+  // From here on each unit only writes its own DIE array, and only reads
+  // section data and abbreviations, so units can be extracted in parallel.
+  // Wait on our own tasks only, in case Pool is shared with other work.
+  std::vector<std::shared_future<ThreadPool::VoidTy>> Extracted;
+  Extracted.reserve(Units.size());
+  for (DWARFUnit *U : Units)
+    Extracted.push_back(Pool.async([U]() { U->getUnitDIE(false); }));
+  for (auto &F : Extracted)
+    F.wait();
+}
+
 DWARFCompileUnit *DWARFContext::getCompileUnitForOffset(uint32_t Offset) {
   parseCompileUnits();
   return CUs.getUnitForOffset(Offset);
@@ -533,7 +560,7 @@ DWARFContext::getLineInfoForAddressRange(uint64_t Address, uint64_t Size,
 
   for (uint32_t RowIndex : RowVector) {
     // Take file number and line/column from the row.
-    const DWARFDebugLine::Row &Row = LineTable->Rows[RowIndex];
+    DWARFDebugLine::Row Row = LineTable->getRow(RowIndex);
     DILineInfo Result;
     LineTable->getFileNameByIndex(Row.File, CU->getCompilationDir(),
                                   Spec.FLIKind, Result.FileName);
@@ -9,10 +9,13 @@
 
 #include "llvm/DebugInfo/DWARF/DWARFDebugLine.h"
 #include "llvm/Support/Dwarf.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <tuple>
+#include <utility>
 using namespace llvm;
 using namespace dwarf;
 typedef DILineInfoSpecifier::FileLineInfoKind FileLineInfoKind;
@@ -167,10 +170,13 @@ void DWARFDebugLine::Sequence::reset() {
   HighPC = 0;
   FirstRowIndex = 0;
   LastRowIndex = 0;
+  ProgramOffset = 0;
   Empty = true;
 }
 
-DWARFDebugLine::LineTable::LineTable() { clear(); }
+DWARFDebugLine::LineTable::LineTable() : LineData(StringRef(), true, 0) {
+  clear();
+}
 
 void DWARFDebugLine::LineTable::dump(raw_ostream &OS) const {
   Prologue.dump(OS);
@@ -190,10 +196,24 @@ void DWARFDebugLine::LineTable::clear() {
   Prologue.clear();
   Rows.clear();
   Sequences.clear();
+  NumRows = 0;
+  Lazy = false;
+  RelocMap = nullptr;
+  ProgramEndOffset = 0;
+  RowSequences.clear();
+  DecodedSequences.clear();
 }
 
 DWARFDebugLine::ParsingState::ParsingState(struct LineTable *LT)
-    : LineTable(LT), RowNumber(0) {
+    : LineTable(LT), Target(LT), Rows(LT->isLazy() ? nullptr : &LT->Rows),
+      AllSequences(nullptr), RowNumber(0), SequenceOffset(0), Done(false) {
+  resetRowAndSequence();
+}
+
+DWARFDebugLine::ParsingState::ParsingState(const struct LineTable *LT,
+                                           std::vector<struct Row> &SeqRows)
+    : LineTable(LT), Target(nullptr), Rows(&SeqRows), AllSequences(nullptr),
+      RowNumber(0), SequenceOffset(0), Done(false) {
   resetRowAndSequence();
 }
 
@@ -208,16 +228,24 @@ void DWARFDebugLine::ParsingState::appendRowToMatrix(uint32_t offset) {
     Sequence.Empty = false;
     Sequence.LowPC = Row.Address;
     Sequence.FirstRowIndex = RowNumber;
+    Sequence.ProgramOffset = SequenceOffset;
   }
   ++RowNumber;
-  LineTable->appendRow(Row);
+  if (Rows)
+    Rows->push_back(Row);
   if (Row.EndSequence) {
     // Record the end of instruction sequence.
     Sequence.HighPC = Row.Address;
     Sequence.LastRowIndex = RowNumber;
-    if (Sequence.isValid())
-      LineTable->appendSequence(Sequence);
+    if (AllSequences)
+      AllSequences->push_back(Sequence);
+    if (!Target)
+      Done = true;
+    else if (Sequence.isValid())
+      Target->appendSequence(Sequence);
     Sequence.reset();
+    // The next sequence starts after this opcode.
+    SequenceOffset = offset;
   }
   Row.postAppend();
 }
@@ -232,12 +260,16 @@ DWARFDebugLine::getLineTable(uint32_t offset) const {
 
 const DWARFDebugLine::LineTable *
 DWARFDebugLine::getOrParseLineTable(DataExtractor debug_line_data,
-                                    uint32_t offset) {
+                                    uint32_t offset, bool Lazy) {
+  // Tables hold a mutex, so they're constructed in place.
   std::pair<LineTableIter, bool> pos =
-      LineTableMap.insert(LineTableMapTy::value_type(offset, LineTable()));
+      LineTableMap.emplace(std::piecewise_construct,
+                           std::forward_as_tuple(offset),
+                           std::forward_as_tuple());
   LineTable *LT = &pos.first->second;
   if (pos.second) {
-    if (!LT->parse(debug_line_data, RelocMap, &offset))
+    if (!(Lazy ? LT->parseLazily(debug_line_data, RelocMap, &offset)
+               : LT->parse(debug_line_data, RelocMap, &offset)))
       return nullptr;
   }
   return LT;
@@ -246,6 +278,18 @@ DWARFDebugLine::getOrParseLineTable(DataExtractor debug_line_data,
 bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
                                       const RelocAddrMap *RMap,
                                       uint32_t *offset_ptr) {
+  return parseImpl(debug_line_data, RMap, offset_ptr, false);
+}
+
+bool DWARFDebugLine::LineTable::parseLazily(DataExtractor debug_line_data,
+                                            const RelocAddrMap *RMap,
+                                            uint32_t *offset_ptr) {
+  return parseImpl(debug_line_data, RMap, offset_ptr, true);
+}
+
+bool DWARFDebugLine::LineTable::parseImpl(DataExtractor debug_line_data,
+                                          const RelocAddrMap *RMap,
+                                          uint32_t *offset_ptr, bool Lazy) {
   const uint32_t debug_line_offset = *offset_ptr;
 
   clear();
@@ -259,9 +303,51 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
   const uint32_t end_offset =
       debug_line_offset + Prologue.TotalLength + Prologue.sizeofTotalLength();
 
+  this->Lazy = Lazy;
   ParsingState State(this);
+  State.SequenceOffset = *offset_ptr;
+  if (Lazy)
+    State.AllSequences = &RowSequences;
+  State.run(debug_line_data, RMap, offset_ptr, end_offset);
+  NumRows = State.RowNumber;
+
+  if (!State.Sequence.Empty) {
+    fprintf(stderr, "warning: last sequence in debug line table is not"
+                    "terminated!\n");
+    // Its rows run up to the end of the program.
+    if (Lazy) {
+      State.Sequence.LastRowIndex = NumRows;
+      RowSequences.push_back(State.Sequence);
+    }
+  }
+
+  if (Lazy) {
+    LineData = debug_line_data;
+    RelocMap = RMap;
+    ProgramEndOffset = end_offset;
+  }
+
+  // Sort all sequences so that address lookup will work faster.
+  if (!Sequences.empty()) {
+    std::sort(Sequences.begin(), Sequences.end(), Sequence::orderByLowPC);
+    // Note: actually, instruction address ranges of sequences should not
+    // overlap (in shared objects and executables). If they do, the address
+    // lookup would still work, though, but result would be ambiguous.
+    // We don't report warning in this case. For example,
+    // sometimes .so compiled from multiple object files contains a few
+    // rudimentary sequences for address ranges [0x0, 0xsomething).
+  }
+
+  return end_offset;
+}
+
+void DWARFDebugLine::ParsingState::run(DataExtractor debug_line_data,
+                                       const RelocAddrMap *RMap,
+                                       uint32_t *offset_ptr,
+                                       uint32_t end_offset) {
+  const struct Prologue &Prologue = LineTable->Prologue;
 
-  while (*offset_ptr < end_offset) {
+  while (*offset_ptr < end_offset && !Done) {
     uint8_t opcode = debug_line_data.getU8(offset_ptr);
 
     if (opcode == 0) {
@@ -281,9 +367,9 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
         // with a DW_LNE_end_sequence instruction which creates a row whose
         // address is that of the byte after the last target machine instruction
         // of the sequence.
-        State.Row.EndSequence = true;
-        State.appendRowToMatrix(*offset_ptr);
-        State.resetRowAndSequence();
+        Row.EndSequence = true;
+        appendRowToMatrix(*offset_ptr);
+        resetRowAndSequence();
         break;
 
       case DW_LNE_set_address:
@@ -298,10 +384,9 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
           RelocAddrMap::const_iterator AI = RMap->find(*offset_ptr);
           if (AI != RMap->end()) {
             const std::pair<uint8_t, int64_t> &R = AI->second;
-            State.Row.Address =
-                debug_line_data.getAddress(offset_ptr) + R.second;
+            Row.Address = debug_line_data.getAddress(offset_ptr) + R.second;
           } else
-            State.Row.Address = debug_line_data.getAddress(offset_ptr);
+            Row.Address = debug_line_data.getAddress(offset_ptr);
         }
         break;
 
@@ -332,12 +417,14 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
           fileEntry.DirIdx = debug_line_data.getULEB128(offset_ptr);
           fileEntry.ModTime = debug_line_data.getULEB128(offset_ptr);
           fileEntry.Length = debug_line_data.getULEB128(offset_ptr);
-          Prologue.FileNames.push_back(fileEntry);
+          // The file names of a table are complete once it's parsed.
+          if (Target)
+            Target->Prologue.FileNames.push_back(fileEntry);
         }
         break;
 
       case DW_LNE_set_discriminator:
-        State.Row.Discriminator = debug_line_data.getULEB128(offset_ptr);
+        Row.Discriminator = debug_line_data.getULEB128(offset_ptr);
         break;
 
       default:
@@ -353,45 +440,45 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
         // Takes no arguments. Append a row to the matrix using the
         // current values of the state-machine registers. Then set
         // the basic_block register to false.
-        State.appendRowToMatrix(*offset_ptr);
+        appendRowToMatrix(*offset_ptr);
         break;
 
       case DW_LNS_advance_pc:
         // Takes a single unsigned LEB128 operand, multiplies it by the
         // min_inst_length field of the prologue, and adds the
         // result to the address register of the state machine.
-        State.Row.Address +=
+        Row.Address +=
             debug_line_data.getULEB128(offset_ptr) * Prologue.MinInstLength;
         break;
 
       case DW_LNS_advance_line:
         // Takes a single signed LEB128 operand and adds that value to
         // the line register of the state machine.
-        State.Row.Line += debug_line_data.getSLEB128(offset_ptr);
+        Row.Line += debug_line_data.getSLEB128(offset_ptr);
         break;
 
       case DW_LNS_set_file:
         // Takes a single unsigned LEB128 operand and stores it in the file
         // register of the state machine.
-        State.Row.File = debug_line_data.getULEB128(offset_ptr);
+        Row.File = debug_line_data.getULEB128(offset_ptr);
         break;
 
       case DW_LNS_set_column:
         // Takes a single unsigned LEB128 operand and stores it in the
         // column register of the state machine.
-        State.Row.Column = debug_line_data.getULEB128(offset_ptr);
+        Row.Column = debug_line_data.getULEB128(offset_ptr);
         break;
 
       case DW_LNS_negate_stmt:
         // Takes no arguments. Set the is_stmt register of the state
         // machine to the logical negation of its current value.
-        State.Row.IsStmt = !State.Row.IsStmt;
+        Row.IsStmt = !Row.IsStmt;
         break;
 
       case DW_LNS_set_basic_block:
         // Takes no arguments. Set the basic_block register of the
         // state machine to true
-        State.Row.BasicBlock = true;
+        Row.BasicBlock = true;
         break;
 
       case DW_LNS_const_add_pc:
@@ -410,7 +497,7 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
           uint8_t adjust_opcode = 255 - Prologue.OpcodeBase;
           uint64_t addr_offset =
               (adjust_opcode / Prologue.LineRange) * Prologue.MinInstLength;
-          State.Row.Address += addr_offset;
+          Row.Address += addr_offset;
         }
         break;
 
@@ -424,25 +511,25 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
         // judge when the computation of a special opcode overflows and
         // requires the use of DW_LNS_advance_pc. Such assemblers, however,
         // can use DW_LNS_fixed_advance_pc instead, sacrificing compression.
-        State.Row.Address += debug_line_data.getU16(offset_ptr);
+        Row.Address += debug_line_data.getU16(offset_ptr);
         break;
 
       case DW_LNS_set_prologue_end:
         // Takes no arguments. Set the prologue_end register of the
         // state machine to true
-        State.Row.PrologueEnd = true;
+        Row.PrologueEnd = true;
         break;
 
       case DW_LNS_set_epilogue_begin:
         // Takes no arguments. Set the basic_block register of the
         // state machine to true
-        State.Row.EpilogueBegin = true;
+        Row.EpilogueBegin = true;
         break;
 
       case DW_LNS_set_isa:
         // Takes a single unsigned LEB128 operand and stores it in the
         // column register of the state machine.
-        State.Row.Isa = debug_line_data.getULEB128(offset_ptr);
+        Row.Isa = debug_line_data.getULEB128(offset_ptr);
         break;
 
       default:
@@ -496,31 +583,64 @@ bool DWARFDebugLine::LineTable::parse(DataExtractor debug_line_data,
           (adjust_opcode / Prologue.LineRange) * Prologue.MinInstLength;
       int32_t line_offset =
           Prologue.LineBase + (adjust_opcode % Prologue.LineRange);
-      State.Row.Line += line_offset;
-      State.Row.Address += addr_offset;
-      State.appendRowToMatrix(*offset_ptr);
+      Row.Line += line_offset;
+      Row.Address += addr_offset;
+      appendRowToMatrix(*offset_ptr);
       // Reset discriminator to 0.
-      State.Row.Discriminator = 0;
+      Row.Discriminator = 0;
     }
   }
+}
 
-  if (!State.Sequence.Empty) {
-    fprintf(stderr, "warning: last sequence in debug line table is not"
-                    "terminated!\n");
-  }
+std::shared_ptr<const DWARFDebugLine::Row>
+DWARFDebugLine::LineTable::getSequenceRows(
+    const DWARFDebugLine::Sequence &seq) const {
+  // Eager rows live as long as the table, so the pointer owns nothing.
+  if (!Lazy)
+    return std::shared_ptr<const Row>(std::shared_ptr<const Row>(),
+                                      Rows.data() + seq.FirstRowIndex);
+
+  std::lock_guard<std::mutex> Lock(DecodedSequencesMutex);
+  for (const auto &Decoded : DecodedSequences)
+    if (Decoded.first == seq.FirstRowIndex)
+      return std::shared_ptr<const Row>(Decoded.second,
+                                        Decoded.second->data());
+
+  auto SeqRows = std::make_shared<RowVector>();
+  SeqRows->reserve(seq.LastRowIndex - seq.FirstRowIndex);
+  ParsingState State(this, *SeqRows);
+  uint32_t Offset = seq.ProgramOffset;
+  State.run(LineData, RelocMap, &Offset, ProgramEndOffset);
+  if (SeqRows->size() != seq.LastRowIndex - seq.FirstRowIndex)
+    return nullptr;
+
+  // Evicting a sequence doesn't free rows that a caller still holds.
+  if (DecodedSequences.size() == MaxDecodedSequences)
+    DecodedSequences.erase(DecodedSequences.begin());
+  DecodedSequences.emplace_back(seq.FirstRowIndex, SeqRows);
+  return std::shared_ptr<const Row>(SeqRows, SeqRows->data());
+}
 
-  // Sort all sequences so that address lookup will work faster.
-  if (!Sequences.empty()) {
-    std::sort(Sequences.begin(), Sequences.end(), Sequence::orderByLowPC);
-    // Note: actually, instruction address ranges of sequences should not
-    // overlap (in shared objects and executables). If they do, the address
-    // lookup would still work, though, but result would be ambiguous.
-    // We don't report warning in this case. For example,
-    // sometimes .so compiled from multiple object files contains a few
-    // rudimentary sequences for address ranges [0x0, 0xsomething).
+DWARFDebugLine::Row DWARFDebugLine::LineTable::getRow(uint32_t Index) const {
+  if (!Lazy)
+    return Rows[Index];
+
+  // Find the sequence holding the row. Every row is in one of RowSequences,
+  // which are in row order.
+  assert(Index < NumRows && "Row index out of range");
+  auto It = std::upper_bound(RowSequences.begin(), RowSequences.end(), Index,
+                             [](uint32_t I, const Sequence &Seq) {
+                               return I < Seq.FirstRowIndex;
+                             });
+  if (It != RowSequences.begin()) {
+    const Sequence &Seq = *std::prev(It);
+    if (Index < Seq.LastRowIndex)
+      if (std::shared_ptr<const Row> SeqRows = getSequenceRows(Seq))
+        return SeqRows.get()[Index - Seq.FirstRowIndex];
   }
-
-  return end_offset;
+  Row Unknown;
+  Unknown.Line = 0;
+  return Unknown;
 }
 
 uint32_t
@@ -529,13 +649,17 @@ DWARFDebugLine::LineTable::findRowInSeq(const DWARFDebugLine::Sequence &seq,
   if (!seq.containsPC(address))
     return UnknownRowIndex;
   // Search for instruction address in the rows describing the sequence.
-  // Rows are stored in a vector, so we may use arithmetical operations with
-  // iterators.
+  // Rows are stored contiguously, so we may use arithmetical operations with
+  // pointers.
+  std::shared_ptr<const DWARFDebugLine::Row> SeqRows = getSequenceRows(seq);
+  if (!SeqRows)
+    return UnknownRowIndex;
+  const DWARFDebugLine::Row *first_row = SeqRows.get();
   DWARFDebugLine::Row row;
   row.Address = address;
-  RowIter first_row = Rows.begin() + seq.FirstRowIndex;
-  RowIter last_row = Rows.begin() + seq.LastRowIndex;
-  LineTable::RowIter row_pos = std::lower_bound(
+  const DWARFDebugLine::Row *last_row =
+      first_row + (seq.LastRowIndex - seq.FirstRowIndex);
+  const DWARFDebugLine::Row *row_pos = std::lower_bound(
       first_row, last_row, row, DWARFDebugLine::Row::orderByAddress);
   if (row_pos == last_row) {
     return seq.LastRowIndex - 1;
@@ -673,7 +797,7 @@ bool DWARFDebugLine::LineTable::getFileLineInfoForAddress(
   if (RowIndex == -1U)
     return false;
   // Take file number and line/column from the row.
-  const auto &Row = Rows[RowIndex];
+  const auto Row = getRow(RowIndex);
   if (!getFileNameByIndex(Row.File, CompDir, Kind, Result.FileName))
     return false;
   Result.Line = Row.Line;
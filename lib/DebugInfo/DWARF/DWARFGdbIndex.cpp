@@ -11,6 +11,8 @@
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include <cctype>
 
 using namespace llvm;
 
@@ -174,3 +176,50 @@ void DWARFGdbIndex::parse(DataExtractor Data) {
   HasContent = !Data.getData().empty();
   HasError = HasContent && !parseImpl(Data);
 }
+
+// The hash function for symbol table names, from version 5 of the format on.
+static uint32_t hashSymbolName(StringRef Name) {
+  uint32_t R = 0;
+  for (unsigned char C : Name)
+    R = R * 67 + tolower(C) - 113;
+  return R;
+}
+
+void DWARFGdbIndex::lookupSymbol(StringRef Name,
+                                 SmallVectorImpl<uint64_t> &CUOffsets) const {
+  uint32_t Size = SymbolTable.size();
+  if (!HasContent || HasError || !isPowerOf2_32(Size))
+    return;
+
+  // Probe the open addressed table the way gdb does.
+  uint32_t Hash = hashSymbolName(Name);
+  uint32_t Index = Hash & (Size - 1);
+  uint32_t Step = ((Hash * 17) & (Size - 1)) | 1;
+  for (uint32_t Probes = 0; Probes != Size; ++Probes) {
+    const SymTableEntry &E = SymbolTable[Index];
+    if (!E.NameOffset && !E.VecOffset)
+      return;
+    Index = (Index + Step) & (Size - 1);
+
+    StringRef Str = ConstantPoolStrings.substr(
+        ConstantPoolOffset - StringPoolOffset + E.NameOffset);
+    if (Str.substr(0, Str.find('\0')) != Name)
+      continue;
+
+    auto CuVector = std::find_if(
+        ConstantPoolVectors.begin(), ConstantPoolVectors.end(),
+        [&](const std::pair<uint32_t, SmallVector<uint32_t, 0>> &V) {
+          return V.first == E.VecOffset;
+        });
+    if (CuVector == ConstantPoolVectors.end())
+      return;
+    // The low 24 bits of each value are the CU index; the rest are the
+    // symbol's attributes.
+    for (uint32_t Val : CuVector->second) {
+      uint32_t CuIndex = Val & 0xffffff;
+      if (CuIndex < CuList.size())
+        CUOffsets.push_back(CuList[CuIndex].Offset);
+    }
+    return;
+  }
+}
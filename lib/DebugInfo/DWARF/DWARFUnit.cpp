@@ -236,6 +236,52 @@ void DWARFUnit::extractDIEsToVector(
                     "bounds cu 0x%8.8x at 0x%8.8x'\n", getOffset(), DIEOffset);
 }
 
+bool DWARFUnit::extractDIEPath(
+    uint32_t Offset, SmallVectorImpl<DWARFDebugInfoEntryMinimal> &Path) const {
+  Path.clear();
+  uint32_t DIEOffset = this->Offset + getHeaderSize();
+  uint32_t NextCUOffset = getNextUnitOffset();
+  if (Offset < DIEOffset || Offset >= NextCUOffset)
+    return false;
+
+  // Path holds the DIEs whose children are being visited, so it always is
+  // the chain of parents of the next DIE.
+  DWARFDebugInfoEntryMinimal DIE;
+  while (DIEOffset <= Offset) {
+    uint32_t DIEStart = DIEOffset;
+    if (!DIE.extractFast(this, &DIEOffset))
+      break;
+    if (DIEStart == Offset) {
+      Path.push_back(DIE);
+      return true;
+    }
+
+    if (DIE.isNULL()) {
+      // The children of the innermost parent end before Offset.
+      if (Path.empty())
+        break;
+      Path.pop_back();
+      if (Path.empty())
+        break; // Past the end of the unit DIE's children.
+      continue;
+    }
+
+    if (!DIE.hasChildren())
+      continue;
+    uint64_t Sibling =
+        DIE.getAttributeValueAsReference(this, DW_AT_sibling, -1ULL);
+    if (Sibling != -1ULL && Sibling > DIEStart && Sibling <= Offset &&
+        Sibling < NextCUOffset) {
+      DIEOffset = Sibling;
+      continue;
+    }
+    Path.push_back(DIE);
+  }
+
+  Path.clear();
+  return false;
+}
+
 size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
   if ((CUDieOnly && DieArray.size() > 0) ||
       DieArray.size() > 1)
@@ -49,7 +49,20 @@ MappedBlockStream::MappedBlockStream(uint32_t BlockSize, uint32_t NumBlocks,
                                      const MSFStreamLayout &Layout,
                                      const ReadableStream &MsfData)
     : BlockSize(BlockSize), NumBlocks(NumBlocks), StreamLayout(Layout),
-      MsfData(MsfData) {}
+      MsfData(MsfData) {
+  // For each block of the stream, record where the run of blocks that are
+  // contiguous in the MSF file starting at it ends.
+  uint32_t StreamBlocks = StreamLayout.Blocks.size();
+  RunEnds.resize(StreamBlocks);
+  for (uint32_t I = StreamBlocks; I > 0; --I) {
+    uint32_t Block = I - 1;
+    if (I < StreamBlocks &&
+        StreamLayout.Blocks[Block] + 1 == StreamLayout.Blocks[I])
+      RunEnds[Block] = RunEnds[I];
+    else
+      RunEnds[Block] = I;
+  }
+}
 
 std::unique_ptr<MappedBlockStream>
 MappedBlockStream::createStream(uint32_t BlockSize, uint32_t NumBlocks,
@@ -111,40 +124,22 @@ Error MappedBlockStream::readBytes(uint32_t Offset, uint32_t Size,
 
   // We couldn't find a buffer that started at the correct offset (the most
   // common scenario).  Try to see if there is a buffer that starts at some
-  // other offset but overlaps the desired range.
-  for (auto &CacheItem : CacheMap) {
-    Interval RequestExtent = std::make_pair(Offset, Offset + Size);
-
-    // We already checked this one on the fast path above.
-    if (CacheItem.first == Offset)
-      continue;
-    // If the initial extent of the cached item is beyond the ending extent
-    // of the request, there is no overlap.
-    if (CacheItem.first >= Offset + Size)
-      continue;
-
+  // other offset but contains the desired range.  No allocation is larger
+  // than MaxCachedSize, so only those starting in the MaxCachedSize bytes
+  // before the end of the request can contain it.
+  uint32_t First = Offset + Size - std::min(Offset + Size, MaxCachedSize);
+  auto E = CacheMap.lower_bound(Offset);
+  for (auto I = CacheMap.lower_bound(std::min(First, Offset)); I != E; ++I) {
     // We really only have to check the last item in the list, since we append
     // in order of increasing length.
-    if (CacheItem.second.empty())
-      continue;
-
-    auto CachedAlloc = CacheItem.second.back();
-    // If the initial extent of the request is beyond the ending extent of
-    // the cached item, there is no overlap.
-    Interval CachedExtent =
-        std::make_pair(CacheItem.first, CacheItem.first + CachedAlloc.size());
-    if (RequestExtent.first >= CachedExtent.first + CachedExtent.second)
+    if (I->second.empty())
       continue;
 
-    Interval Intersection = intersect(CachedExtent, RequestExtent);
-    // Only use this if the entire request extent is contained in the cached
-    // extent.
-    if (Intersection != RequestExtent)
+    auto CachedAlloc = I->second.back();
+    if (I->first + CachedAlloc.size() < Offset + Size)
       continue;
 
-    uint32_t CacheRangeOffset =
-        AbsoluteDifference(CachedExtent.first, Intersection.first);
-    Buffer = CachedAlloc.slice(CacheRangeOffset, Size);
+    Buffer = CachedAlloc.slice(Offset - I->first, Size);
     return Error::success();
   }
 
@@ -156,13 +151,8 @@ Error MappedBlockStream::readBytes(uint32_t Offset, uint32_t Size,
   if (auto EC = readBytes(Offset, MutableArrayRef<uint8_t>(WriteBuffer, Size)))
     return EC;
 
-  if (CacheIter != CacheMap.end()) {
-    CacheIter->second.emplace_back(WriteBuffer, Size);
-  } else {
-    std::vector<CacheEntry> List;
-    List.emplace_back(WriteBuffer, Size);
-    CacheMap.insert(std::make_pair(Offset, List));
-  }
+  CacheMap[Offset].emplace_back(WriteBuffer, Size);
+  MaxCachedSize = std::max(MaxCachedSize, Size);
   Buffer = ArrayRef<uint8_t>(WriteBuffer, Size);
   return Error::success();
 }
@@ -173,18 +163,9 @@ Error MappedBlockStream::readLongestContiguousChunk(
   if (Offset >= StreamLayout.Length)
     return make_error<MSFError>(msf_error_code::insufficient_buffer);
   uint32_t First = Offset / BlockSize;
-  uint32_t Last = First;
-
-  while (Last < NumBlocks - 1) {
-    if (StreamLayout.Blocks[Last] != StreamLayout.Blocks[Last + 1] - 1)
-      break;
-    ++Last;
-  }
-
   uint32_t OffsetInFirstBlock = Offset % BlockSize;
-  uint32_t BytesFromFirstBlock = BlockSize - OffsetInFirstBlock;
-  uint32_t BlockSpan = Last - First + 1;
-  uint32_t ByteSpan = BytesFromFirstBlock + (BlockSpan - 1) * BlockSize;
+  uint32_t End = std::min<uint64_t>(uint64_t(RunEnds[First]) * BlockSize,
+                                    StreamLayout.Length);
 
   ArrayRef<uint8_t> BlockData;
   uint32_t MsfOffset = blockToOffset(StreamLayout.Blocks[First], BlockSize);
@@ -192,7 +173,7 @@ Error MappedBlockStream::readLongestContiguousChunk(
     return EC;
 
   BlockData = BlockData.drop_front(OffsetInFirstBlock);
-  Buffer = ArrayRef<uint8_t>(BlockData.data(), ByteSpan);
+  Buffer = ArrayRef<uint8_t>(BlockData.data(), End - Offset);
   return Error::success();
 }
 
@@ -211,16 +192,9 @@ bool MappedBlockStream::tryReadContiguously(uint32_t Offset, uint32_t Size,
   // 3 blocks in a row are contiguous.
   uint32_t BlockNum = Offset / BlockSize;
   uint32_t OffsetInBlock = Offset % BlockSize;
-  uint32_t BytesFromFirstBlock = std::min(Size, BlockSize - OffsetInBlock);
-  uint32_t NumAdditionalBlocks =
-      llvm::alignTo(Size - BytesFromFirstBlock, BlockSize) / BlockSize;
-
-  uint32_t RequiredContiguousBlocks = NumAdditionalBlocks + 1;
-  uint32_t E = StreamLayout.Blocks[BlockNum];
-  for (uint32_t I = 0; I < RequiredContiguousBlocks; ++I, ++E) {
-    if (StreamLayout.Blocks[I + BlockNum] != E)
-      return false;
-  }
+  uint32_t LastBlockNum = (Offset + Size - 1) / BlockSize;
+  if (RunEnds[BlockNum] <= LastBlockNum)
+    return false;
 
   // Read out the entire block where the requested offset starts.  Then drop
   // bytes from the beginning so that the actual starting byte lines up with
@@ -278,7 +252,10 @@ uint32_t MappedBlockStream::getNumBytesCopied() const {
   return static_cast<uint32_t>(Pool.getBytesAllocated());
 }
 
-void MappedBlockStream::invalidateCache() { CacheMap.shrink_and_clear(); }
+void MappedBlockStream::invalidateCache() {
+  CacheMap.clear();
+  MaxCachedSize = 0;
+}
 
 void MappedBlockStream::fixCacheAfterWrite(uint32_t Offset,
                                            ArrayRef<uint8_t> Data) const {
@@ -12,6 +12,8 @@
 #include "llvm/DebugInfo/MSF/MSFError.h"
 #include "llvm/DebugInfo/MSF/StreamRef.h"
 
+#include <cstring>
+
 using namespace llvm;
 using namespace llvm::msf;
 
@@ -24,9 +26,31 @@ Error StreamReader::readLongestContiguousChunk(ArrayRef<uint8_t> &Buffer) {
   return Error::success();
 }
 
+// Sets Buffer to the Size bytes at Offset, if they lie in a contiguous chunk
+// of the stream, and returns true.  Records are usually read a field at a
+// time, so the chunk found for the first read serves the following ones.
+bool StreamReader::readFromChunk(ArrayRef<uint8_t> &Buffer, uint32_t Size) {
+  if (Offset < ChunkOffset || Offset - ChunkOffset >= Chunk.size()) {
+    if (Offset >= Stream.getLength())
+      return false;
+    if (auto EC = Stream.readLongestContiguousChunk(Offset, Chunk)) {
+      consumeError(std::move(EC));
+      Chunk = ArrayRef<uint8_t>();
+      return false;
+    }
+    ChunkOffset = Offset;
+  }
+  uint32_t OffsetInChunk = Offset - ChunkOffset;
+  if (Size > Chunk.size() - OffsetInChunk)
+    return false;
+  Buffer = Chunk.slice(OffsetInChunk, Size);
+  return true;
+}
+
 Error StreamReader::readBytes(ArrayRef<uint8_t> &Buffer, uint32_t Size) {
-  if (auto EC = Stream.readBytes(Offset, Size, Buffer))
-    return EC;
+  if (!readFromChunk(Buffer, Size))
+    if (auto EC = Stream.readBytes(Offset, Size, Buffer))
+      return EC;
   Offset += Size;
   return Error::success();
 }
@@ -48,6 +72,20 @@ Error StreamReader::readInteger(uint32_t &Dest) {
 }
 
 Error StreamReader::readZeroString(StringRef &Dest) {
+  // Look for the terminator in the contiguous bytes at the current offset.
+  ArrayRef<uint8_t> Bytes;
+  if (readFromChunk(Bytes, 0)) {
+    uint32_t OffsetInChunk = Offset - ChunkOffset;
+    const uint8_t *Begin = Chunk.data() + OffsetInChunk;
+    if (const void *End =
+            ::memchr(Begin, '\0', Chunk.size() - OffsetInChunk)) {
+      uint32_t Length = static_cast<const uint8_t *>(End) - Begin;
+      Dest = StringRef(reinterpret_cast<const char *>(Begin), Length);
+      Offset += Length + 1;
+      return Error::success();
+    }
+  }
+
   uint32_t Length = 0;
   // First compute the length of the string by reading 1 byte at a time.
   uint32_t OriginalOffset = getOffset();
@@ -42,6 +42,9 @@ public:
   // it in memory assuming there were no conflicts.
   uint64_t getModulePreferredBase() const override;
 
+  // Returns the debug info context the module symbolizes code with.
+  DIContext *getDIContext() const { return DebugInfoContext.get(); }
+
 private:
   bool shouldOverrideWithSymbolTable(FunctionNameKind FNKind,
                                      bool UseSymbolTable) const;
@@ -36,6 +36,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <set>
 
 #if defined(_MSC_VER)
 #include <Windows.h>
@@ -53,6 +54,24 @@ namespace symbolize {
 
 Expected<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                                                   uint64_t ModuleOffset) {
+  if (!Opts.IndexCacheDir.empty()) {
+    auto IndexOrErr = getOrCreateIndex(ModuleName);
+    if (!IndexOrErr)
+      return IndexOrErr.takeError();
+    if (SymbolizerIndex *Index = IndexOrErr.get()) {
+      uint64_t Address = ModuleOffset;
+      if (Opts.RelativeAddresses)
+        Address += Index->getModulePreferredBase();
+      DILineInfo LineInfo;
+      if (Index->symbolizeCode(Address, LineInfo)) {
+        if (Opts.Demangle)
+          LineInfo.FunctionName =
+              DemangleName(LineInfo.FunctionName, Index->isWin32Module());
+        return LineInfo;
+      }
+    }
+  }
+
   SymbolizableModule *Info;
   if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
     Info = InfoOrErr.get();
@@ -79,6 +98,28 @@ Expected<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName
 Expected<DIInliningInfo>
 LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
                                      uint64_t ModuleOffset) {
+  if (!Opts.IndexCacheDir.empty()) {
+    auto IndexOrErr = getOrCreateIndex(ModuleName);
+    if (!IndexOrErr)
+      return IndexOrErr.takeError();
+    if (SymbolizerIndex *Index = IndexOrErr.get()) {
+      uint64_t Address = ModuleOffset;
+      if (Opts.RelativeAddresses)
+        Address += Index->getModulePreferredBase();
+      DIInliningInfo InlinedContext;
+      if (Index->symbolizeInlinedCode(Address, InlinedContext)) {
+        if (Opts.Demangle) {
+          for (int i = 0, n = InlinedContext.getNumberOfFrames(); i < n; i++) {
+            auto *Frame = InlinedContext.getMutableFrame(i);
+            Frame->FunctionName =
+                DemangleName(Frame->FunctionName, Index->isWin32Module());
+          }
+        }
+        return InlinedContext;
+      }
+    }
+  }
+
   SymbolizableModule *Info;
   if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
     Info = InfoOrErr.get();
@@ -136,6 +177,10 @@ void LLVMSymbolizer::flush() {
   BinaryForPath.clear();
   ObjectPairForPathArch.clear();
   Modules.clear();
+  Indices.clear();
+  CacheEntries.clear();
+  CacheLRU.clear();
+  CacheSize = 0;
 }
 
 namespace {
@@ -361,14 +406,15 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
   return errorCodeToError(object_error::arch_not_found);
 }
 
-Expected<SymbolizableModule *>
-LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  const auto &I = Modules.find(ModuleName);
-  if (I != Modules.end()) {
-    return I->second.get();
-  }
-  std::string BinaryName = ModuleName;
-  std::string ArchName = Opts.DefaultArch;
+namespace {
+
+// Splits a module name of the form "path[:arch]" into its binary path and
+// architecture.
+void splitModuleName(const std::string &ModuleName,
+                     const std::string &DefaultArch, std::string &BinaryName,
+                     std::string &ArchName) {
+  BinaryName = ModuleName;
+  ArchName = DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
   // Verify that substring after colon form a valid arch name.
   if (ColonPos != std::string::npos) {
@@ -378,6 +424,19 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       ArchName = ArchStr;
     }
   }
+}
+
+} // end anonymous namespace
+
+Expected<SymbolizableModule *>
+LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
+  const auto &I = Modules.find(ModuleName);
+  if (I != Modules.end()) {
+    touchCacheEntry(ModuleName);
+    return I->second.get();
+  }
+  std::string BinaryName, ArchName;
+  splitModuleName(ModuleName, Opts.DefaultArch, BinaryName, ArchName);
   auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
   if (!ObjectsOrErr) {
     // Failed to find valid object file.
@@ -406,8 +465,12 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       Context.reset(new PDBContext(*CoffObject, std::move(Session)));
     }
   }
-  if (!Context)
-    Context.reset(new DWARFContextInMemory(*Objects.second));
+  if (!Context) {
+    auto DICtx = llvm::make_unique<DWARFContextInMemory>(*Objects.second);
+    // The symbolizer only looks rows up, so it needn't keep them all.
+    DICtx->setLazyLineTables(true);
+    Context = std::move(DICtx);
+  }
   assert(Context);
   auto InfoOrErr =
       SymbolizableObjectFile::create(Objects.first, std::move(Context));
@@ -419,9 +482,154 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   assert(InsertResult.second);
   if (auto EC = InfoOrErr.getError())
     return errorCodeToError(EC);
+
+  CacheEntry &Entry = touchCacheEntry(ModuleName);
+  uint64_t ModuleSize = Objects.second->getData().size();
+  CacheSize += ModuleSize - Entry.ModuleSize;
+  Entry.ModuleSize = ModuleSize;
+  pruneCache();
   return InsertResult.first->second.get();
 }
 
+Expected<SymbolizerIndex *>
+LLVMSymbolizer::getOrCreateIndex(const std::string &ModuleName) {
+  const auto &I = Indices.find(ModuleName);
+  if (I != Indices.end()) {
+    touchCacheEntry(ModuleName);
+    return I->second.get();
+  }
+
+  // Only one attempt is made to get an index for a module.
+  std::unique_ptr<SymbolizerIndex> &Index = Indices[ModuleName];
+  std::string BinaryName, ArchName;
+  splitModuleName(ModuleName, Opts.DefaultArch, BinaryName, ArchName);
+  auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
+  if (!ObjectsOrErr) {
+    // Let the module report the error.
+    consumeError(ObjectsOrErr.takeError());
+    return nullptr;
+  }
+  std::string Key = SymbolizerIndex::getCacheKey(*ObjectsOrErr->first);
+  if (Key.empty())
+    return nullptr;
+  SmallString<128> IndexPath(Opts.IndexCacheDir);
+  sys::path::append(IndexPath, Key + ".symidx");
+
+  // An index that can't be read, e.g. because it was built with other
+  // options, is simply rebuilt.
+  auto BufOrErr = MemoryBuffer::getFile(IndexPath, -1,
+                                        /*RequiresNullTerminator=*/false);
+  if (BufOrErr) {
+    auto IndexOrErr = SymbolizerIndex::create(
+        std::move(BufOrErr.get()), Opts.PrintFunctions, Opts.UseSymbolTable);
+    if (IndexOrErr)
+      Index = std::move(IndexOrErr.get());
+    else
+      consumeError(IndexOrErr.takeError());
+  }
+
+  if (!Index) {
+    auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
+    if (!InfoOrErr)
+      return InfoOrErr.takeError();
+    if (!InfoOrErr.get())
+      return nullptr;
+    // All modules are SymbolizableObjectFiles.
+    auto *Info = static_cast<SymbolizableObjectFile *>(InfoOrErr.get());
+    Index = SymbolizerIndex::build(*Info, *Info->getDIContext(),
+                                   Opts.PrintFunctions, Opts.UseSymbolTable);
+    if (!Index)
+      return nullptr;
+    // The index is still usable if it can't be cached.
+    sys::fs::create_directories(Opts.IndexCacheDir);
+    consumeError(Index->writeToFile(IndexPath));
+  }
+
+  CacheEntry &Entry = touchCacheEntry(ModuleName);
+  CacheSize += Index->getSize() - Entry.IndexSize;
+  Entry.IndexSize = Index->getSize();
+  SymbolizerIndex *Result = Index.get();
+  pruneCache();
+  return Result;
+}
+
+LLVMSymbolizer::CacheEntry &
+LLVMSymbolizer::touchCacheEntry(const std::string &ModuleName) {
+  auto Ins = CacheEntries.insert(std::make_pair(ModuleName, CacheEntry()));
+  CacheEntry &Entry = Ins.first->second;
+  if (Ins.second) {
+    CacheLRU.push_front(ModuleName);
+    Entry.LRUPos = CacheLRU.begin();
+  } else {
+    CacheLRU.splice(CacheLRU.begin(), CacheLRU, Entry.LRUPos);
+  }
+  return Entry;
+}
+
+void LLVMSymbolizer::pruneCache() {
+  bool Pruned = false;
+  while (Opts.MaxCacheSize && CacheSize > Opts.MaxCacheSize &&
+         CacheLRU.size() > 1) {
+    Pruned = true;
+    const std::string &ModuleName = CacheLRU.back();
+    auto I = CacheEntries.find(ModuleName);
+    CacheSize -= I->second.ModuleSize + I->second.IndexSize;
+    CacheEntries.erase(I);
+    Modules.erase(ModuleName);
+    Indices.erase(ModuleName);
+    CacheLRU.pop_back();
+  }
+  if (Pruned)
+    releaseUnusedObjects();
+}
+
+void LLVMSymbolizer::releaseUnusedObjects() {
+  // Object pairs and the object files in them that live modules still use.
+  // Binaries and object files may be shared between modules, e.g. the
+  // slices of a universal binary or a common debug info file.
+  std::set<std::pair<std::string, std::string>> LivePairs;
+  std::set<const Binary *> LiveObjects;
+  for (auto &M : Modules) {
+    if (!M.second)
+      continue;
+    std::string BinaryName, ArchName;
+    splitModuleName(M.first, Opts.DefaultArch, BinaryName, ArchName);
+    auto Key = std::make_pair(BinaryName, ArchName);
+    auto I = ObjectPairForPathArch.find(Key);
+    if (I == ObjectPairForPathArch.end())
+      continue;
+    LivePairs.insert(Key);
+    LiveObjects.insert(I->second.first);
+    LiveObjects.insert(I->second.second);
+  }
+
+  for (auto I = ObjectPairForPathArch.begin();
+       I != ObjectPairForPathArch.end();)
+    if (LivePairs.count(I->first))
+      ++I;
+    else
+      I = ObjectPairForPathArch.erase(I);
+
+  // Universal binaries stay while any of their slices is used.
+  std::set<std::string> LiveUniversalPaths;
+  for (auto I = ObjectForUBPathAndArch.begin();
+       I != ObjectForUBPathAndArch.end();) {
+    if (I->second && LiveObjects.count(I->second.get())) {
+      LiveUniversalPaths.insert(I->first.first);
+      ++I;
+    } else {
+      I = ObjectForUBPathAndArch.erase(I);
+    }
+  }
+
+  for (auto I = BinaryForPath.begin(); I != BinaryForPath.end();)
+    if (I->second.getBinary() && (LiveObjects.count(I->second.getBinary()) ||
+                                  LiveUniversalPaths.count(I->first)))
+      ++I;
+    else
+      I = BinaryForPath.erase(I);
+}
+
 namespace {
 
 // Undo these various manglings for Win32 extern "C" functions:
@@ -463,6 +671,11 @@ extern "C" char *__cxa_demangle(const char *mangled_name, char *output_buffer,
 
 std::string LLVMSymbolizer::DemangleName(const std::string &Name,
                                          const SymbolizableModule *ModInfo) {
+  return DemangleName(Name, ModInfo && ModInfo->isWin32Module());
+}
+
+std::string LLVMSymbolizer::DemangleName(const std::string &Name,
+                                         bool IsWin32Module) {
 #if !defined(_MSC_VER)
   // We can spoil names of symbols with C linkage, so use an heuristic
   // approach to check if the name should be demangled.
@@ -490,7 +703,7 @@ std::string LLVMSymbolizer::DemangleName(const std::string &Name,
     return (result == 0) ? Name : std::string(DemangledName);
   }
 #endif
-  if (ModInfo && ModInfo->isWin32Module())
+  if (IsWin32Module)
     return std::string(demanglePE32ExternCFunc(Name));
   return Name;
 }
@@ -0,0 +1,401 @@
+//===-- SymbolizerIndex.cpp -----------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the address indices that LLVMSymbolizer caches on disk.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/Symbolize/SymbolizerIndex.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/Object/MachO.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+namespace llvm {
+namespace symbolize {
+
+using namespace object;
+using support::ulittle32_t;
+using support::ulittle64_t;
+
+// An index file is a header, the ranges sorted by address, the frames they
+// refer to, and a table of NUL-terminated strings that the frames refer to.
+// All fields are little-endian.
+
+namespace {
+
+const char IndexMagic[8] = {'L', 'L', 'V', 'M', 'S', 'Y', 'M', 'X'};
+const uint32_t IndexVersion = 1;
+
+// Header flags. The low two bits hold the FunctionNameKind.
+enum : uint32_t {
+  FunctionNameKindMask = 0x3,
+  UseSymbolTableFlag = 0x4,
+  Win32ModuleFlag = 0x8,
+};
+
+struct IndexHeader {
+  char Magic[8];
+  ulittle32_t Version;
+  ulittle32_t Flags;
+  ulittle64_t PreferredBase;
+  ulittle32_t NumRanges;
+  ulittle32_t NumFrames;
+  ulittle32_t StringsSize;
+  ulittle32_t Padding;
+};
+
+// Returns an ID in lower-case hex, the way build IDs are usually shown.
+std::string getIDString(StringRef ID) { return StringRef(toHex(ID)).lower(); }
+
+uint32_t getOptionFlags(FunctionNameKind FNKind, bool UseSymbolTable) {
+  return static_cast<uint32_t>(FNKind) |
+         (UseSymbolTable ? uint32_t(UseSymbolTableFlag) : 0u);
+}
+
+} // end anonymous namespace
+
+struct SymbolizerIndex::Range {
+  ulittle64_t Start;
+  ulittle64_t End;
+  ulittle32_t FirstFrame;
+  ulittle32_t NumFrames;
+  // The function name that symbolizeCode reports. It differs from the first
+  // frame's when the symbol table overrides the name of an inlined frame.
+  ulittle32_t CodeFunctionName;
+  ulittle32_t Padding;
+};
+
+struct SymbolizerIndex::Frame {
+  ulittle32_t FileName;
+  ulittle32_t FunctionName;
+  ulittle32_t Line;
+  ulittle32_t Column;
+};
+
+// Lays out an index buffer.
+class SymbolizerIndex::Writer {
+public:
+  uint32_t addString(StringRef S) {
+    auto Ins = StringOffsets.insert(std::make_pair(S, Strings.size()));
+    if (Ins.second) {
+      Strings.append(S.begin(), S.end());
+      Strings.push_back('\0');
+    }
+    return Ins.first->second;
+  }
+
+  void addRange(uint64_t Start, uint64_t End, const DIInliningInfo &Inlined,
+                const DILineInfo &Code) {
+    Range R;
+    R.Start = Start;
+    R.End = End;
+    R.FirstFrame = Frames.size();
+    R.NumFrames = Inlined.getNumberOfFrames();
+    R.CodeFunctionName = addString(Code.FunctionName);
+    R.Padding = 0;
+    for (uint32_t I = 0, E = Inlined.getNumberOfFrames(); I != E; ++I) {
+      DILineInfo Info = Inlined.getFrame(I);
+      Frame F;
+      F.FileName = addString(Info.FileName);
+      F.FunctionName = addString(Info.FunctionName);
+      F.Line = Info.Line;
+      F.Column = Info.Column;
+      Frames.push_back(F);
+    }
+    Ranges.push_back(R);
+  }
+
+  std::unique_ptr<MemoryBuffer> finish(uint32_t Flags, uint64_t PreferredBase) {
+    IndexHeader H;
+    memcpy(H.Magic, IndexMagic, sizeof(IndexMagic));
+    H.Version = IndexVersion;
+    H.Flags = Flags;
+    H.PreferredBase = PreferredBase;
+    H.NumRanges = Ranges.size();
+    H.NumFrames = Frames.size();
+    H.StringsSize = Strings.size();
+    H.Padding = 0;
+
+    std::string Data;
+    raw_string_ostream OS(Data);
+    OS.write(reinterpret_cast<const char *>(&H), sizeof(H));
+    OS.write(reinterpret_cast<const char *>(Ranges.data()),
+             Ranges.size() * sizeof(Range));
+    OS.write(reinterpret_cast<const char *>(Frames.data()),
+             Frames.size() * sizeof(Frame));
+    OS << Strings;
+    return MemoryBuffer::getMemBufferCopy(OS.str(), "<symbolizer index>");
+  }
+
+private:
+  std::vector<Range> Ranges;
+  std::vector<Frame> Frames;
+  StringMap<uint32_t> StringOffsets;
+  std::string Strings;
+};
+
+namespace {
+
+bool sameFrames(const DIInliningInfo &LHS, const DIInliningInfo &RHS) {
+  if (LHS.getNumberOfFrames() != RHS.getNumberOfFrames())
+    return false;
+  for (uint32_t I = 0, E = LHS.getNumberOfFrames(); I != E; ++I)
+    if (LHS.getFrame(I) != RHS.getFrame(I))
+      return false;
+  return true;
+}
+
+} // end anonymous namespace
+
+std::unique_ptr<SymbolizerIndex>
+SymbolizerIndex::build(const SymbolizableModule &Module, DIContext &DICtx,
+                       FunctionNameKind FNKind, bool UseSymbolTable) {
+  auto *DWARFCtx = dyn_cast<DWARFContext>(&DICtx);
+  if (!DWARFCtx)
+    return nullptr;
+
+  // Every row of a sequence, except for the end_sequence row, starts a
+  // range that ends at the next row.
+  std::vector<std::pair<uint64_t, uint64_t>> RowRanges;
+  for (const auto &CU : DWARFCtx->compile_units()) {
+    const DWARFDebugLine::LineTable *LT =
+        DWARFCtx->getLineTableForUnit(CU.get());
+    if (!LT)
+      continue;
+    for (const auto &Seq : LT->Sequences)
+      for (unsigned I = Seq.FirstRowIndex; I + 1 < Seq.LastRowIndex; ++I) {
+        uint64_t Start = LT->getRow(I).Address;
+        uint64_t End = LT->getRow(I + 1).Address;
+        if (Start < End)
+          RowRanges.push_back(std::make_pair(Start, End));
+      }
+  }
+  std::sort(RowRanges.begin(), RowRanges.end());
+
+  Writer W;
+  uint64_t PrevEnd = 0;
+  bool HavePending = false;
+  uint64_t PendingStart = 0, PendingEnd = 0;
+  DIInliningInfo PendingInlined;
+  DILineInfo PendingCode;
+  for (const auto &RR : RowRanges) {
+    // Where sequences overlap (e.g. those of discarded sections), the first
+    // one to cover an address wins.
+    uint64_t Start = std::max(RR.first, PrevEnd);
+    if (Start >= RR.second)
+      continue;
+    PrevEnd = RR.second;
+
+    DIInliningInfo Inlined =
+        Module.symbolizeInlinedCode(Start, FNKind, UseSymbolTable);
+    DILineInfo Code = Module.symbolizeCode(Start, FNKind, UseSymbolTable);
+    if (HavePending && PendingEnd == Start &&
+        sameFrames(PendingInlined, Inlined) && PendingCode == Code) {
+      PendingEnd = RR.second;
+      continue;
+    }
+    if (HavePending)
+      W.addRange(PendingStart, PendingEnd, PendingInlined, PendingCode);
+    HavePending = true;
+    PendingStart = Start;
+    PendingEnd = RR.second;
+    PendingInlined = Inlined;
+    PendingCode = Code;
+  }
+  if (HavePending)
+    W.addRange(PendingStart, PendingEnd, PendingInlined, PendingCode);
+
+  uint32_t Flags = getOptionFlags(FNKind, UseSymbolTable) |
+                   (Module.isWin32Module() ? uint32_t(Win32ModuleFlag) : 0u);
+  auto IndexOrErr = create(W.finish(Flags, Module.getModulePreferredBase()),
+                           FNKind, UseSymbolTable);
+  assert(IndexOrErr && "Built a malformed index");
+  return std::move(*IndexOrErr);
+}
+
+Expected<std::unique_ptr<SymbolizerIndex>>
+SymbolizerIndex::create(std::unique_ptr<MemoryBuffer> Buffer,
+                        FunctionNameKind FNKind, bool UseSymbolTable) {
+  auto Malformed = []() {
+    return errorCodeToError(object_error::parse_failed);
+  };
+  StringRef Data = Buffer->getBuffer();
+  if (Data.size() < sizeof(IndexHeader))
+    return Malformed();
+  const auto *H = reinterpret_cast<const IndexHeader *>(Data.data());
+  if (memcmp(H->Magic, IndexMagic, sizeof(IndexMagic)) ||
+      H->Version != IndexVersion)
+    return Malformed();
+  if ((H->Flags & (FunctionNameKindMask | UseSymbolTableFlag)) !=
+      getOptionFlags(FNKind, UseSymbolTable))
+    return errorCodeToError(object_error::invalid_file_type);
+
+  uint64_t RangesSize = uint64_t(H->NumRanges) * sizeof(Range);
+  uint64_t FramesSize = uint64_t(H->NumFrames) * sizeof(Frame);
+  if (Data.size() !=
+      sizeof(IndexHeader) + RangesSize + FramesSize + H->StringsSize)
+    return Malformed();
+
+  std::unique_ptr<SymbolizerIndex> Index(
+      new SymbolizerIndex(std::move(Buffer)));
+  const char *P = Data.data() + sizeof(IndexHeader);
+  Index->Ranges = reinterpret_cast<const Range *>(P);
+  Index->NumRanges = H->NumRanges;
+  Index->Frames = reinterpret_cast<const Frame *>(P + RangesSize);
+  Index->NumFrames = H->NumFrames;
+  Index->Strings = Data.substr(sizeof(IndexHeader) + RangesSize + FramesSize);
+
+  // Validate the references up front, so that lookups don't have to.
+  if (!Index->Strings.empty() && Index->Strings.back() != '\0')
+    return Malformed();
+  for (uint32_t I = 0; I != Index->NumRanges; ++I) {
+    const Range &R = Index->Ranges[I];
+    if (R.Start >= R.End || (I && R.Start < Index->Ranges[I - 1].End) ||
+        uint64_t(R.FirstFrame) + R.NumFrames > Index->NumFrames ||
+        R.CodeFunctionName >= Index->Strings.size())
+      return Malformed();
+  }
+  for (uint32_t I = 0; I != Index->NumFrames; ++I) {
+    const Frame &F = Index->Frames[I];
+    if (F.FileName >= Index->Strings.size() ||
+        F.FunctionName >= Index->Strings.size())
+      return Malformed();
+  }
+  return std::move(Index);
+}
+
+std::string SymbolizerIndex::getCacheKey(const ObjectFile &Obj) {
+  if (const auto *MachO = dyn_cast<MachOObjectFile>(&Obj)) {
+    ArrayRef<uint8_t> UUID = MachO->getUuid();
+    return getIDString(
+        StringRef(reinterpret_cast<const char *>(UUID.data()), UUID.size()));
+  }
+
+  if (!Obj.isELF())
+    return std::string();
+  for (const SectionRef &Section : Obj.sections()) {
+    StringRef Name;
+    StringRef Contents;
+    if (Section.getName(Name) || Name != ".note.gnu.build-id" ||
+        Section.getContents(Contents))
+      continue;
+    // The note is a name size, a descriptor size and a type, followed by
+    // the name and the descriptor, each padded to 4 bytes.
+    DataExtractor Note(Contents, Obj.isLittleEndian(), 0);
+    uint32_t Offset = 0;
+    while (Note.isValidOffsetForDataOfSize(Offset, 12)) {
+      uint32_t NameSize = Note.getU32(&Offset);
+      uint32_t DescSize = Note.getU32(&Offset);
+      uint32_t Type = Note.getU32(&Offset);
+      StringRef NoteName = Contents.substr(Offset, NameSize);
+      Offset += alignTo(NameSize, 4);
+      if (!Note.isValidOffsetForDataOfSize(Offset, DescSize))
+        break;
+      if (Type == ELF::NT_GNU_BUILD_ID && NoteName == StringRef("GNU", 4))
+        return getIDString(Contents.substr(Offset, DescSize));
+      Offset += alignTo(DescSize, 4);
+    }
+  }
+  return std::string();
+}
+
+Error SymbolizerIndex::writeToFile(StringRef Path) const {
+  int FD;
+  SmallString<128> TempPath;
+  if (auto EC = sys::fs::createUniqueFile(Path + ".tmp%%%%%%", FD, TempPath))
+    return errorCodeToError(EC);
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Buffer->getBuffer();
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return errorCodeToError(make_error_code(errc::io_error));
+    }
+  }
+  if (auto EC = sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return errorCodeToError(EC);
+  }
+  return Error::success();
+}
+
+const SymbolizerIndex::Range *
+SymbolizerIndex::findRange(uint64_t Address) const {
+  const Range *End = Ranges + NumRanges;
+  const Range *R = std::upper_bound(
+      Ranges, End, Address,
+      [](uint64_t Address, const Range &R) { return Address < R.Start; });
+  if (R == Ranges)
+    return nullptr;
+  --R;
+  return Address < R->End ? R : nullptr;
+}
+
+const char *SymbolizerIndex::getString(uint32_t Offset) const {
+  return Strings.data() + Offset;
+}
+
+DILineInfo SymbolizerIndex::getFrame(uint32_t Index) const {
+  const Frame &F = Frames[Index];
+  DILineInfo Info;
+  Info.FileName = getString(F.FileName);
+  Info.FunctionName = getString(F.FunctionName);
+  Info.Line = F.Line;
+  Info.Column = F.Column;
+  return Info;
+}
+
+bool SymbolizerIndex::symbolizeCode(uint64_t Address,
+                                    DILineInfo &Result) const {
+  const Range *R = findRange(Address);
+  if (!R || !R->NumFrames)
+    return false;
+  Result = getFrame(R->FirstFrame);
+  Result.FunctionName = getString(R->CodeFunctionName);
+  return true;
+}
+
+bool SymbolizerIndex::symbolizeInlinedCode(uint64_t Address,
+                                           DIInliningInfo &Result) const {
+  const Range *R = findRange(Address);
+  if (!R)
+    return false;
+  Result = DIInliningInfo();
+  for (uint32_t I = 0; I != R->NumFrames; ++I)
+    Result.addFrame(getFrame(R->FirstFrame + I));
+  return true;
+}
+
+static const IndexHeader &getHeader(const MemoryBuffer &Buffer) {
+  return *reinterpret_cast<const IndexHeader *>(Buffer.getBufferStart());
+}
+
+bool SymbolizerIndex::isWin32Module() const {
+  return getHeader(*Buffer).Flags & Win32ModuleFlag;
+}
+
+uint64_t SymbolizerIndex::getModulePreferredBase() const {
+  return getHeader(*Buffer).PreferredBase;
+}
+
+} // namespace symbolize
+} // namespace llvm
@@ -0,0 +1,150 @@
+//===-- FileObjectCache.cpp - Persistent on-disk JIT object cache ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_sha1_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+using namespace llvm;
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, StringRef Config)
+    : CacheDir(CacheDir), Config(Config), Pruner(CacheDir), NumHits(0),
+      NumMisses(0) {
+  // Failure here is not fatal: every lookup will simply miss.
+  sys::fs::create_directories(CacheDir);
+}
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, const TargetMachine &TM)
+    : FileObjectCache(CacheDir, getTargetConfig(TM)) {}
+
+std::string FileObjectCache::getTargetConfig(const TargetMachine &TM) {
+  std::string Result;
+  raw_string_ostream OS(Result);
+  OS << TM.getTargetTriple().str() << ';' << TM.getTargetCPU() << ';'
+     << TM.getTargetFeatureString() << ';' << TM.getOptLevel() << ';'
+     << TM.getRelocationModel() << ';' << TM.getCodeModel();
+
+  // The TargetOptions that can change the generated object. Reciprocal
+  // estimate settings can't be read until the target has filled them in, so
+  // they're left out.
+  const TargetOptions &Opts = TM.Options;
+  OS << ';' << Opts.UnsafeFPMath << Opts.NoInfsFPMath << Opts.NoNaNsFPMath
+     << Opts.NoTrappingFPMath << Opts.HonorSignDependentRoundingFPMathOption
+     << Opts.LessPreciseFPMADOption << Opts.NoZerosInBSS
+     << Opts.GuaranteedTailCallOpt << Opts.StackSymbolOrdering
+     << Opts.EnableFastISel << Opts.UseInitArray << Opts.CompressDebugSections
+     << Opts.RelaxELFRelocations << Opts.FunctionSections << Opts.DataSections
+     << Opts.UniqueSectionNames << Opts.TrapUnreachable << Opts.EmulatedTLS
+     << Opts.EnableIPRA << ';' << Opts.StackAlignmentOverride << ';'
+     << unsigned(Opts.FloatABIType) << ';' << unsigned(Opts.AllowFPOpFusion)
+     << ';' << unsigned(Opts.JTType) << ';' << unsigned(Opts.ThreadModel) << ';'
+     << unsigned(Opts.EABIVersion) << ';' << unsigned(Opts.DebuggerTuning)
+     << ';' << unsigned(Opts.FPDenormalType) << ';'
+     << unsigned(Opts.ExceptionModel);
+  const MCTargetOptions &MCOpts = Opts.MCOptions;
+  OS << ';' << MCOpts.SanitizeAddress << MCOpts.MCRelaxAll
+     << MCOpts.MCNoExecStack << MCOpts.MCIncrementalLinkerCompatible << ';'
+     << MCOpts.DwarfVersion << ';' << MCOpts.ABIName;
+  return OS.str();
+}
+
+std::string FileObjectCache::computeKey(const Module &M) const {
+  raw_sha1_ostream Hasher;
+  Hasher << LLVM_VERSION_STRING << '\0' << Config << '\0';
+
+  // The bitcode records the source file name, which defaults to the module
+  // identifier. Leave it out, so that the key depends only on the IR. M
+  // belongs to the caller, so hash a copy without the name.
+  if (M.getSourceFileName().empty()) {
+    WriteBitcodeToFile(&M, Hasher);
+  } else {
+    std::unique_ptr<Module> Unnamed = CloneModule(&M);
+    Unnamed->setSourceFileName("");
+    WriteBitcodeToFile(Unnamed.get(), Hasher);
+  }
+
+  return toHex(Hasher.sha1());
+}
+
+std::string FileObjectCache::getEntryPathForKey(StringRef Key) const {
+  SmallString<128> EntryPath(CacheDir);
+  sys::path::append(EntryPath, "llvmjit-" + Key + ".o");
+  return EntryPath.str();
+}
+
+std::string FileObjectCache::getEntryPath(const Module &M) const {
+  return getEntryPathForKey(computeKey(M));
+}
+
+std::unique_ptr<MemoryBuffer> FileObjectCache::getObject(const Module *M) {
+  std::string Key = computeKey(*M);
+
+  // Objects don't need a null terminator, which lets large entries be mapped
+  // rather than read.
+  auto Buffer = MemoryBuffer::getFile(getEntryPathForKey(Key), -1,
+                                      /*RequiresNullTerminator=*/false);
+  if (Buffer) {
+    ++NumHits;
+    return std::move(*Buffer);
+  }
+
+  ++NumMisses;
+  std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+  PendingKeys[std::this_thread::get_id()] = {M, std::move(Key)};
+  return nullptr;
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+    auto I = PendingKeys.find(std::this_thread::get_id());
+    if (I != PendingKeys.end() && I->second.M == M) {
+      Key = std::move(I->second.Key);
+      PendingKeys.erase(I);
+    }
+  }
+  // The JIT did not ask us for this module first, so the IR may already have
+  // been changed by code generation. Hash it as it stands.
+  if (Key.empty())
+    Key = computeKey(*M);
+  std::string EntryPath = getEntryPathForKey(Key);
+
+  // Write to a temporary in the cache directory and rename it into place, so
+  // that concurrent readers never see a partial entry.
+  SmallString<128> TempPath;
+  int TempFD;
+  if (sys::fs::createUniqueFile(EntryPath + ".%%%%%%.tmp", TempFD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(TempFD, /*shouldClose=*/true);
+    OS << Obj.getBuffer();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, EntryPath)) {
+    sys::fs::remove(TempPath);
+    return;
+  }
+
+  Pruner.prune();
+}
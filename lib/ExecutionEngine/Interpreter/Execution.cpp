@@ -39,8 +39,55 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //                     Various Helper Functions
 //===----------------------------------------------------------------------===//
 
+FunctionSlotMap::FunctionSlotMap(const Function &F) : F(F) {
+  for (const Argument &A : F.args())
+    Slots.insert(std::make_pair(&A, Slots.size()));
+  for (const BasicBlock &BB : F)
+    BlockNumbers.insert(std::make_pair(&BB, BlockNumbers.size()));
+  Blocks.resize(BlockNumbers.size());
+  update();
+}
+
+void FunctionSlotMap::update() {
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB)
+      if (!I.getType()->isVoidTy())
+        Slots.insert(std::make_pair(&I, Slots.size()));
+  resolveBlocks();
+}
+
+void FunctionSlotMap::resolveBlocks() {
+  unsigned BlockNo = 0;
+  for (const BasicBlock &BB : F) {
+    std::vector<InstSlots> &Insts = Blocks[BlockNo++].Insts;
+    Insts.clear();
+    for (const Instruction &I : BB) {
+      Insts.emplace_back();
+      InstSlots &IS = Insts.back();
+      IS.I = &I;
+      IS.Result = I.getType()->isVoidTy() ? InstSlots::NoSlot : Slots[&I];
+      for (const Use &U : I.operands()) {
+        const Value *Op = U.get();
+        unsigned Slot = InstSlots::NoSlot;
+        if (auto *OpBB = dyn_cast<BasicBlock>(Op))
+          Slot = BlockNumbers.lookup(OpBB);
+        else if (isa<Argument>(Op) || isa<Instruction>(Op))
+          Slot = getSlot(Op);
+        IS.Operands.push_back(Slot);
+      }
+    }
+  }
+}
+
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  unsigned Slot;
+  if (SF.CurSlots && SF.CurSlots->I == V)
+    Slot = SF.CurSlots->Result;
+  else if (auto *A = dyn_cast<Argument>(V))
+    Slot = A->getArgNo();
+  else
+    Slot = SF.SlotMap->getSlot(V);
+  SF.Values[Slot] = Val;
 }
 
 //===----------------------------------------------------------------------===//
@@ -928,31 +975,39 @@ void Interpreter::visitIndirectBrInst(IndirectBrInst &I) {
 // results can happen.  Thus we use a two phase approach.
 //
 void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
+  // Dest is an operand of the executing terminator, which has its number.
+  unsigned DestNo = SF.CurSlots->getOperandSlot(Dest);
+  assert(DestNo != InstSlots::NoSlot && "Branch to a block not an operand?");
+  const BlockSlots &DestSlots = SF.SlotMap->getBlock(DestNo);
+
   BasicBlock *PrevBB = SF.CurBB;      // Remember where we came from...
   SF.CurBB   = Dest;                  // Update CurBB to branch destination
+  SF.CurBBNo = DestNo;
   SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
+  SF.CurInstNo = 0;
 
   if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
 
   // Loop over all of the PHI nodes in the current block, reading their inputs.
   std::vector<GenericValue> ResultValues;
 
-  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst) {
+  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst);
+       ++SF.CurInst, ++SF.CurInstNo) {
     // Search for the value corresponding to this previous bb...
     int i = PN->getBasicBlockIndex(PrevBB);
     assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
-    Value *IncomingValue = PN->getIncomingValue(i);
+    unsigned Slot = DestSlots.Insts[SF.CurInstNo].Operands[i];
 
     // Save the incoming value for this PHI node...
-    ResultValues.push_back(getOperandValue(IncomingValue, SF));
+    if (Slot != InstSlots::NoSlot)
+      ResultValues.push_back(SF.Values[Slot]);
+    else
+      ResultValues.push_back(getOperandValue(PN->getIncomingValue(i), SF));
   }
 
   // Now loop over all of the PHI nodes setting their values...
-  SF.CurInst = SF.CurBB->begin();
-  for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++i) {
-    PHINode *PN = cast<PHINode>(SF.CurInst);
-    SetValue(PN, ResultValues[i], SF);
-  }
+  for (unsigned i = 0, e = ResultValues.size(); i != e; ++i)
+    SF.Values[DestSlots.Insts[i].Result] = ResultValues[i];
 }
 
 //===----------------------------------------------------------------------===//
@@ -1091,6 +1146,15 @@ void Interpreter::visitCallSite(CallSite CS) {
       bool atBegin(Parent->begin() == me);
       if (!atBegin)
         --me;
+
+      // Recursive calls of this function that will return to the call being
+      // lowered have to resume at its replacement too.
+      std::vector<ExecutionContext *> ResumingFrames;
+      for (ExecutionContext &Frame : ECStack)
+        if (&Frame != &SF && Frame.CurBB == Parent &&
+            &*Frame.CurInst == CS.getInstruction())
+          ResumingFrames.push_back(&Frame);
+
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
 
       // Restore the CurInst pointer to the first instruction newly inserted, if
@@ -1101,6 +1165,25 @@ void Interpreter::visitCallSite(CallSite CS) {
         SF.CurInst = me;
         ++SF.CurInst;
       }
+      SF.CurSlots = nullptr;
+      for (ExecutionContext *Frame : ResumingFrames)
+        Frame->CurInst = SF.CurInst;
+
+      // Give the new instructions frame slots and resolve the function's
+      // operands again, since uses of the call now refer to the new code.
+      // Then grow every active frame of this function to match, and find
+      // its place in the new layout. Other frames are suspended at a call.
+      FunctionSlotMap &SlotMap = *FunctionSlotMaps[SF.CurFunction];
+      SlotMap.update();
+      for (ExecutionContext &Frame : ECStack) {
+        if (Frame.SlotMap != &SlotMap)
+          continue;
+        Frame.Values.resize(SlotMap.getNumSlots());
+        Frame.CurInstNo = std::distance(Frame.CurBB->begin(), Frame.CurInst);
+        if (&Frame != &SF)
+          Frame.CurSlots =
+              &SlotMap.getBlock(Frame.CurBBNo).Insts[Frame.CurInstNo - 1];
+      }
       return;
     }
 
@@ -2062,7 +2145,11 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
   } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
     return PTOGV(getPointerToGlobal(GV));
   } else {
-    return SF.Values[V];
+    unsigned Slot = SF.CurSlots ? SF.CurSlots->getOperandSlot(V)
+                                : InstSlots::NoSlot;
+    if (Slot == InstSlots::NoSlot)
+      Slot = SF.SlotMap->getSlot(V);
+    return SF.Values[Slot];
   }
 }
 
@@ -2094,6 +2181,13 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
   StackFrame.CurBB     = &F->front();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
 
+  // Lay out the frame, numbering the function's values on its first call.
+  std::unique_ptr<FunctionSlotMap> &SlotMap = FunctionSlotMaps[F];
+  if (!SlotMap)
+    SlotMap = make_unique<FunctionSlotMap>(*F);
+  StackFrame.SlotMap = SlotMap.get();
+  StackFrame.Values.resize(SlotMap->getNumSlots());
+
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
@@ -2115,6 +2209,7 @@ void Interpreter::run() {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
     Instruction &I = *SF.CurInst++;         // Increment before execute
+    SF.CurSlots = &SF.SlotMap->getBlock(SF.CurBBNo).Insts[SF.CurInstNo++];
 
     // Track the number of dynamic instructions executed.
     ++NumDynamicInsts;
@@ -14,6 +14,8 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -58,6 +60,72 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// InstSlots - The frame slots used by one instruction, resolved when its
+// function is first called so that executing it needs no lookups.  Result is
+// the slot the instruction's value is stored in.  Operands has an entry for
+// each operand: the slot of an argument or instruction, the number of a basic
+// block (for branch targets), or NoSlot for constants and globals.
+//
+struct InstSlots {
+  static const unsigned NoSlot = ~0U;
+
+  const Instruction *I;
+  unsigned Result;
+  SmallVector<unsigned, 4> Operands;
+
+  // getOperandSlot - Return the entry in Operands for V, an operand of I, or
+  // NoSlot if V is not one.
+  unsigned getOperandSlot(const Value *V) const {
+    for (unsigned i = 0, e = Operands.size(); i != e; ++i)
+      if (I->getOperand(i) == V)
+        return Operands[i];
+    return NoSlot;
+  }
+};
+
+// BlockSlots - The InstSlots of each instruction in a basic block, in order.
+//
+struct BlockSlots {
+  std::vector<InstSlots> Insts;
+};
+
+// FunctionSlotMap - Assigns a frame slot to each argument and value-producing
+// instruction of a function, so that a stack frame can hold its values in a
+// flat vector rather than a map keyed on Value*, and resolves the operands of
+// every instruction to those slots.  Arguments get the first slots, in order.
+// Built once per function, the first time the function is called.
+// Instructions are still dispatched through InstVisitor on the IR itself;
+// the slots only replace the per-value map lookups.
+//
+class FunctionSlotMap {
+  const Function &F;
+  DenseMap<const Value *, unsigned> Slots;
+  DenseMap<const BasicBlock *, unsigned> BlockNumbers;
+  std::vector<BlockSlots> Blocks;
+
+  void resolveBlocks();
+
+public:
+  explicit FunctionSlotMap(const Function &F);
+
+  // update - Assign slots to any instructions that don't have one yet and
+  // resolve all operands again.  Used when the interpreter rewrites code
+  // (e.g. lowering intrinsics).
+  void update();
+
+  unsigned getNumSlots() const { return Slots.size(); }
+
+  const BlockSlots &getBlock(unsigned BlockNo) const { return Blocks[BlockNo]; }
+
+  // getSlot - Look up the slot of V.  Only needed for values that are not
+  // operands of the instruction being executed.
+  unsigned getSlot(const Value *V) const {
+    auto I = Slots.find(V);
+    assert(I != Slots.end() && "Value has no slot in this frame!");
+    return I->second;
+  }
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -67,22 +135,34 @@ struct ExecutionContext {
   BasicBlock::iterator  CurInst;    // The next instruction to execute
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  const FunctionSlotMap *SlotMap;  // Slot numbering for CurFunction
+  unsigned CurBBNo;                // The number of CurBB in SlotMap
+  unsigned CurInstNo;              // The position of CurInst in CurBB
+  const InstSlots *CurSlots;       // Slots of the executing instruction
+  std::vector<GenericValue> Values; // LLVM values used in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   AllocaHolder Allocas;            // Track memory allocated by alloca
 
-  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr) {}
+  ExecutionContext()
+      : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr),
+        SlotMap(nullptr), CurBBNo(0), CurInstNo(0), CurSlots(nullptr) {}
 
   ExecutionContext(ExecutionContext &&O)
       : CurFunction(O.CurFunction), CurBB(O.CurBB), CurInst(O.CurInst),
-        Caller(O.Caller), Values(std::move(O.Values)),
-        VarArgs(std::move(O.VarArgs)), Allocas(std::move(O.Allocas)) {}
+        Caller(O.Caller), SlotMap(O.SlotMap), CurBBNo(O.CurBBNo),
+        CurInstNo(O.CurInstNo), CurSlots(O.CurSlots),
+        Values(std::move(O.Values)), VarArgs(std::move(O.VarArgs)),
+        Allocas(std::move(O.Allocas)) {}
 
   ExecutionContext &operator=(ExecutionContext &&O) {
     CurFunction = O.CurFunction;
     CurBB = O.CurBB;
     CurInst = O.CurInst;
     Caller = O.Caller;
+    SlotMap = O.SlotMap;
+    CurBBNo = O.CurBBNo;
+    CurInstNo = O.CurInstNo;
+    CurSlots = O.CurSlots;
     Values = std::move(O.Values);
     VarArgs = std::move(O.VarArgs);
     Allocas = std::move(O.Allocas);
@@ -104,6 +184,9 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // FunctionSlotMaps - Frame layouts for the functions called so far.
+  DenseMap<const Function *, std::unique_ptr<FunctionSlotMap>> FunctionSlotMaps;
+
 public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter() override;
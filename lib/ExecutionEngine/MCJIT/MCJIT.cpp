@@ -243,6 +243,11 @@ void MCJIT::finalizeLoadedModules() {
 
   // Set page permissions.
   MemMgr->finalizeMemory();
+
+  for (const object::ObjectFile *Obj : UnfinalizedObjects)
+    for (JITEventListener *L : EventListeners)
+      L->NotifyObjectFinalized(*Obj);
+  UnfinalizedObjects.clear();
 }
 
 // FIXME: Rename this.
@@ -643,6 +648,7 @@ void MCJIT::NotifyObjectEmitted(const object::ObjectFile& Obj,
   for (unsigned I = 0, S = EventListeners.size(); I < S; ++I) {
     EventListeners[I]->NotifyObjectEmitted(Obj, L);
   }
+  UnfinalizedObjects.push_back(&Obj);
 }
 
 void MCJIT::NotifyFreeingObject(const object::ObjectFile& Obj) {
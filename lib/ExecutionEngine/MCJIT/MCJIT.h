@@ -182,6 +182,8 @@ class MCJIT : public ExecutionEngine {
   LinkingSymbolResolver Resolver;
   RuntimeDyld Dyld;
   std::vector<JITEventListener*> EventListeners;
+  // Objects reported to the listeners that have not been finalized yet.
+  std::vector<const object::ObjectFile*> UnfinalizedObjects;
 
   OwningModuleContainer OwnedModules;
 
@@ -9,6 +9,7 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/OrcABISupport.h"
 #include "llvm/IR/CallSite.h"
@@ -22,6 +23,10 @@ namespace orc {
 void JITCompileCallbackManager::anchor() {}
 void IndirectStubsManager::anchor() {}
 
+Error IndirectStubsManager::removeStub(StringRef Name) {
+  return orcError(OrcErrorCode::StubRemovalUnsupported);
+}
+
 std::unique_ptr<JITCompileCallbackManager>
 createLocalCompileCallbackManager(const Triple &T,
                                   JITTargetAddress ErrorHandlerAddress) {
@@ -250,5 +255,21 @@ void cloneModuleFlagsMetadata(Module &Dst, const Module &Src,
     Dst.addModuleFlag(MapMetadata(MF, VMap));
 }
 
+void writeModuleToBitcode(const Module &M, SmallVectorImpl<char> &Buffer) {
+  raw_svector_ostream BitcodeStream(Buffer);
+  WriteBitcodeToFile(&M, BitcodeStream);
+}
+
+std::unique_ptr<Module> loadModuleFromBitcode(ArrayRef<char> Buffer,
+                                              StringRef Name,
+                                              LLVMContext &Ctx) {
+  auto M = parseBitcodeFile(
+      MemoryBufferRef(StringRef(Buffer.data(), Buffer.size()), Name), Ctx);
+  if (!M)
+    report_fatal_error("Couldn't reload module " + Name + ": " +
+                       M.getError().message());
+  return std::move(*M);
+}
+
 } // End namespace orc.
 } // End namespace llvm.
@@ -43,6 +43,16 @@ public:
       return "Unexpected RPC call";
     case OrcErrorCode::UnexpectedRPCResponse:
       return "Unexpected RPC response";
+    case OrcErrorCode::RPCChannelClosed:
+      return "RPC channel closed by peer";
+    case OrcErrorCode::InvalidRPCChannelRegion:
+      return "Invalid shared memory RPC channel region";
+    case OrcErrorCode::StubNotFound:
+      return "No stub with the given name";
+    case OrcErrorCode::StubRemovalUnsupported:
+      return "Stubs manager does not support removing stubs";
+    case OrcErrorCode::RedefinedFunctionNotFound:
+      return "Redefined function is not defined in the module set";
     }
     llvm_unreachable("Unhandled error code");
   }
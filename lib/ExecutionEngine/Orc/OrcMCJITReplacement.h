@@ -15,6 +15,7 @@
 #define LLVM_LIB_EXECUTIONENGINE_ORC_ORCMCJITREPLACEMENT_H
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/ExecutionEngine/Orc/LazyEmittingLayer.h"
@@ -190,6 +191,19 @@ public:
     Archives.push_back(std::move(A));
   }
 
+  void RegisterJITEventListener(JITEventListener *L) override {
+    if (L)
+      EventListeners.push_back(L);
+  }
+
+  void UnregisterJITEventListener(JITEventListener *L) override {
+    auto I = find(reverse(EventListeners), L);
+    if (I != EventListeners.rend()) {
+      std::swap(*I, EventListeners.back());
+      EventListeners.pop_back();
+    }
+  }
+
   uint64_t getSymbolAddress(StringRef Name) {
     return findSymbol(Name).getAddress();
   }
@@ -301,8 +315,13 @@ private:
       M.SectionsAllocatedSinceLastLoad = SectionAddrSet();
       assert(Objects.size() == Infos.size() &&
              "Incorrect number of Infos for Objects.");
-      for (unsigned I = 0; I < Objects.size(); ++I)
+      auto &UnfinalizedObjs = M.UnfinalizedObjects[H];
+      for (unsigned I = 0; I < Objects.size(); ++I) {
         M.MemMgr.notifyObjectLoaded(&M, getObject(*Objects[I]));
+        for (JITEventListener *L : M.EventListeners)
+          L->NotifyObjectEmitted(getObject(*Objects[I]), *Infos[I]);
+        UnfinalizedObjs.push_back(&getObject(*Objects[I]));
+      }
     }
 
   private:
@@ -325,6 +344,13 @@ private:
     NotifyFinalizedT(OrcMCJITReplacement &M) : M(M) {}
     void operator()(ObjectLinkingLayerBase::ObjSetHandleT H) {
       M.UnfinalizedSections.erase(H);
+      auto I = M.UnfinalizedObjects.find(H);
+      if (I == M.UnfinalizedObjects.end())
+        return;
+      for (const object::ObjectFile *Obj : I->second)
+        for (JITEventListener *L : M.EventListeners)
+          L->NotifyObjectFinalized(*Obj);
+      M.UnfinalizedObjects.erase(I);
     }
 
   private:
@@ -370,8 +396,14 @@ private:
   SectionAddrSet SectionsAllocatedSinceLastLoad;
   std::map<ObjectLayerT::ObjSetHandleT, SectionAddrSet, ObjSetHandleCompare>
       UnfinalizedSections;
+  // The objects of each of those sets, to report to the event listeners once
+  // they are finalized.
+  std::map<ObjectLayerT::ObjSetHandleT, std::vector<const object::ObjectFile *>,
+           ObjSetHandleCompare>
+      UnfinalizedObjects;
 
   std::vector<object::OwningBinary<object::Archive>> Archives;
+  std::vector<JITEventListener *> EventListeners;
 };
 
 } // End namespace orc.
@@ -0,0 +1,282 @@
+//===-- SharedMemoryRPCChannel.cpp - RPC channel over shared memory -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRPCChannel.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef LLVM_ON_UNIX
+#include <poll.h>
+#endif
+
+using namespace llvm;
+using namespace llvm::orc;
+using namespace llvm::orc::remote;
+
+// Head and Tail are free-running byte counts, so the ring is empty when they
+// are equal and full when they are RingSize apart. Only the writer stores to
+// Head and only the reader stores to Tail. They live on separate cache lines
+// so that the two ends don't contend.
+struct SharedMemoryRPCChannel::Ring {
+  alignas(64) std::atomic<uint64_t> Head;
+  alignas(64) std::atomic<uint64_t> Tail;
+};
+
+// The region starts with this header and is followed by the data of the two
+// rings. The creating end writes into Rings[0].
+struct SharedMemoryRPCChannel::RegionHeader {
+  static const uint64_t ExpectedMagic = 0x4f52435348524d31ULL; // "ORCSHRM1"
+
+  uint64_t Magic;
+  uint64_t RingSize;
+  std::atomic<uint32_t> Closed;
+  Ring Rings[2];
+
+  RegionHeader(uint64_t RingSize)
+      : Magic(ExpectedMagic), RingSize(RingSize), Closed(0) {
+    for (auto &R : Rings) {
+      R.Head.store(0, std::memory_order_relaxed);
+      R.Tail.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  static uint64_t getDataOffset() { return alignTo(sizeof(RegionHeader), 64); }
+
+  static uint64_t getRegionSize(uint64_t RingSize) {
+    return getDataOffset() + 2 * RingSize;
+  }
+};
+
+namespace {
+
+// Waits used while the ring is empty (reader) or full (writer). RPC replies
+// usually arrive quickly, so spin first; a peer that is busy or idle gets the
+// CPU back through yields and then short sleeps.
+class Backoff {
+public:
+  void wait() {
+    ++Spins;
+    if (Spins < 128)
+      return;
+    if (Spins < 1024)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+
+  /// True once the waits have become sleeps, i.e. the peer has been silent
+  /// long enough that checking whether it is still alive is worth a system
+  /// call.
+  bool isSleeping() const { return Spins >= 1024; }
+
+private:
+  unsigned Spins = 0;
+};
+
+} // end anonymous namespace
+
+static Expected<std::unique_ptr<sys::fs::mapped_file_region>>
+mapRegion(int FD, uint64_t Size) {
+  std::error_code EC;
+  auto Region = llvm::make_unique<sys::fs::mapped_file_region>(
+      FD, sys::fs::mapped_file_region::readwrite, Size, 0, EC);
+  if (EC)
+    return errorCodeToError(EC);
+  return std::move(Region);
+}
+
+namespace {
+
+// Closes the peer's liveness descriptor if create or attach fails before the
+// channel takes ownership of it.
+class PeerFDOwner {
+public:
+  PeerFDOwner(int FD) : FD(FD) {}
+  ~PeerFDOwner() {
+    if (FD != -1)
+      sys::Process::SafelyCloseFileDescriptor(FD);
+  }
+  int release() {
+    int Result = FD;
+    FD = -1;
+    return Result;
+  }
+
+private:
+  int FD;
+};
+
+} // end anonymous namespace
+
+Expected<std::unique_ptr<SharedMemoryRPCChannel>>
+SharedMemoryRPCChannel::create(int FD, uint64_t RingSize, int PeerFD) {
+  PeerFDOwner Peer(PeerFD);
+  static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                "Shared memory channels require lock-free atomics");
+
+  if (!isPowerOf2_64(RingSize))
+    return orcError(OrcErrorCode::InvalidRPCChannelRegion);
+
+  uint64_t Size = RegionHeader::getRegionSize(RingSize);
+  if (auto EC = sys::fs::resize_file(FD, Size))
+    return errorCodeToError(EC);
+
+  auto Region = mapRegion(FD, Size);
+  if (!Region)
+    return Region.takeError();
+  new ((*Region)->data()) RegionHeader(RingSize);
+
+  return std::unique_ptr<SharedMemoryRPCChannel>(
+      new SharedMemoryRPCChannel(std::move(*Region), /*IsCreator=*/true,
+                                 Peer.release()));
+}
+
+Expected<std::unique_ptr<SharedMemoryRPCChannel>>
+SharedMemoryRPCChannel::attach(int FD, int PeerFD) {
+  PeerFDOwner Peer(PeerFD);
+  sys::fs::file_status Status;
+  if (auto EC = sys::fs::status(FD, Status))
+    return errorCodeToError(EC);
+
+  uint64_t Size = Status.getSize();
+  if (Size < RegionHeader::getDataOffset())
+    return orcError(OrcErrorCode::InvalidRPCChannelRegion);
+
+  auto Region = mapRegion(FD, Size);
+  if (!Region)
+    return Region.takeError();
+
+  auto *Header = reinterpret_cast<RegionHeader *>((*Region)->data());
+  if (Header->Magic != RegionHeader::ExpectedMagic ||
+      !isPowerOf2_64(Header->RingSize) ||
+      RegionHeader::getRegionSize(Header->RingSize) != Size)
+    return orcError(OrcErrorCode::InvalidRPCChannelRegion);
+
+  return std::unique_ptr<SharedMemoryRPCChannel>(
+      new SharedMemoryRPCChannel(std::move(*Region), /*IsCreator=*/false,
+                                 Peer.release()));
+}
+
+SharedMemoryRPCChannel::SharedMemoryRPCChannel(
+    std::unique_ptr<sys::fs::mapped_file_region> Region, bool IsCreator,
+    int PeerFD)
+    : Region(std::move(Region)), PeerFD(PeerFD) {
+  char *Base = this->Region->data();
+  Header = reinterpret_cast<RegionHeader *>(Base);
+  Mask = Header->RingSize - 1;
+
+  char *Data = Base + RegionHeader::getDataOffset();
+  unsigned OutIdx = IsCreator ? 0 : 1;
+  Out = &Header->Rings[OutIdx];
+  OutData = Data + OutIdx * Header->RingSize;
+  In = &Header->Rings[1 - OutIdx];
+  InData = Data + (1 - OutIdx) * Header->RingSize;
+
+  WritePos = Out->Head.load(std::memory_order_relaxed);
+}
+
+SharedMemoryRPCChannel::~SharedMemoryRPCChannel() {
+  // Anything still unpublished can be drained by the peer after it sees the
+  // channel close.
+  publish();
+  Header->Closed.store(1, std::memory_order_release);
+  if (PeerFD != -1)
+    sys::Process::SafelyCloseFileDescriptor(PeerFD);
+}
+
+void SharedMemoryRPCChannel::publish() {
+  Out->Head.store(WritePos, std::memory_order_release);
+}
+
+bool SharedMemoryRPCChannel::peerExited() const {
+#ifdef LLVM_ON_UNIX
+  if (PeerFD == -1)
+    return false;
+  // Nobody ever writes to the pipe, so it only becomes ready once the last
+  // write end, held by the peer, is closed.
+  struct pollfd P;
+  P.fd = PeerFD;
+  P.events = POLLIN;
+  P.revents = 0;
+  return ::poll(&P, 1, 0) > 0 && P.revents != 0;
+#else
+  return false;
+#endif
+}
+
+Error SharedMemoryRPCChannel::readBytes(char *Dst, unsigned Size) {
+  assert(Dst && "Attempt to read into null.");
+  uint64_t Tail = In->Tail.load(std::memory_order_relaxed);
+  Backoff Wait;
+  while (Size != 0) {
+    uint64_t Available = In->Head.load(std::memory_order_acquire) - Tail;
+    if (Available == 0) {
+      // Re-check the ring after seeing the close: the peer publishes before
+      // it closes, and may have published before it died.
+      if ((Header->Closed.load(std::memory_order_acquire) ||
+           (Wait.isSleeping() && peerExited())) &&
+          In->Head.load(std::memory_order_acquire) == Tail)
+        return orcError(OrcErrorCode::RPCChannelClosed);
+      Wait.wait();
+      continue;
+    }
+
+    uint64_t Offset = Tail & Mask;
+    uint64_t Chunk = std::min<uint64_t>(Available, Size);
+    // Stop at the end of the ring; the rest wraps around next time.
+    Chunk = std::min(Chunk, Mask + 1 - Offset);
+    memcpy(Dst, InData + Offset, Chunk);
+    Tail += Chunk;
+    In->Tail.store(Tail, std::memory_order_release);
+    Dst += Chunk;
+    Size -= Chunk;
+  }
+  return Error::success();
+}
+
+Error SharedMemoryRPCChannel::appendBytes(const char *Src, unsigned Size) {
+  assert(Src && "Attempt to append from null.");
+  Backoff Wait;
+  while (Size != 0) {
+    uint64_t Free =
+        Mask + 1 - (WritePos - Out->Tail.load(std::memory_order_acquire));
+    if (Free == 0) {
+      // The message doesn't fit: let the peer drain what we have so far.
+      publish();
+      if (Header->Closed.load(std::memory_order_acquire) ||
+          (Wait.isSleeping() && peerExited()))
+        return orcError(OrcErrorCode::RPCChannelClosed);
+      Wait.wait();
+      continue;
+    }
+
+    uint64_t Offset = WritePos & Mask;
+    uint64_t Chunk = std::min<uint64_t>(Free, Size);
+    // Stop at the end of the ring; the rest wraps around next time.
+    Chunk = std::min(Chunk, Mask + 1 - Offset);
+    memcpy(OutData + Offset, Src, Chunk);
+    WritePos += Chunk;
+    Src += Chunk;
+    Size -= Chunk;
+  }
+  return Error::success();
+}
+
+Error SharedMemoryRPCChannel::send() {
+  if (Header->Closed.load(std::memory_order_acquire))
+    return orcError(OrcErrorCode::RPCChannelClosed);
+  publish();
+  return Error::success();
+}
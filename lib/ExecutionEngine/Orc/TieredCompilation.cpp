@@ -0,0 +1,122 @@
+//===--- TieredCompilation.cpp - Profile-driven re-optimization in Orc ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/TieredCompilation.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+// Emit a relaxed increment of the counter at CounterAddr. Monotonic accesses
+// compile to plain loads and stores on the usual JIT targets, but keep the
+// concurrent reads in takeHotModules well defined.
+static void emitCounterIncrement(IRBuilder<> &Builder, Value *CounterAddr) {
+  LoadInst *Count = Builder.CreateAlignedLoad(CounterAddr, 8);
+  Count->setAtomic(AtomicOrdering::Monotonic);
+  StoreInst *Store = Builder.CreateAlignedStore(
+      Builder.CreateAdd(Count, Builder.getInt64(1)), CounterAddr, 8);
+  Store->setAtomic(AtomicOrdering::Monotonic);
+}
+
+static void instrumentFunction(Function &F, std::atomic<uint64_t> &Counter) {
+  LLVMContext &Ctx = F.getContext();
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  Constant *CounterAddr = ConstantExpr::getIntToPtr(
+      ConstantInt::get(DL.getIntPtrType(Ctx),
+                       reinterpret_cast<uintptr_t>(&Counter)),
+      Type::getInt64PtrTy(Ctx));
+
+  // Find the loop headers: targets of edges whose source they dominate. This
+  // must happen before we insert anything.
+  DominatorTree DT(F);
+  SmallPtrSet<BasicBlock *, 8> LoopHeaders;
+  for (auto &BB : F)
+    for (auto *Succ : successors(&BB))
+      if (DT.dominates(Succ, &BB))
+        LoopHeaders.insert(Succ);
+
+  // Count function entries after the entry block's static allocas.
+  BasicBlock &Entry = F.getEntryBlock();
+  BasicBlock::iterator EntryIP = Entry.getFirstInsertionPt();
+  while (isa<AllocaInst>(EntryIP))
+    ++EntryIP;
+  IRBuilder<> Builder(&Entry, EntryIP);
+  emitCounterIncrement(Builder, CounterAddr);
+
+  // Count loop iterations.
+  for (auto *Header : LoopHeaders) {
+    if (Header->isEHPad())
+      continue;
+    Builder.SetInsertPoint(Header, Header->getFirstInsertionPt());
+    emitCounterIncrement(Builder, CounterAddr);
+  }
+}
+
+std::unique_ptr<Module>
+TierUpProfiler::instrument(std::unique_ptr<Module> M) {
+  ProfiledModule PM;
+  for (auto &F : *M)
+    if (!F.isDeclaration() && !F.hasAvailableExternallyLinkage())
+      PM.Saved.FunctionNames.push_back(F.getName());
+
+  // Nothing to profile in modules without function bodies (e.g. the globals
+  // module emitted by the compile-on-demand layer).
+  if (PM.Saved.FunctionNames.empty())
+    return M;
+
+  // Save the uninstrumented IR for re-optimization.
+  {
+    raw_svector_ostream BitcodeStream(PM.Saved.Bitcode);
+    WriteBitcodeToFile(M.get(), BitcodeStream);
+  }
+
+  std::lock_guard<std::mutex> Lock(ProfilerMutex);
+  for (auto &F : *M) {
+    if (F.isDeclaration() || F.hasAvailableExternallyLinkage())
+      continue;
+    Counters.emplace_back(0);
+    instrumentFunction(F, Counters.back());
+    PM.Counters.push_back(&Counters.back());
+  }
+  ColdModules.push_back(std::move(PM));
+  return M;
+}
+
+std::vector<TierUpProfiler::HotModule> TierUpProfiler::takeHotModules() {
+  std::vector<HotModule> Hot;
+  std::lock_guard<std::mutex> Lock(ProfilerMutex);
+
+  auto IsHot = [this](const ProfiledModule &PM) {
+    for (auto *Counter : PM.Counters)
+      if (Counter->load(std::memory_order_relaxed) >= HotThreshold)
+        return true;
+    return false;
+  };
+
+  unsigned NumCold = 0;
+  for (unsigned I = 0, E = ColdModules.size(); I != E; ++I) {
+    if (IsHot(ColdModules[I]))
+      Hot.push_back(std::move(ColdModules[I].Saved));
+    else if (I != NumCold++)
+      ColdModules[NumCold - 1] = std::move(ColdModules[I]);
+  }
+  ColdModules.resize(NumCold);
+  return Hot;
+}
+
+ErrorOr<std::unique_ptr<Module>>
+TierUpProfiler::loadHotModule(const HotModule &Hot, LLVMContext &Context) {
+  StringRef Bitcode(Hot.Bitcode.data(), Hot.Bitcode.size());
+  return parseBitcodeFile(MemoryBufferRef(Bitcode, "tier-up"), Context);
+}
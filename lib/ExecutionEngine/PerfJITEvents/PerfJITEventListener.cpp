@@ -0,0 +1,430 @@
+//===-- PerfJITEventListener.cpp - Tell Linux's perf about JITted code ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a JITEventListener object that describes JITted functions
+// to the Linux perf tool. Each function is recorded in a perf map file
+// (perf-<pid>.map), which 'perf report' reads to name JITted addresses, and in
+// a jitdump file (jit-<pid>.dump), which also carries the code bytes and source
+// line information and can be merged into a profile with 'perf inject --jit'.
+// The jitdump format is described in the perf sources, in
+// tools/perf/Documentation/jitdump-specification.txt.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Config/config.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#ifdef LLVM_ON_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+using namespace llvm;
+using namespace llvm::object;
+
+#define DEBUG_TYPE "perf-jit-event-listener"
+
+#ifdef LLVM_ON_UNIX
+
+namespace {
+
+// Record types and constants from the jitdump specification.
+enum JITDumpRecordType : uint32_t {
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_DEBUG_INFO = 2,
+  JIT_CODE_CLOSE = 3
+};
+
+static const uint32_t JITDumpMagic = 0x4A695444; // "JiTD"
+static const uint32_t JITDumpVersion = 1;
+static const uint32_t JITDumpHeaderSize = 40;
+static const uint32_t JITDumpRecordHeaderSize = 16;
+
+// The perf map and jitdump files in one directory. Their names only depend on
+// the process id, so every listener writing to the same directory shares one
+// PerfJITOutput: opening the files again would truncate what the others
+// wrote. All members are guarded by Mutex.
+class PerfJITOutput {
+public:
+  /// Return the output for OutputDir, opening its files if no live listener
+  /// uses them. Files that an earlier listener in this process wrote are
+  /// appended to rather than truncated.
+  static std::shared_ptr<PerfJITOutput> get(StringRef OutputDir);
+
+  ~PerfJITOutput();
+
+  struct FunctionInfo {
+    std::string Name;
+    uint64_t Addr;
+    uint64_t Size;
+    DILineInfoTable Lines;
+  };
+
+  /// Describe Functions, whose code must be final, in both files.
+  void writeFunctions(ArrayRef<FunctionInfo> Functions);
+
+private:
+  PerfJITOutput(StringRef OutputDir, bool Append);
+
+  void openPerfMap(StringRef OutputDir, bool Append);
+  void openJITDump(StringRef OutputDir, bool Append);
+
+  void writeRecordHeader(JITDumpRecordType Type, uint64_t Size);
+  void writeDebugInfoRecord(uint64_t CodeAddr, const DILineInfoTable &Lines);
+  void writeCodeLoadRecord(StringRef Name, uint64_t CodeAddr,
+                           uint64_t CodeSize);
+
+  // perf timestamps JIT records with CLOCK_MONOTONIC, which is what
+  // steady_clock is built on for the hosts perf runs on.
+  static uint64_t getTimestamp() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  std::mutex Mutex;
+  uint32_t Pid;
+  uint64_t CodeIndex = 0;
+  std::unique_ptr<raw_fd_ostream> PerfMap;
+  std::unique_ptr<raw_fd_ostream> JITDump;
+  // perf only finds the jitdump file if the process maps it executable; the
+  // mapping shows up as an mmap event in the profile.
+  void *JITDumpMarker = nullptr;
+  size_t JITDumpMarkerSize = 0;
+};
+
+class PerfJITEventListener : public JITEventListener {
+public:
+  PerfJITEventListener(StringRef OutputDir)
+      : Output(PerfJITOutput::get(OutputDir)) {}
+
+  void NotifyObjectEmitted(const ObjectFile &Obj,
+                           const RuntimeDyld::LoadedObjectInfo &L) override;
+  void NotifyObjectFinalized(const ObjectFile &Obj) override;
+  void NotifyFreeingObject(const ObjectFile &Obj) override;
+
+private:
+  std::shared_ptr<PerfJITOutput> Output;
+
+  // The functions of each object that has been emitted but not finalized.
+  // Their code is only read once relocations have been applied to it.
+  std::mutex PendingMutex;
+  std::map<const ObjectFile *, std::vector<PerfJITOutput::FunctionInfo>>
+      Pending;
+};
+
+static uint32_t getELFMachine(const Triple &TT) {
+  switch (TT.getArch()) {
+  case Triple::aarch64:
+  case Triple::aarch64_be:
+    return ELF::EM_AARCH64;
+  case Triple::arm:
+  case Triple::armeb:
+  case Triple::thumb:
+  case Triple::thumbeb:
+    return ELF::EM_ARM;
+  case Triple::mips:
+  case Triple::mipsel:
+  case Triple::mips64:
+  case Triple::mips64el:
+    return ELF::EM_MIPS;
+  case Triple::ppc:
+    return ELF::EM_PPC;
+  case Triple::ppc64:
+  case Triple::ppc64le:
+    return ELF::EM_PPC64;
+  case Triple::systemz:
+    return ELF::EM_S390;
+  case Triple::x86:
+    return ELF::EM_386;
+  case Triple::x86_64:
+    return ELF::EM_X86_64;
+  default:
+    return ELF::EM_NONE;
+  }
+}
+
+static uint32_t getThreadId() {
+#ifdef __linux__
+  return static_cast<uint32_t>(::syscall(SYS_gettid));
+#else
+  return static_cast<uint32_t>(::getpid());
+#endif
+}
+
+std::shared_ptr<PerfJITOutput> PerfJITOutput::get(StringRef OutputDir) {
+  static std::mutex OutputsMutex;
+  // Keyed on directory and pid, so that a forked child starts its own files.
+  static StringMap<std::weak_ptr<PerfJITOutput>> Outputs;
+
+  std::lock_guard<std::mutex> Lock(OutputsMutex);
+  std::string Key = (OutputDir + "/" + Twine(::getpid())).str();
+  auto I = Outputs.find(Key);
+  if (I != Outputs.end())
+    if (auto Output = I->second.lock())
+      return Output;
+
+  std::shared_ptr<PerfJITOutput> Output(
+      new PerfJITOutput(OutputDir, /*Append=*/I != Outputs.end()));
+  Outputs[Key] = Output;
+  return Output;
+}
+
+PerfJITOutput::PerfJITOutput(StringRef OutputDir, bool Append)
+    : Pid(static_cast<uint32_t>(::getpid())) {
+  openPerfMap(OutputDir, Append);
+  openJITDump(OutputDir, Append);
+}
+
+void PerfJITOutput::openPerfMap(StringRef OutputDir, bool Append) {
+  SmallString<128> Path(OutputDir);
+  sys::path::append(Path, "perf-" + Twine(Pid) + ".map");
+
+  std::error_code EC;
+  PerfMap.reset(new raw_fd_ostream(
+      Path, EC, Append ? sys::fs::F_Text | sys::fs::F_Append : sys::fs::F_Text));
+  if (EC) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": " << EC.message() << "\n");
+    PerfMap.reset();
+  }
+}
+
+void PerfJITOutput::openJITDump(StringRef OutputDir, bool Append) {
+  SmallString<128> Path(OutputDir);
+  sys::path::append(Path, "jit-" + Twine(Pid) + ".dump");
+
+  // The marker mapping needs read access, so this can't go through
+  // sys::fs::openFileForWrite.
+  int FD = ::open(Path.c_str(),
+                  O_CREAT | (Append ? O_APPEND : O_TRUNC) | O_RDWR | O_CLOEXEC,
+                  0666);
+  if (FD < 0) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": " << sys::StrError()
+                 << "\n");
+    return;
+  }
+  JITDump.reset(new raw_fd_ostream(FD, /*shouldClose=*/true));
+
+  if (!Append) {
+    support::endian::Writer<support::native> W(*JITDump);
+    W.write<uint32_t>(JITDumpMagic);
+    W.write<uint32_t>(JITDumpVersion);
+    W.write<uint32_t>(JITDumpHeaderSize);
+    W.write<uint32_t>(getELFMachine(Triple(sys::getProcessTriple())));
+    W.write<uint32_t>(0); // pad1
+    W.write<uint32_t>(Pid);
+    W.write<uint64_t>(getTimestamp());
+    W.write<uint64_t>(0); // flags
+    JITDump->flush();
+  }
+
+  JITDumpMarkerSize = sys::Process::getPageSize();
+  JITDumpMarker = ::mmap(nullptr, JITDumpMarkerSize, PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE, FD, 0);
+  if (JITDumpMarker == MAP_FAILED) {
+    DEBUG(dbgs() << "Failed to map " << Path << ": " << sys::StrError()
+                 << "\n");
+    JITDumpMarker = nullptr;
+  }
+}
+
+PerfJITOutput::~PerfJITOutput() {
+  if (JITDump) {
+    writeRecordHeader(JIT_CODE_CLOSE, JITDumpRecordHeaderSize);
+    JITDump->flush();
+  }
+  if (JITDumpMarker)
+    ::munmap(JITDumpMarker, JITDumpMarkerSize);
+}
+
+void PerfJITOutput::writeRecordHeader(JITDumpRecordType Type, uint64_t Size) {
+  support::endian::Writer<support::native> W(*JITDump);
+  W.write<uint32_t>(Type);
+  W.write<uint32_t>(static_cast<uint32_t>(Size));
+  W.write<uint64_t>(getTimestamp());
+}
+
+void PerfJITOutput::writeDebugInfoRecord(uint64_t CodeAddr,
+                                         const DILineInfoTable &Lines) {
+  uint64_t Size = JITDumpRecordHeaderSize + 16;
+  for (auto &Line : Lines)
+    Size += 16 + Line.second.FileName.size() + 1;
+
+  writeRecordHeader(JIT_CODE_DEBUG_INFO, Size);
+  support::endian::Writer<support::native> W(*JITDump);
+  W.write<uint64_t>(CodeAddr);
+  W.write<uint64_t>(Lines.size());
+  for (auto &Line : Lines) {
+    W.write<uint64_t>(Line.first);
+    W.write<uint32_t>(Line.second.Line);
+    W.write<uint32_t>(0); // discriminator
+    *JITDump << Line.second.FileName << '\0';
+  }
+}
+
+void PerfJITOutput::writeCodeLoadRecord(StringRef Name, uint64_t CodeAddr,
+                                        uint64_t CodeSize) {
+  uint64_t Size = JITDumpRecordHeaderSize + 40 + Name.size() + 1 + CodeSize;
+
+  writeRecordHeader(JIT_CODE_LOAD, Size);
+  support::endian::Writer<support::native> W(*JITDump);
+  W.write<uint32_t>(Pid);
+  W.write<uint32_t>(getThreadId());
+  W.write<uint64_t>(CodeAddr); // vma
+  W.write<uint64_t>(CodeAddr);
+  W.write<uint64_t>(CodeSize);
+  W.write<uint64_t>(CodeIndex++);
+  *JITDump << Name << '\0';
+  JITDump->write(reinterpret_cast<const char *>(CodeAddr), CodeSize);
+}
+
+void PerfJITOutput::writeFunctions(ArrayRef<FunctionInfo> Functions) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+
+  for (const FunctionInfo &F : Functions) {
+    if (PerfMap)
+      *PerfMap << format_hex_no_prefix(F.Addr, 1) << ' '
+               << format_hex_no_prefix(F.Size, 1) << ' ' << F.Name << '\n';
+
+    if (JITDump) {
+      // perf expects a function's line table before its code.
+      if (!F.Lines.empty())
+        writeDebugInfoRecord(F.Addr, F.Lines);
+      writeCodeLoadRecord(F.Name, F.Addr, F.Size);
+    }
+  }
+
+  // Flush now: JIT'd programs often leave through exit() or a crash, which
+  // would skip the destructor.
+  if (PerfMap)
+    PerfMap->flush();
+  if (JITDump)
+    JITDump->flush();
+}
+
+void PerfJITEventListener::NotifyObjectEmitted(
+    const ObjectFile &Obj, const RuntimeDyld::LoadedObjectInfo &L) {
+  OwningBinary<ObjectFile> DebugObjOwner = L.getObjectForDebug(Obj);
+  if (!DebugObjOwner.getBinary())
+    return;
+  const ObjectFile &DebugObj = *DebugObjOwner.getBinary();
+  DWARFContextInMemory Context(DebugObj);
+
+  // Collect the functions now, while the debug object is at hand; their code
+  // is written out once it has been finalized.
+  std::vector<PerfJITOutput::FunctionInfo> Functions;
+  for (const std::pair<SymbolRef, uint64_t> &P : computeSymbolSizes(DebugObj)) {
+    SymbolRef Sym = P.first;
+    Expected<SymbolRef::Type> SymTypeOrErr = Sym.getType();
+    if (!SymTypeOrErr) {
+      consumeError(SymTypeOrErr.takeError());
+      continue;
+    }
+    if (*SymTypeOrErr != SymbolRef::ST_Function)
+      continue;
+
+    Expected<StringRef> Name = Sym.getName();
+    if (!Name) {
+      consumeError(Name.takeError());
+      continue;
+    }
+
+    Expected<uint64_t> AddrOrErr = Sym.getAddress();
+    if (!AddrOrErr) {
+      consumeError(AddrOrErr.takeError());
+      continue;
+    }
+    uint64_t Addr = *AddrOrErr;
+    uint64_t Size = P.second;
+    if (!Size)
+      continue;
+
+    PerfJITOutput::FunctionInfo F;
+    F.Name = *Name;
+    F.Addr = Addr;
+    F.Size = Size;
+    F.Lines = Context.getLineInfoForAddressRange(
+        Addr, Size,
+        DILineInfoSpecifier(
+            DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath));
+    Functions.push_back(std::move(F));
+  }
+
+  std::lock_guard<std::mutex> Lock(PendingMutex);
+  Pending[&Obj] = std::move(Functions);
+}
+
+void PerfJITEventListener::NotifyObjectFinalized(const ObjectFile &Obj) {
+  std::vector<PerfJITOutput::FunctionInfo> Functions;
+  {
+    std::lock_guard<std::mutex> Lock(PendingMutex);
+    auto I = Pending.find(&Obj);
+    if (I == Pending.end())
+      return;
+    Functions = std::move(I->second);
+    Pending.erase(I);
+  }
+  Output->writeFunctions(Functions);
+}
+
+void PerfJITEventListener::NotifyFreeingObject(const ObjectFile &Obj) {
+  std::lock_guard<std::mutex> Lock(PendingMutex);
+  Pending.erase(&Obj);
+}
+
+} // end anonymous namespace
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener() {
+  return createPerfJITEventListener("/tmp");
+}
+
+JITEventListener *
+JITEventListener::createPerfJITEventListener(StringRef OutputDir) {
+  return new PerfJITEventListener(OutputDir);
+}
+} // end namespace llvm
+
+#else // LLVM_ON_UNIX
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener() {
+  return nullptr;
+}
+
+JITEventListener *
+JITEventListener::createPerfJITEventListener(StringRef OutputDir) {
+  return nullptr;
+}
+} // end namespace llvm
+
+#endif // LLVM_ON_UNIX
@@ -0,0 +1,261 @@
+//===- PooledSectionMemoryManager.cpp - Pooled JIT section memory ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements SectionMemoryPool and PooledSectionMemoryManager.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledSectionMemoryManager.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+
+using namespace llvm;
+
+static const unsigned ReadWrite = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+
+const size_t SectionMemoryPool::HugePageSize;
+const size_t PooledSectionMemoryManager::MinBlockSize;
+
+//===----------------------------------------------------------------------===//
+// SectionMemoryPool
+//===----------------------------------------------------------------------===//
+
+SectionMemoryPool::SectionMemoryPool(size_t SlabSize, bool UseHugePages)
+    : SlabSize(alignTo(std::max<size_t>(SlabSize, 1), HugePageSize)),
+      UseHugePages(UseHugePages) {}
+
+SectionMemoryPool::~SectionMemoryPool() {
+  for (sys::MemoryBlock &Slab : Slabs)
+    sys::Memory::releaseMappedMemory(Slab);
+}
+
+std::error_code SectionMemoryPool::addSlab(SlabClass &Class, size_t MinSize) {
+  size_t Usable = alignTo(std::max(SlabSize, MinSize), HugePageSize);
+
+  // Over-allocate by a huge page so that the usable part can be aligned. The
+  // slack is never touched, so it costs address space but no memory. Slabs
+  // of every class are kept near each other, since code refers to data with
+  // PC-relative relocations too.
+  std::error_code EC;
+  const sys::MemoryBlock *Near = Slabs.empty() ? nullptr : &Slabs.back();
+  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(
+      Usable + HugePageSize, Near, ReadWrite, EC);
+  if (EC)
+    return EC;
+  Slabs.push_back(MB);
+
+  uintptr_t Start = alignTo((uintptr_t)MB.base(), HugePageSize);
+  // Huge pages are only an optimization, so ignore failures here.
+  if (UseHugePages)
+    sys::Memory::adviseHugePages(sys::MemoryBlock((void *)Start, Usable));
+
+  Class.FreeRanges[Start] = Usable;
+  Class.SlabStarts.insert(Start);
+  return std::error_code();
+}
+
+sys::MemoryBlock SectionMemoryPool::allocate(size_t Size,
+                                             AllocationPurpose Purpose,
+                                             std::error_code &EC) {
+  static const size_t PageSize = sys::Process::getPageSize();
+  Size = alignTo(std::max<size_t>(Size, 1), PageSize);
+  EC = std::error_code();
+
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  SlabClass &Class = getSlabClass(Purpose);
+  auto &FreeRanges = Class.FreeRanges;
+
+  // First fit, lowest address first, to keep the live memory compact.
+  auto FirstFit = [&]() {
+    return std::find_if(
+        FreeRanges.begin(), FreeRanges.end(),
+        [&](const std::pair<const uintptr_t, size_t> &R) {
+          return R.second >= Size;
+        });
+  };
+
+  auto I = FirstFit();
+  if (I == FreeRanges.end()) {
+    if ((EC = addSlab(Class, Size)))
+      return sys::MemoryBlock();
+    I = FirstFit();
+    assert(I != FreeRanges.end() && "New slab too small");
+  }
+
+  uintptr_t Addr = I->first;
+  size_t Remaining = I->second - Size;
+  FreeRanges.erase(I);
+  if (Remaining)
+    FreeRanges[Addr + Size] = Remaining;
+  return sys::MemoryBlock((void *)Addr, Size);
+}
+
+void SectionMemoryPool::deallocate(sys::MemoryBlock Block,
+                                   AllocationPurpose Purpose) {
+  if (!Block.base() || !Block.size())
+    return;
+
+  // If the block can't be made writable again it can't be reused either;
+  // leave it out of the free list.
+  if (sys::Memory::protectMappedMemory(Block, ReadWrite))
+    return;
+
+  uintptr_t Start = (uintptr_t)Block.base();
+  size_t Size = Block.size();
+
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  SlabClass &Class = getSlabClass(Purpose);
+  auto &FreeRanges = Class.FreeRanges;
+  auto &SlabStarts = Class.SlabStarts;
+
+  // Coalesce with the neighbouring free ranges, but never across slabs: on
+  // some platforms permissions can't be changed across separate mappings.
+  auto Next = FreeRanges.lower_bound(Start);
+  if (Next != FreeRanges.end() && Start + Size == Next->first &&
+      !SlabStarts.count(Next->first)) {
+    Size += Next->second;
+    Next = FreeRanges.erase(Next);
+  }
+  if (Next != FreeRanges.begin() && !SlabStarts.count(Start)) {
+    auto Prev = std::prev(Next);
+    if (Prev->first + Prev->second == Start) {
+      Prev->second += Size;
+      return;
+    }
+  }
+  FreeRanges[Start] = Size;
+}
+
+size_t SectionMemoryPool::getNumSlabs() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  return Slabs.size();
+}
+
+size_t SectionMemoryPool::getNumFreeBytes() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  size_t Free = 0;
+  for (const SlabClass &Class : Classes)
+    for (auto &R : Class.FreeRanges)
+      Free += R.second;
+  return Free;
+}
+
+//===----------------------------------------------------------------------===//
+// PooledSectionMemoryManager
+//===----------------------------------------------------------------------===//
+
+PooledSectionMemoryManager::~PooledSectionMemoryManager() {
+  for (MemoryGroup *Group : {&CodeMem, &RWDataMem, &RODataMem})
+    for (sys::MemoryBlock &Block : Group->Blocks)
+      Pool.deallocate(Block, Group->Purpose);
+}
+
+uint8_t *PooledSectionMemoryManager::allocateCodeSection(
+    uintptr_t Size, unsigned Alignment, unsigned SectionID,
+    StringRef SectionName) {
+  return allocateSection(CodeMem, Size, Alignment);
+}
+
+uint8_t *PooledSectionMemoryManager::allocateDataSection(
+    uintptr_t Size, unsigned Alignment, unsigned SectionID,
+    StringRef SectionName, bool IsReadOnly) {
+  if (IsReadOnly)
+    return allocateSection(RODataMem, Size, Alignment);
+  return allocateSection(RWDataMem, Size, Alignment);
+}
+
+uint8_t *PooledSectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
+                                                     uintptr_t Size,
+                                                     unsigned Alignment) {
+  if (!Alignment)
+    Alignment = 16;
+
+  assert(isPowerOf2_32(Alignment) && "Alignment must be a power of two.");
+
+  // Give empty sections a byte so that they don't alias the next block.
+  Size = std::max<uintptr_t>(Size, 1);
+
+  uintptr_t Addr = alignTo(MemGroup.Cur, Alignment);
+  if (!MemGroup.Cur || Addr + Size > MemGroup.End) {
+    closePendingRange(MemGroup);
+
+    std::error_code EC;
+    sys::MemoryBlock MB =
+        Pool.allocate(std::max<size_t>(MinBlockSize, Size + Alignment),
+                      MemGroup.Purpose, EC);
+    if (EC) {
+      // FIXME: Add error propagation to the interface.
+      return nullptr;
+    }
+    MemGroup.Blocks.push_back(MB);
+    MemGroup.Cur = MemGroup.PendingStart = (uintptr_t)MB.base();
+    MemGroup.End = MemGroup.Cur + MB.size();
+    Addr = alignTo(MemGroup.Cur, Alignment);
+  }
+
+  MemGroup.Cur = Addr + Size;
+  return (uint8_t *)Addr;
+}
+
+void PooledSectionMemoryManager::closePendingRange(MemoryGroup &MemGroup) {
+  if (MemGroup.Cur > MemGroup.PendingStart)
+    MemGroup.PendingMem.push_back(
+        sys::MemoryBlock((void *)MemGroup.PendingStart,
+                         MemGroup.Cur - MemGroup.PendingStart));
+  MemGroup.PendingStart = MemGroup.Cur;
+}
+
+bool PooledSectionMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  // Flush the caches while the code is still writable, in case the
+  // platform's flush needs to touch it.
+  closePendingRange(CodeMem);
+  invalidateInstructionCache();
+
+  std::error_code EC = applyMemoryGroupPermissions(
+      CodeMem, sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  if (!EC)
+    EC = applyMemoryGroupPermissions(RODataMem, sys::Memory::MF_READ);
+  if (EC) {
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    return true;
+  }
+
+  // Read-write data memory already has the correct permissions.
+  closePendingRange(RWDataMem);
+  RWDataMem.PendingMem.clear();
+
+  return false;
+}
+
+std::error_code
+PooledSectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
+                                                        unsigned Permissions) {
+  static const size_t PageSize = sys::Process::getPageSize();
+
+  closePendingRange(MemGroup);
+  for (sys::MemoryBlock &MB : MemGroup.PendingMem)
+    if (std::error_code EC = sys::Memory::protectMappedMemory(MB, Permissions))
+      return EC;
+  MemGroup.PendingMem.clear();
+
+  // The rest of the current page is no longer writable, so start the next
+  // batch of sections on a fresh page.
+  MemGroup.Cur = std::min<uintptr_t>(alignTo(MemGroup.Cur, PageSize),
+                                     MemGroup.End);
+  MemGroup.PendingStart = MemGroup.Cur;
+
+  return std::error_code();
+}
+
+void PooledSectionMemoryManager::invalidateInstructionCache() {
+  for (sys::MemoryBlock &Block : CodeMem.PendingMem)
+    sys::Memory::InvalidateInstructionCache(Block.base(), Block.size());
+}
@@ -152,6 +152,23 @@ void RuntimeDyldImpl::resolveRelocations() {
 void RuntimeDyldImpl::mapSectionAddress(const void *LocalAddress,
                                         uint64_t TargetAddress) {
   MutexGuard locked(lock);
+
+  // Clients usually map every section of every object they load, so index
+  // the sections by address rather than searching them all on each call.
+  for (unsigned e = Sections.size(); NumIndexedSections != e;
+       ++NumIndexedSections)
+    if (const void *Addr = Sections[NumIndexedSections].getAddress())
+      SectionIDsByAddress.insert(std::make_pair(Addr, NumIndexedSections));
+
+  auto I = SectionIDsByAddress.find(LocalAddress);
+  if (I != SectionIDsByAddress.end() &&
+      Sections[I->second].getAddress() == LocalAddress) {
+    reassignSectionAddress(I->second, TargetAddress);
+    return;
+  }
+
+  // Sections that were reserved before they were allocated (e.g. the ELF GOT)
+  // may have been indexed without an address, so fall back to a search.
   for (unsigned i = 0, e = Sections.size(); i != e; ++i) {
     if (Sections[i].getAddress() == LocalAddress) {
       reassignSectionAddress(i, TargetAddress);
@@ -919,16 +936,26 @@ void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
 
 void RuntimeDyldImpl::resolveExternalSymbols() {
   while (!ExternalSymbolRelocations.empty()) {
-    StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin();
-
-    StringRef Name = i->first();
-    if (Name.size() == 0) {
-      // This is an absolute symbol, use an address of zero.
-      DEBUG(dbgs() << "Resolving absolute relocations."
-                   << "\n");
-      RelocationList &Relocs = i->second;
-      resolveRelocationList(Relocs, 0);
-    } else {
+    // Looking up a symbol may cause additional modules to be loaded, which
+    // may add new entries to the ExternalSymbolRelocations map (including new
+    // relocations against symbols we have already resolved). Process the
+    // current entries as a batch and pick up any additions in the next round.
+    // This also avoids repeatedly erasing from, and rescanning for the first
+    // entry of, a map with many tombstones.
+    StringMap<RelocationList> Pending(std::move(ExternalSymbolRelocations));
+    ExternalSymbolRelocations.clear();
+
+    for (auto &Entry : Pending) {
+      StringRef Name = Entry.first();
+      RelocationList &Relocs = Entry.second;
+      if (Name.size() == 0) {
+        // This is an absolute symbol, use an address of zero.
+        DEBUG(dbgs() << "Resolving absolute relocations."
+                     << "\n");
+        resolveRelocationList(Relocs, 0);
+        continue;
+      }
+
       uint64_t Addr = 0;
       RTDyldSymbolTable::const_iterator Loc = GlobalSymbolTable.find(Name);
       if (Loc == GlobalSymbolTable.end()) {
@@ -939,13 +966,6 @@ void RuntimeDyldImpl::resolveExternalSymbols() {
         // If that fails, try searching for an external symbol.
         if (!Addr)
           Addr = Resolver.findSymbol(Name.data()).getAddress();
-        // The call to getSymbolAddress may have caused additional modules to
-        // be loaded, which may have added new entries to the
-        // ExternalSymbolRelocations map.  Consquently, we need to update our
-        // iterator.  This is also why retrieval of the relocation list
-        // associated with this symbol is deferred until below this point.
-        // New entries may have been added to the relocation list.
-        i = ExternalSymbolRelocations.find(Name);
       } else {
         // We found the symbol in our global table.  It was probably in a
         // Module that we loaded previously.
@@ -964,14 +984,9 @@ void RuntimeDyldImpl::resolveExternalSymbols() {
       if (Addr != UINT64_MAX) {
         DEBUG(dbgs() << "Resolving relocations Name: " << Name << "\t"
                      << format("0x%lx", Addr) << "\n");
-        // This list may have been updated when we called getSymbolAddress, so
-        // don't change this code to get the list earlier.
-        RelocationList &Relocs = i->second;
         resolveRelocationList(Relocs, Addr);
       }
     }
-
-    ExternalSymbolRelocations.erase(i);
   }
 }
 
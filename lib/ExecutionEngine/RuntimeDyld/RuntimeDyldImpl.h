@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_RUNTIMEDYLD_RUNTIMEDYLDIMPL_H
 #define LLVM_LIB_EXECUTIONENGINE_RUNTIMEDYLD_RUNTIMEDYLDIMPL_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
@@ -240,6 +241,12 @@ protected:
   typedef SmallVector<SectionEntry, 64> SectionList;
   SectionList Sections;
 
+  // Section IDs keyed on the local address of the section, for
+  // mapSectionAddress. Sections are added to the index lazily; the first
+  // NumIndexedSections sections have been visited.
+  DenseMap<const void *, unsigned> SectionIDsByAddress;
+  unsigned NumIndexedSections;
+
   typedef unsigned SID; // Type for SectionIDs
 #define RTDYLD_INVALID_SECTION_ID ((RuntimeDyldImpl::SID)(-1))
 
@@ -425,7 +432,7 @@ public:
   RuntimeDyldImpl(RuntimeDyld::MemoryManager &MemMgr,
                   JITSymbolResolver &Resolver)
     : MemMgr(MemMgr), Resolver(Resolver), Checker(nullptr),
-      ProcessAllSections(false), HasError(false) {
+      NumIndexedSections(0), ProcessAllSections(false), HasError(false) {
   }
 
   virtual ~RuntimeDyldImpl();
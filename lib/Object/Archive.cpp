@@ -952,20 +952,33 @@ uint32_t Archive::getNumberOfSymbols() const {
   return read32le(buf);
 }
 
-Expected<Optional<Archive::Child>> Archive::findSym(StringRef name) const {
-  Archive::symbol_iterator bs = symbol_begin();
-  Archive::symbol_iterator es = symbol_end();
-
-  for (; bs != es; ++bs) {
-    StringRef SymName = bs->getName();
-    if (SymName == name) {
-      if (auto MemberOrErr = bs->getMember())
-        return Child(*MemberOrErr);
-      else
-        return MemberOrErr.takeError();
+void Archive::buildSymbolMap() const {
+  SymbolMap.reserve(getNumberOfSymbols());
+  for (symbol_iterator I = symbol_begin(), E = symbol_end(); I != E; ++I)
+    // Keep the first definition, which is the one a linear search finds.
+    SymbolMap.insert(std::make_pair(
+        I->getName(), std::make_pair(I->SymbolIndex, I->StringIndex)));
+}
+
+Expected<Optional<Archive::Child>> Archive::findSym(StringRef Name) const {
+  if (!hasSymbolTable())
+    return Optional<Child>();
+  {
+    std::lock_guard<std::mutex> Lock(SymbolMapMutex);
+    if (!SymbolMapBuilt) {
+      buildSymbolMap();
+      SymbolMapBuilt = true;
     }
   }
-  return Optional<Child>();
+
+  auto It = SymbolMap.find(Name);
+  if (It == SymbolMap.end())
+    return Optional<Child>();
+  Symbol Sym(this, It->second.first, It->second.second);
+  if (auto MemberOrErr = Sym.getMember())
+    return Child(*MemberOrErr);
+  else
+    return MemberOrErr.takeError();
 }
 
 // Returns true if archive file contains no member file.
@@ -16,15 +16,19 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Object/Archive.h"
+#include "llvm/Object/IRObjectFile.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Object/SymbolicFile.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -247,27 +251,113 @@ static sys::TimeValue now(bool Deterministic) {
   return TV;
 }
 
+namespace {
+// The symbols that one member contributes to the archive symbol table.
+struct MemberSymbols {
+  bool IsSymbolic = false;
+  // The symbol names, each followed by a '\0'.
+  std::string Names;
+  std::error_code EC;
+};
+}
+
+static Expected<std::unique_ptr<object::SymbolicFile>>
+getSymbolicFile(MemoryBufferRef MemberBuffer, LLVMContext &Context) {
+  // Read the symbols of bitcode members from their symbol table if they have
+  // one, rather than loading their modules.
+  if (sys::fs::identify_magic(MemberBuffer.getBuffer()) ==
+      sys::fs::file_magic::bitcode) {
+    Expected<std::unique_ptr<object::IRObjectFile>> ObjOrErr =
+        object::IRObjectFile::createFromSymtab(MemberBuffer);
+    if (ObjOrErr)
+      return std::move(*ObjOrErr);
+    consumeError(ObjOrErr.takeError());
+  }
+  return object::SymbolicFile::createSymbolicFile(
+      MemberBuffer, sys::fs::file_magic::unknown, &Context);
+}
+
+static void getMemberSymbols(MemoryBufferRef MemberBuffer,
+                             LLVMContext &Context, MemberSymbols &Result) {
+  Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
+      getSymbolicFile(MemberBuffer, Context);
+  if (!ObjOrErr) {
+    // FIXME: check only for "not an object file" errors.
+    consumeError(ObjOrErr.takeError());
+    return;
+  }
+  Result.IsSymbolic = true;
+
+  raw_string_ostream NameOS(Result.Names);
+  for (const object::BasicSymbolRef &S : ObjOrErr.get()->symbols()) {
+    uint32_t Symflags = S.getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
+      continue;
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+
+    if ((Result.EC = S.printName(NameOS)))
+      return;
+    NameOS << '\0';
+  }
+}
+
+static cl::opt<unsigned> ParallelSymtabThreshold(
+    "archive-parallel-symtab-threshold", cl::Hidden, cl::init(1 << 20),
+    cl::desc("Minimum total member size, in bytes, for reading archive "
+             "member symbols on several threads"));
+
+// Opening a member as a SymbolicFile can be expensive (bitcode members without
+// a symbol table are parsed), and members are independent, so they may be
+// spread over a thread pool, with an LLVMContext per worker. Small archives
+// aren't worth starting the threads for.
+static std::vector<MemberSymbols>
+getSymbols(ArrayRef<NewArchiveMember> Members, unsigned NumThreads) {
+  size_t TotalSize = 0;
+  for (const NewArchiveMember &M : Members)
+    TotalSize += M.Buf->getBufferSize();
+  if (TotalSize < ParallelSymtabThreshold)
+    NumThreads = 1;
+  NumThreads = std::min<size_t>(NumThreads, Members.size());
+
+  std::vector<MemberSymbols> Result(Members.size());
+  if (NumThreads <= 1) {
+    LLVMContext Context;
+    for (unsigned I = 0, N = Members.size(); I != N; ++I)
+      getMemberSymbols(Members[I].Buf->getMemBufferRef(), Context, Result[I]);
+    return Result;
+  }
+
+  std::atomic<unsigned> NextMember(0);
+  ThreadPool Pool(NumThreads);
+  for (unsigned T = 0; T != NumThreads; ++T)
+    Pool.async([&]() {
+      LLVMContext Context;
+      for (unsigned I = NextMember++; I < Members.size(); I = NextMember++)
+        getMemberSymbols(Members[I].Buf->getMemBufferRef(), Context,
+                         Result[I]);
+    });
+  Pool.wait();
+  return Result;
+}
+
 // Returns the offset of the first reference to a member offset.
 static ErrorOr<unsigned>
 writeSymbolTable(raw_fd_ostream &Out, object::Archive::Kind Kind,
                  ArrayRef<NewArchiveMember> Members,
-                 std::vector<unsigned> &MemberOffsetRefs, bool Deterministic) {
+                 std::vector<unsigned> &MemberOffsetRefs, bool Deterministic,
+                 unsigned NumThreads) {
   unsigned HeaderStartOffset = 0;
   unsigned BodyStartOffset = 0;
   SmallString<128> NameBuf;
   raw_svector_ostream NameOS(NameBuf);
-  LLVMContext Context;
+  std::vector<MemberSymbols> Symbols = getSymbols(Members, NumThreads);
   for (unsigned MemberNum = 0, N = Members.size(); MemberNum < N; ++MemberNum) {
-    MemoryBufferRef MemberBuffer = Members[MemberNum].Buf->getMemBufferRef();
-    Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr) {
-      // FIXME: check only for "not an object file" errors.
-      consumeError(ObjOrErr.takeError());
+    const MemberSymbols &Syms = Symbols[MemberNum];
+    if (!Syms.IsSymbolic)
       continue;
-    }
-    object::SymbolicFile &Obj = *ObjOrErr.get();
 
     if (!HeaderStartOffset) {
       HeaderStartOffset = Out.tell();
@@ -279,26 +369,21 @@ writeSymbolTable(raw_fd_ostream &Out, object::Archive::Kind Kind,
       print32(Out, Kind, 0); // number of entries or bytes
     }
 
-    for (const object::BasicSymbolRef &S : Obj.symbols()) {
-      uint32_t Symflags = S.getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-
-      unsigned NameOffset = NameOS.tell();
-      if (auto EC = S.printName(NameOS))
-        return EC;
-      NameOS << '\0';
+    if (Syms.EC)
+      return Syms.EC;
+
+    unsigned NameOffset = NameOS.tell();
+    for (StringRef Names = Syms.Names; !Names.empty();) {
       MemberOffsetRefs.push_back(MemberNum);
       if (Kind == object::Archive::K_BSD)
         print32(Out, Kind, NameOffset);
       print32(Out, Kind, 0); // member offset
+      size_t Size = Names.find('\0') + 1;
+      NameOffset += Size;
+      Names = Names.drop_front(Size);
     }
+    NameOS << Syms.Names;
   }
-
   if (HeaderStartOffset == 0)
     return 0;
 
@@ -336,7 +421,8 @@ llvm::writeArchive(StringRef ArcName,
                    std::vector<NewArchiveMember> &NewMembers,
                    bool WriteSymtab, object::Archive::Kind Kind,
                    bool Deterministic, bool Thin,
-                   std::unique_ptr<MemoryBuffer> OldArchiveBuf) {
+                   std::unique_ptr<MemoryBuffer> OldArchiveBuf,
+                   unsigned NumThreads) {
   assert((!Thin || Kind == object::Archive::K_GNU) &&
          "Only the gnu format has a thin mode");
   SmallString<128> TmpArchive;
@@ -361,7 +447,7 @@ llvm::writeArchive(StringRef ArcName,
   unsigned MemberReferenceOffset = 0;
   if (WriteSymtab) {
     ErrorOr<unsigned> MemberReferenceOffsetOrErr = writeSymbolTable(
-        Out, Kind, NewMembers, MemberOffsetRefs, Deterministic);
+        Out, Kind, NewMembers, MemberOffsetRefs, Deterministic, NumThreads);
     if (auto EC = MemberReferenceOffsetOrErr.getError())
       return std::make_pair(ArcName, EC);
     MemberReferenceOffset = MemberReferenceOffsetOrErr.get();
@@ -44,6 +44,9 @@ IRObjectFile::IRObjectFile(MemoryBufferRef Object, std::unique_ptr<Module> Mod)
                           });
 }
 
+IRObjectFile::IRObjectFile(MemoryBufferRef Object, irsymtab::Reader Symtab)
+    : SymbolicFile(Binary::ID_IR, Object), Symtab(Symtab) {}
+
 // Parse inline ASM and collect the list of symbols that are not defined in
 // the current module. This is inspired from IRObjectFile.
 void IRObjectFile::CollectAsmUndefinedRefs(
@@ -163,7 +166,22 @@ static unsigned getAsmSymIndex(DataRefImpl Symb) {
   return Index;
 }
 
+irsymtab::Reader::Symbol
+IRObjectFile::getSymtabSymbol(DataRefImpl Symb) const {
+  assert(!M && Symb.p < Symtab.getNumSymbols());
+  return Symtab.getSymbol(Symb.p);
+}
+
+StringRef IRObjectFile::getTargetTriple() const {
+  return M ? StringRef(M->getTargetTriple()) : Symtab.getTargetTriple();
+}
+
 void IRObjectFile::moveSymbolNext(DataRefImpl &Symb) const {
+  if (!M) {
+    ++Symb.p;
+    return;
+  }
+
   const GlobalValue *GV = getGV(Symb);
   uintptr_t Res;
 
@@ -200,8 +218,20 @@ void IRObjectFile::moveSymbolNext(DataRefImpl &Symb) const {
   Symb.p = Res;
 }
 
+void IRObjectFile::printGlobalValueName(raw_ostream &OS, const GlobalValue &GV,
+                                        Mangler &Mang) {
+  if (GV.hasDLLImportStorageClass())
+    OS << "__imp_";
+  Mang.getNameWithPrefix(OS, &GV, false);
+}
+
 std::error_code IRObjectFile::printSymbolName(raw_ostream &OS,
                                               DataRefImpl Symb) const {
+  if (!M) {
+    OS << getSymtabSymbol(Symb).getName();
+    return std::error_code();
+  }
+
   const GlobalValue *GV = getGV(Symb);
   if (!GV) {
     unsigned Index = getAsmSymIndex(Symb);
@@ -210,48 +240,33 @@ std::error_code IRObjectFile::printSymbolName(raw_ostream &OS,
     return std::error_code();
   }
 
-  if (GV->hasDLLImportStorageClass())
-    OS << "__imp_";
-
-  if (Mang)
-    Mang->getNameWithPrefix(OS, GV, false);
-  else
-    OS << GV->getName();
-
+  printGlobalValueName(OS, *GV, *Mang);
   return std::error_code();
 }
 
-uint32_t IRObjectFile::getSymbolFlags(DataRefImpl Symb) const {
-  const GlobalValue *GV = getGV(Symb);
-
-  if (!GV) {
-    unsigned Index = getAsmSymIndex(Symb);
-    assert(Index <= AsmSymbols.size());
-    return AsmSymbols[Index].second;
-  }
-
+uint32_t IRObjectFile::getGlobalValueFlags(const GlobalValue &GV) {
   uint32_t Res = BasicSymbolRef::SF_None;
-  if (GV->isDeclarationForLinker())
+  if (GV.isDeclarationForLinker())
     Res |= BasicSymbolRef::SF_Undefined;
-  else if (GV->hasHiddenVisibility() && !GV->hasLocalLinkage())
+  else if (GV.hasHiddenVisibility() && !GV.hasLocalLinkage())
     Res |= BasicSymbolRef::SF_Hidden;
-  if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV)) {
+  if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(&GV)) {
     if (GVar->isConstant())
       Res |= BasicSymbolRef::SF_Const;
   }
-  if (GV->hasPrivateLinkage())
+  if (GV.hasPrivateLinkage())
     Res |= BasicSymbolRef::SF_FormatSpecific;
-  if (!GV->hasLocalLinkage())
+  if (!GV.hasLocalLinkage())
     Res |= BasicSymbolRef::SF_Global;
-  if (GV->hasCommonLinkage())
+  if (GV.hasCommonLinkage())
     Res |= BasicSymbolRef::SF_Common;
-  if (GV->hasLinkOnceLinkage() || GV->hasWeakLinkage() ||
-      GV->hasExternalWeakLinkage())
+  if (GV.hasLinkOnceLinkage() || GV.hasWeakLinkage() ||
+      GV.hasExternalWeakLinkage())
     Res |= BasicSymbolRef::SF_Weak;
 
-  if (GV->getName().startswith("llvm."))
+  if (GV.getName().startswith("llvm."))
     Res |= BasicSymbolRef::SF_FormatSpecific;
-  else if (auto *Var = dyn_cast<GlobalVariable>(GV)) {
+  else if (auto *Var = dyn_cast<GlobalVariable>(&GV)) {
     if (Var->getSection() == "llvm.metadata")
       Res |= BasicSymbolRef::SF_FormatSpecific;
   }
@@ -259,19 +274,46 @@ uint32_t IRObjectFile::getSymbolFlags(DataRefImpl Symb) const {
   return Res;
 }
 
-GlobalValue *IRObjectFile::getSymbolGV(DataRefImpl Symb) { return getGV(Symb); }
+uint32_t IRObjectFile::getSymbolFlags(DataRefImpl Symb) const {
+  if (!M)
+    return getSymtabSymbol(Symb).getSymbolFlags();
+
+  const GlobalValue *GV = getGV(Symb);
+
+  if (!GV) {
+    unsigned Index = getAsmSymIndex(Symb);
+    assert(Index <= AsmSymbols.size());
+    return AsmSymbols[Index].second;
+  }
+
+  return getGlobalValueFlags(*GV);
+}
+
+GlobalValue *IRObjectFile::getSymbolGV(DataRefImpl Symb) {
+  return M ? getGV(Symb) : nullptr;
+}
 
 std::unique_ptr<Module> IRObjectFile::takeModule() { return std::move(M); }
 
 basic_symbol_iterator IRObjectFile::symbol_begin_impl() const {
-  Module::const_iterator I = M->begin();
   DataRefImpl Ret;
+  if (!M) {
+    Ret.p = 0;
+    return basic_symbol_iterator(BasicSymbolRef(Ret, this));
+  }
+
+  Module::const_iterator I = M->begin();
   Ret.p = skipEmpty(I, *M);
   return basic_symbol_iterator(BasicSymbolRef(Ret, this));
 }
 
 basic_symbol_iterator IRObjectFile::symbol_end_impl() const {
   DataRefImpl Ret;
+  if (!M) {
+    Ret.p = Symtab.getNumSymbols();
+    return basic_symbol_iterator(BasicSymbolRef(Ret, this));
+  }
+
   uint64_t NumAsm = AsmSymbols.size();
   NumAsm <<= 2;
   Ret.p = 3 | NumAsm;
@@ -329,3 +371,22 @@ llvm::object::IRObjectFile::create(MemoryBufferRef Object,
   std::unique_ptr<Module> &M = MOrErr.get();
   return llvm::make_unique<IRObjectFile>(BCOrErr.get(), std::move(M));
 }
+
+Expected<std::unique_ptr<IRObjectFile>>
+llvm::object::IRObjectFile::createFromSymtab(MemoryBufferRef Object) {
+  ErrorOr<MemoryBufferRef> BCOrErr = findBitcodeInMemBuffer(Object);
+  if (!BCOrErr)
+    return errorCodeToError(BCOrErr.getError());
+
+  Expected<StringRef> SymtabOrErr = irsymtab::findSymtab(*BCOrErr);
+  if (!SymtabOrErr)
+    return SymtabOrErr.takeError();
+  if (SymtabOrErr->empty())
+    return errorCodeToError(object_error::invalid_file_type);
+
+  Expected<irsymtab::Reader> ReaderOrErr =
+      irsymtab::Reader::create(*SymtabOrErr);
+  if (!ReaderOrErr)
+    return ReaderOrErr.takeError();
+  return llvm::make_unique<IRObjectFile>(*BCOrErr, *ReaderOrErr);
+}
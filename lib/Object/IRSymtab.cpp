@@ -0,0 +1,251 @@
+//===- IRSymtab.cpp - implementation of IR symbol tables --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/IRSymtab.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Bitcode/LLVMBitCodes.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Object/Error.h"
+#include "llvm/Object/IRObjectFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace irsymtab;
+
+/// The on-disk flag bit for each BasicSymbolRef flag that
+/// IRObjectFile::getGlobalValueFlags can set.
+static const struct {
+  uint32_t SymbolFlag;
+  unsigned Bit;
+} FlagMap[] = {
+    {object::BasicSymbolRef::SF_Undefined, storage::Symbol::FB_undefined},
+    {object::BasicSymbolRef::SF_Global, storage::Symbol::FB_global},
+    {object::BasicSymbolRef::SF_Weak, storage::Symbol::FB_weak},
+    {object::BasicSymbolRef::SF_Common, storage::Symbol::FB_common},
+    {object::BasicSymbolRef::SF_Hidden, storage::Symbol::FB_hidden},
+    {object::BasicSymbolRef::SF_Const, storage::Symbol::FB_const},
+    {object::BasicSymbolRef::SF_FormatSpecific,
+     storage::Symbol::FB_format_specific},
+};
+
+namespace {
+
+/// Builds the symbol table. The fixed-size parts are collected first and
+/// written in front of the string table once their size is known.
+struct Builder {
+  SmallVector<char, 0> StrtabBuf;
+  raw_svector_ostream Strtab{StrtabBuf};
+
+  std::vector<storage::Comdat> Comdats;
+  DenseMap<const Comdat *, unsigned> ComdatMap;
+  std::vector<storage::Symbol> Syms;
+
+  // String offsets are relative to the start of the string table until
+  // finish() rebases them.
+  void setStr(storage::Str &S, StringRef Value) {
+    S.Offset = Strtab.tell();
+    S.Size = Value.size();
+    Strtab << Value;
+  }
+
+  void addSymbol(const GlobalValue &GV, Mangler &Mang);
+  void finish(const Module &M, SmallVectorImpl<char> &Symtab);
+};
+
+void Builder::addSymbol(const GlobalValue &GV, Mangler &Mang) {
+  Syms.emplace_back();
+  storage::Symbol &Sym = Syms.back();
+
+  Sym.Name.Offset = Strtab.tell();
+  object::IRObjectFile::printGlobalValueName(Strtab, GV, Mang);
+  Sym.Name.Size = Strtab.tell() - Sym.Name.Offset;
+
+  uint32_t Flags = (GV.getVisibility() << storage::Symbol::FB_visibility) |
+                   (GV.getValueType()->isFunctionTy()
+                    << storage::Symbol::FB_function) |
+                   (isa<GlobalAlias>(GV) << storage::Symbol::FB_alias);
+  uint32_t SymbolFlags = object::IRObjectFile::getGlobalValueFlags(GV);
+  for (const auto &F : FlagMap) {
+    if (SymbolFlags & F.SymbolFlag)
+      Flags |= 1 << F.Bit;
+    SymbolFlags &= ~F.SymbolFlag;
+  }
+  assert(!SymbolFlags && "symbol flag has no on-disk representation");
+  Sym.Flags = Flags;
+
+  Sym.ComdatIndex = -1;
+  const GlobalObject *Base = dyn_cast<GlobalObject>(&GV);
+  if (!Base)
+    Base = cast<GlobalAlias>(GV).getBaseObject();
+  if (const Comdat *C = Base ? Base->getComdat() : nullptr) {
+    auto P = ComdatMap.insert(std::make_pair(C, Comdats.size()));
+    if (P.second) {
+      Comdats.emplace_back();
+      setStr(Comdats.back().Name, C->getName());
+    }
+    Sym.ComdatIndex = P.first->second;
+  }
+
+  Sym.CommonSize = 0;
+  Sym.CommonAlign = 0;
+  if (GV.hasCommonLinkage()) {
+    const DataLayout &DL = GV.getParent()->getDataLayout();
+    Sym.CommonSize = DL.getTypeAllocSize(GV.getValueType());
+    Sym.CommonAlign = cast<GlobalVariable>(GV).getAlignment();
+  }
+}
+
+void Builder::finish(const Module &M, SmallVectorImpl<char> &Symtab) {
+  storage::Header Hdr;
+  Hdr.Version = storage::Header::kCurrentVersion;
+  setStr(Hdr.TargetTriple, M.getTargetTriple());
+  setStr(Hdr.SourceFileName, M.getSourceFileName());
+
+  uint32_t Pos = sizeof(storage::Header);
+  Hdr.Comdats.Offset = Pos;
+  Hdr.Comdats.Size = Comdats.size();
+  Pos += Comdats.size() * sizeof(storage::Comdat);
+  Hdr.Symbols.Offset = Pos;
+  Hdr.Symbols.Size = Syms.size();
+  Pos += Syms.size() * sizeof(storage::Symbol);
+
+  // Rebase the string references now that the string table's position is
+  // known.
+  auto Rebase = [&](storage::Str &S) { S.Offset = S.Offset + Pos; };
+  Rebase(Hdr.TargetTriple);
+  Rebase(Hdr.SourceFileName);
+  for (storage::Comdat &C : Comdats)
+    Rebase(C.Name);
+  for (storage::Symbol &Sym : Syms)
+    Rebase(Sym.Name);
+
+  auto Append = [&](const void *Data, size_t Size) {
+    Symtab.append(static_cast<const char *>(Data),
+                  static_cast<const char *>(Data) + Size);
+  };
+  Symtab.clear();
+  Append(&Hdr, sizeof(Hdr));
+  Append(Comdats.data(), Comdats.size() * sizeof(storage::Comdat));
+  Append(Syms.data(), Syms.size() * sizeof(storage::Symbol));
+  Append(StrtabBuf.data(), StrtabBuf.size());
+}
+
+} // end anonymous namespace
+
+bool irsymtab::build(const Module &M, SmallVectorImpl<char> &Symtab) {
+  // Symbols defined or referenced by inline asm can only be found with the
+  // target's asm parser.
+  if (!M.getModuleInlineAsm().empty())
+    return false;
+
+  // Add the symbols in the order IRObjectFile enumerates them.
+  Builder B;
+  Mangler Mang;
+  for (const Function &F : M)
+    B.addSymbol(F, Mang);
+  for (const GlobalVariable &GV : M.globals())
+    B.addSymbol(GV, Mang);
+  for (const GlobalAlias &GA : M.aliases())
+    B.addSymbol(GA, Mang);
+  B.finish(M, Symtab);
+  return true;
+}
+
+Expected<StringRef> irsymtab::findSymtab(MemoryBufferRef Buffer) {
+  const unsigned char *BufPtr =
+      reinterpret_cast<const unsigned char *>(Buffer.getBufferStart());
+  const unsigned char *BufEnd = BufPtr + Buffer.getBufferSize();
+  if (isBitcodeWrapper(BufPtr, BufEnd) &&
+      SkipBitcodeWrapperHeader(BufPtr, BufEnd, true))
+    return errorCodeToError(object::object_error::parse_failed);
+
+  BitstreamReader Reader(BufPtr, BufEnd);
+  BitstreamCursor Stream(Reader);
+  if (!Stream.canSkipToPos(4) || !hasValidBitcodeHeader(Stream))
+    return errorCodeToError(object::object_error::invalid_file_type);
+
+  // The symbol table block precedes the module block, so there is no need to
+  // look past the module.
+  SmallVector<uint64_t, 1> Record;
+  while (!Stream.AtEndOfStream()) {
+    BitstreamEntry Entry = Stream.advance();
+    if (Entry.Kind != BitstreamEntry::SubBlock ||
+        Entry.ID == bitc::MODULE_BLOCK_ID)
+      break;
+
+    if (Entry.ID != bitc::SYMTAB_BLOCK_ID) {
+      if (Stream.SkipBlock())
+        break;
+      continue;
+    }
+
+    if (Stream.EnterSubBlock(bitc::SYMTAB_BLOCK_ID))
+      break;
+    while (true) {
+      Entry = Stream.advanceSkippingSubblocks();
+      if (Entry.Kind != BitstreamEntry::Record)
+        return StringRef();
+      StringRef Blob;
+      Record.clear();
+      if (Stream.readRecord(Entry.ID, Record, &Blob) == bitc::SYMTAB_BLOB)
+        return Blob;
+    }
+  }
+  return StringRef();
+}
+
+uint32_t Reader::Symbol::getSymbolFlags() const {
+  uint32_t Res = object::BasicSymbolRef::SF_None;
+  for (const auto &F : FlagMap)
+    if ((S->Flags >> F.Bit) & 1)
+      Res |= F.SymbolFlag;
+  return Res;
+}
+
+Expected<Reader> Reader::create(StringRef Symtab) {
+  auto Malformed = [] {
+    return errorCodeToError(object::object_error::parse_failed);
+  };
+  if (Symtab.size() < sizeof(storage::Header))
+    return Malformed();
+
+  Reader R;
+  R.Symtab = Symtab;
+  R.Header = reinterpret_cast<const storage::Header *>(Symtab.data());
+  if (R.Header->Version != storage::Header::kCurrentVersion)
+    return errorCodeToError(object::object_error::invalid_file_type);
+
+  auto CheckRange = [&](uint64_t Offset, uint64_t Size) {
+    return Offset <= Symtab.size() && Size <= Symtab.size() - Offset;
+  };
+  auto CheckStr = [&](const storage::Str &S) {
+    return CheckRange(S.Offset, S.Size);
+  };
+  const storage::Header &H = *R.Header;
+  if (!CheckStr(H.TargetTriple) || !CheckStr(H.SourceFileName) ||
+      !CheckRange(H.Comdats.Offset,
+                  uint64_t(H.Comdats.Size) * sizeof(storage::Comdat)) ||
+      !CheckRange(H.Symbols.Offset,
+                  uint64_t(H.Symbols.Size) * sizeof(storage::Symbol)))
+    return Malformed();
+
+  R.Comdats = H.Comdats.get(Symtab);
+  R.Symbols = H.Symbols.get(Symtab);
+  for (const storage::Comdat &C : R.Comdats)
+    if (!CheckStr(C.Name))
+      return Malformed();
+  for (const storage::Symbol &S : R.Symbols)
+    if (!CheckStr(S.Name) ||
+        (S.ComdatIndex != uint32_t(-1) && S.ComdatIndex >= R.Comdats.size()))
+      return Malformed();
+  return R;
+}
@@ -1,6 +1,12 @@
 ; RUN: llc -split-dwarf=Enable -O0 %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj -o %t
 ; RUN: llvm-dwarfdump %t | FileCheck %s
 ; RUN: llvm-objdump -h %t | FileCheck --check-prefix=HDR %s
+; RUN: llc -split-dwarf=Enable -split-dwarf-incremental-loc -O0 %s -mtriple=x86_64-unknown-linux-gnu -filetype=obj -o %t.incr
+; RUN: llvm-dwarfdump %t.incr | FileCheck %s
+; RUN: llvm-dwarfdump %t | grep "dwo_id \[" > %t.dwo_id
+; RUN: llvm-dwarfdump %t.incr | grep "dwo_id \[" > %t.incr.dwo_id
+; RUN: diff %t.dwo_id %t.incr.dwo_id
+; RUN: llc -split-dwarf=Enable -split-dwarf-incremental-loc -O0 %s -mtriple=x86_64-unknown-linux-gnu -o - | FileCheck --check-prefix=INCR %s
 
 ; CHECK: .debug_info contents:
 ; CHECK: DW_TAG_compile_unit
@@ -44,6 +50,15 @@
 ; Make sure we don't produce any relocations in any .dwo section (though in particular, debug_info.dwo)
 ; HDR-NOT: .rela.{{.*}}.dwo
 
+; With -split-dwarf-incremental-loc, foo's location lists are emitted as soon
+; as foo is finished, ahead of the rest of the debug info. The dwo_id doesn't
+; change.
+; INCR: .Lfunc_end1:
+; INCR: .section .debug_loc.dwo,"",@progbits
+; INCR-NOT: .section
+; INCR: .Ldebug_loc3:
+; INCR: .section .debug_str,"MS",@progbits,1
+
 ; Make sure we have enough stuff in the debug_addr to cover the address indexes
 ; (6 is the last index in debug_loc.dwo, making 7 entries of 8 bytes each, 7 * 8
 ; == 56 base 10 == 38 base 16)
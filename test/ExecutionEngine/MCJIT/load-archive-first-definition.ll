@@ -0,0 +1,19 @@
+; Check that symbols are looked up in an -extra-archive the way a static
+; linker would: a name defined by two members resolves to the first one, and a
+; name the archive doesn't define (abs) falls through to the host process.
+
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: llc -filetype=obj -o %t/archive-dup-a.o %p/Inputs/archive-dup-a.ll
+; RUN: llc -filetype=obj -o %t/archive-dup-b.o %p/Inputs/archive-dup-b.ll
+; RUN: llvm-ar rc %t/dup.a %t/archive-dup-a.o %t/archive-dup-b.o
+; RUN: %lli -extra-archive=%t/dup.a %s
+
+declare i32 @dup()
+declare i32 @abs(i32)
+
+define i32 @main() {
+  %d = call i32 @dup()
+  %a = call i32 @abs(i32 0)
+  %r = add i32 %d, %a
+  ret i32 %r
+}
@@ -0,0 +1,24 @@
+; REQUIRES: x86_64-linux
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: %lli -perf-jit-dir=%t %s
+; RUN: cat %t/perf-*.map | FileCheck %s
+; RUN: rm -rf %t && mkdir -p %t
+; RUN: %lli -jit-kind=orc-lazy -perf-jit-dir=%t %s
+; RUN: cat %t/perf-*.map | FileCheck %s
+;
+; Check that JIT'd functions are described to perf, with their start address
+; and size in hex.
+;
+; CHECK-DAG: {{^[0-9a-f]+ [0-9a-f]+ foo$}}
+; CHECK-DAG: {{^[0-9a-f]+ [0-9a-f]+ main$}}
+
+define i32 @foo() {
+entry:
+  ret i32 0
+}
+
+define i32 @main() {
+entry:
+  %0 = call i32 @foo()
+  ret i32 %0
+}
@@ -0,0 +1,18 @@
+; RUN: %lli -remote-mcjit -remote-shm -mcjit-remote-process=lli-child-target%exeext %s > /dev/null
+; XFAIL: mingw32,win32
+; UNSUPPORTED: powerpc64-unknown-linux-gnu
+; Remove UNSUPPORTED for powerpc64-unknown-linux-gnu if problem caused by r266663 is fixed
+
+@count = global i32 1, align 4
+
+define i32 @bar(i32 %n) nounwind {
+	%c = load i32, i32* @count, align 4
+	%r = add i32 %c, %n
+	store i32 %r, i32* @count, align 4
+	ret i32 %r
+}
+
+define i32 @main() nounwind {
+	%r = call i32 @bar(i32 -1)		; <i32> [#uses=1]
+	ret i32 %r
+}
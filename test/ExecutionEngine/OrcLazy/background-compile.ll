@@ -0,0 +1,26 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-compile-threads=2 %s
+;
+; Check that functions compiled eagerly on background threads are reachable
+; through their stubs, whether or not the background compile has finished by
+; the time they are first called.
+
+define i32 @inc(i32 %x) {
+entry:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @twice_inc(i32 %x) {
+entry:
+  %a = call i32 @inc(i32 %x)
+  %b = call i32 @inc(i32 %a)
+  ret i32 %b
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %v = call i32 @twice_inc(i32 40)
+  %ok = icmp eq i32 %v, 42
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
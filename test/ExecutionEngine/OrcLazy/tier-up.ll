@@ -0,0 +1,71 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-tier-up-threshold=10 \
+; RUN:     -orc-lazy-tier-up-background=false \
+; RUN:     -orc-lazy-debug=funcs-to-stdout %s | FileCheck %s
+;
+; Check that functions keep computing the right result while they are
+; promoted from the counting tier-0 code to recompiled tier-1 code. The hot
+; loop in @sum is recompiled and its stub switched when main asks for it, so
+; the second half of main runs tier-1 code.
+;
+; CHECK: [ sum ]
+; CHECK: tier-1 [ sum ]
+; CHECK: tier-up: switched {{[1-9][0-9]*}} stubs to tier-1 code
+
+declare i32 @__orc_lazy_tier_up()
+
+define i64 @sum(i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = add i64 %acc, %i
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i64 %acc.next
+}
+
+; Call @sum Count times, returning false if it ever gets a wrong result.
+define i1 @run(i32 %count) {
+entry:
+  br label %loop
+
+loop:
+  %iter = phi i32 [ 0, %entry ], [ %iter.next, %check ]
+  %s = call i64 @sum(i64 1000)
+  %ok = icmp eq i64 %s, 499500
+  br i1 %ok, label %check, label %exit
+
+check:
+  %iter.next = add i32 %iter, 1
+  %done = icmp eq i32 %iter.next, %count
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i1 %ok
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %tier0.ok = call i1 @run(i32 100)
+  br i1 %tier0.ok, label %tier.up, label %fail
+
+tier.up:
+  %switched = call i32 @__orc_lazy_tier_up()
+  %did.switch = icmp ne i32 %switched, 0
+  br i1 %did.switch, label %tier1, label %fail
+
+tier1:
+  %tier1.ok = call i1 @run(i32 100)
+  br i1 %tier1.ok, label %exit, label %fail
+
+exit:
+  ret i32 0
+
+fail:
+  ret i32 1
+}
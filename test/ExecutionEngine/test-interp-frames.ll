@@ -0,0 +1,62 @@
+; RUN: %lli -force-interpreter=true %s
+;
+; Exercise the interpreter's slot-indexed frames: deep recursion with phis
+; and switches, and an intrinsic that is lowered to new instructions the
+; first time it runs, while outer frames of the same function are suspended
+; in the block being rewritten.
+
+define i32 @fib(i32 %n) {
+entry:
+  switch i32 %n, label %recurse [ i32 0, label %done
+                                  i32 1, label %done ]
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %n2 = sub i32 %n, 2
+  %f1 = call i32 @fib(i32 %n1)
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  br label %done
+
+done:
+  %r = phi i32 [ %n, %entry ], [ %n, %entry ], [ %sum, %recurse ]
+  ret i32 %r
+}
+
+declare i32 @llvm.ctpop.i32(i32)
+
+; Sum of the population counts of 1..n.
+define i32 @popsum(i32 %n) {
+entry:
+  %iszero = icmp eq i32 %n, 0
+  br i1 %iszero, label %exit, label %recurse
+
+recurse:
+  %m = sub i32 %n, 1
+  %rest = call i32 @popsum(i32 %m)
+  %bits = call i32 @llvm.ctpop.i32(i32 %n)
+  %total = add i32 %rest, %bits
+  br label %exit
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %total, %recurse ]
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  %fib = call i32 @fib(i32 20)
+  %fibok = icmp eq i32 %fib, 6765
+  br i1 %fibok, label %checkpop, label %fail
+
+checkpop:
+  %pop = call i32 @popsum(i32 100)
+  %popok = icmp eq i32 %pop, 319
+  br i1 %popok, label %pass, label %fail
+
+pass:
+  ret i32 0
+
+fail:
+  ret i32 1
+}
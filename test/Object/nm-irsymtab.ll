@@ -0,0 +1,59 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-bcanalyzer -dump %t.bc | FileCheck --check-prefix=BCA %s
+; RUN: llvm-nm %t.bc | FileCheck %s
+; RUN: llvm-nm -without-aliases %t.bc | FileCheck --check-prefix=NOALIAS %s
+
+; A module with module-level inline asm gets no symbol table; llvm-nm loads
+; the module instead and must print the same symbols.
+; RUN: sed -e 's/^; ASM: //' %s | llvm-as -o %t.asm.bc
+; RUN: llvm-bcanalyzer -dump %t.asm.bc | FileCheck --check-prefix=NOSYMTAB %s
+; RUN: llvm-nm %t.bc > %t.nm
+; RUN: llvm-nm %t.asm.bc | diff %t.nm -
+; RUN: llvm-nm -without-aliases %t.bc > %t.noalias.nm
+; RUN: llvm-nm -without-aliases %t.asm.bc | diff %t.noalias.nm -
+
+; Only bitcode meant as an object file gets a symbol table.
+; RUN: opt %s -o %t.opt.bc
+; RUN: llvm-bcanalyzer -dump %t.opt.bc | FileCheck --check-prefix=NOSYMTAB %s
+; RUN: llvm-nm %t.opt.bc | diff %t.nm -
+; RUN: llvm-as -emit-symtab=false %s -o %t.nosymtab.bc
+; RUN: llvm-bcanalyzer -dump %t.nosymtab.bc | FileCheck --check-prefix=NOSYMTAB %s
+
+; BCA: <SYMTAB_BLOCK
+; BCA-NEXT: <BLOB
+; BCA-NEXT: </SYMTAB_BLOCK>
+; BCA-NEXT: <MODULE_BLOCK
+
+; NOSYMTAB-NOT: <SYMTAB_BLOCK
+
+; CHECK:      D a1
+; CHECK-NEXT: C common1
+; CHECK-NEXT: U ext
+; CHECK-NEXT: T f1
+; CHECK-NEXT: t f2
+; CHECK-NEXT: U f3
+; CHECK-NEXT: D g1
+; CHECK-NEXT: D hidden1
+
+; NOALIAS-NOT: a1
+; NOALIAS: C common1
+
+target triple = "x86_64-unknown-linux-gnu"
+; ASM: module asm ".text"
+
+$c1 = comdat any
+@g1 = global i32 1, comdat($c1)
+@common1 = common global i32 0, align 8
+@ext = external global i32
+@hidden1 = hidden global i32 2
+@a1 = alias i32, i32* @g1
+
+define void @f1() {
+  ret void
+}
+
+define internal void @f2() {
+  ret void
+}
+
+declare void @f3()
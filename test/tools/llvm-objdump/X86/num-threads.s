@@ -0,0 +1,35 @@
+// RUN: llvm-mc %s -filetype=obj -triple=x86_64-pc-linux -o %t
+// RUN: llvm-objdump -d %t > %t.1
+// RUN: llvm-objdump -d -num-threads=4 %t > %t.4
+// RUN: diff %t.1 %t.4
+// RUN: FileCheck %s < %t.4
+
+// The functions are aligned so that the section is split into several runs
+// of symbols, which must still be printed in address order.
+
+// CHECK:      foo:
+// CHECK-NEXT:   0: e8 {{.*}} callq {{.*}} <bar>
+// CHECK:      bar:
+// CHECK-NEXT: 1000: e8 {{.*}} callq {{.*}} <baz>
+// CHECK:      baz:
+// CHECK-NEXT: 2000: e9 {{.*}} jmp {{.*}} <foo>
+// CHECK:      qux:
+// CHECK-NEXT: 3000: c3 retq
+
+        .text
+foo:
+        callq   bar
+        retq
+
+        .p2align 12
+bar:
+        callq   baz
+        retq
+
+        .p2align 12
+baz:
+        jmp     foo
+
+        .p2align 12
+qux:
+        retq
@@ -32,9 +32,58 @@ getMachOFatMemoryBuffers(StringRef Filename, MemoryBuffer &Mem,
   return Buffers;
 }
 
+ErrorOr<std::unique_ptr<MappedArchive>>
+MappedArchive::map(StringRef Filename) {
+  auto ErrOrBuff = MemoryBuffer::getFileOrSTDIN(Filename);
+  if (auto Err = ErrOrBuff.getError())
+    return Err;
+
+  auto Archive = llvm::make_unique<MappedArchive>();
+  Archive->Filename = Filename;
+  Archive->Buffer = std::move(*ErrOrBuff);
+  std::vector<MemoryBufferRef> ArchiveBuffers;
+  auto ErrOrFat =
+      object::MachOUniversalBinary::create(Archive->Buffer->getMemBufferRef());
+  if (!ErrOrFat) {
+    consumeError(ErrOrFat.takeError());
+    // Not a fat binary must be a standard one.
+    ArchiveBuffers.push_back(Archive->Buffer->getMemBufferRef());
+  } else {
+    Archive->FatBinary = std::move(*ErrOrFat);
+    ArchiveBuffers = getMachOFatMemoryBuffers(
+        Archive->Filename, *Archive->Buffer, *Archive->FatBinary);
+  }
+
+  for (auto MemRef : ArchiveBuffers) {
+    auto ErrOrArchive = object::Archive::create(MemRef);
+    if (!ErrOrArchive)
+      return errorToErrorCode(ErrOrArchive.takeError());
+    Archive->Archives.push_back(std::move(*ErrOrArchive));
+  }
+  return std::move(Archive);
+}
+
+ErrorOr<const MappedArchive &> ArchiveCache::get(StringRef Filename,
+                                                 bool Verbose) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto &Entry = Archives[Filename];
+  if (!Entry) {
+    auto ErrOrArchive = MappedArchive::map(Filename);
+    if (auto Err = ErrOrArchive.getError()) {
+      Archives.erase(Filename);
+      return Err;
+    }
+    if (Verbose)
+      outs() << "\topened new archive '" << Filename << "'\n";
+    Entry = std::move(*ErrOrArchive);
+  }
+  return *Entry;
+}
+
 void BinaryHolder::changeBackingMemoryBuffer(
     std::unique_ptr<MemoryBuffer> &&Buf) {
-  CurrentArchives.clear();
+  CurrentArchive = nullptr;
+  OwnedArchive.reset();
   CurrentObjectFiles.clear();
   CurrentFatBinary.reset();
 
@@ -88,10 +137,10 @@ BinaryHolder::GetMemoryBuffersForFile(StringRef Filename,
 ErrorOr<std::vector<MemoryBufferRef>>
 BinaryHolder::GetArchiveMemberBuffers(StringRef Filename,
                                       sys::TimeValue Timestamp) {
-  if (CurrentArchives.empty())
+  if (!CurrentArchive)
     return make_error_code(errc::no_such_file_or_directory);
 
-  StringRef CurArchiveName = CurrentArchives.front()->getFileName();
+  StringRef CurArchiveName = CurrentArchive->Filename;
   if (!Filename.startswith(Twine(CurArchiveName, "(").str()))
     return make_error_code(errc::no_such_file_or_directory);
 
@@ -99,11 +148,11 @@ BinaryHolder::GetArchiveMemberBuffers(StringRef Filename,
   Filename = Filename.substr(CurArchiveName.size() + 1).drop_back();
 
   std::vector<MemoryBufferRef> Buffers;
-  Buffers.reserve(CurrentArchives.size());
+  Buffers.reserve(CurrentArchive->Archives.size());
 
-  for (const auto &CurrentArchive : CurrentArchives) {
+  for (const auto &Archive : CurrentArchive->Archives) {
     Error Err;
-    for (auto Child : CurrentArchive->children(Err)) {
+    for (auto Child : Archive->children(Err)) {
       if (auto NameOrErr = Child.getName()) {
         if (*NameOrErr == Filename) {
           Expected<sys::TimeValue> ModTimeOrErr = Child.getLastModified();
@@ -138,34 +187,25 @@ BinaryHolder::MapArchiveAndGetMemberBuffers(StringRef Filename,
                                             sys::TimeValue Timestamp) {
   StringRef ArchiveFilename = Filename.substr(0, Filename.find('('));
 
-  auto ErrOrBuff = MemoryBuffer::getFileOrSTDIN(ArchiveFilename);
-  if (auto Err = ErrOrBuff.getError())
+  if (Archives) {
+    auto ErrOrArchive = Archives->get(ArchiveFilename, Verbose);
+    if (auto Err = ErrOrArchive.getError())
+      return Err;
+    changeBackingMemoryBuffer(nullptr);
+    CurrentArchive = &*ErrOrArchive;
+    return GetArchiveMemberBuffers(Filename, Timestamp);
+  }
+
+  auto ErrOrArchive = MappedArchive::map(ArchiveFilename);
+  if (auto Err = ErrOrArchive.getError())
     return Err;
 
   if (Verbose)
     outs() << "\topened new archive '" << ArchiveFilename << "'\n";
 
-  changeBackingMemoryBuffer(std::move(*ErrOrBuff));
-  std::vector<MemoryBufferRef> ArchiveBuffers;
-  auto ErrOrFat = object::MachOUniversalBinary::create(
-      CurrentMemoryBuffer->getMemBufferRef());
-  if (!ErrOrFat) {
-    consumeError(ErrOrFat.takeError());
-    // Not a fat binary must be a standard one.
-    ArchiveBuffers.push_back(CurrentMemoryBuffer->getMemBufferRef());
-  } else {
-    CurrentFatBinary = std::move(*ErrOrFat);
-    CurrentFatBinaryName = ArchiveFilename;
-    ArchiveBuffers = getMachOFatMemoryBuffers(
-        CurrentFatBinaryName, *CurrentMemoryBuffer, *CurrentFatBinary);
-  }
-
-  for (auto MemRef : ArchiveBuffers) {
-    auto ErrOrArchive = object::Archive::create(MemRef);
-    if (!ErrOrArchive)
-      return errorToErrorCode(ErrOrArchive.takeError());
-    CurrentArchives.push_back(std::move(*ErrOrArchive));
-  }
+  changeBackingMemoryBuffer(nullptr);
+  OwnedArchive = std::move(*ErrOrArchive);
+  CurrentArchive = OwnedArchive.get();
   return GetArchiveMemberBuffers(Filename, Timestamp);
 }
 
@@ -14,6 +14,7 @@
 #ifndef LLVM_TOOLS_DSYMUTIL_BINARYHOLDER_H
 #define LLVM_TOOLS_DSYMUTIL_BINARYHOLDER_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/Error.h"
@@ -22,10 +23,36 @@
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/TimeValue.h"
+#include <mutex>
 
 namespace llvm {
 namespace dsymutil {
 
+/// \brief An archive mapped in memory, and parsed once for each of the
+/// architectures it contains.
+struct MappedArchive {
+  std::string Filename;
+  std::unique_ptr<MemoryBuffer> Buffer;
+  std::unique_ptr<object::MachOUniversalBinary> FatBinary;
+  std::vector<std::unique_ptr<object::Archive>> Archives;
+
+  /// Map and parse the archive \p Filename.
+  static ErrorOr<std::unique_ptr<MappedArchive>> map(StringRef Filename);
+};
+
+/// \brief Archives shared by several BinaryHolders, so that an archive
+/// whose members are loaded by different holders (e.g. one per object file
+/// when loading them in parallel) is only mapped and parsed once. The
+/// archives stay mapped for the lifetime of the cache. Thread safe.
+class ArchiveCache {
+  std::mutex Mutex;
+  StringMap<std::unique_ptr<MappedArchive>> Archives;
+
+public:
+  /// Return the archive \p Filename, mapping it if it isn't loaded yet.
+  ErrorOr<const MappedArchive &> get(StringRef Filename, bool Verbose);
+};
+
 /// \brief The BinaryHolder class is responsible for creating and
 /// owning ObjectFile objects and their underlying MemoryBuffer. This
 /// is different from a simple OwningBinary in that it handles
@@ -36,9 +63,12 @@ namespace dsymutil {
 /// archive file (Which is always the case in debug maps).
 /// Currently it only owns one memory buffer at any given time,
 /// meaning that a mapping request will invalidate the previous memory
-/// mapping.
+/// mapping. If it is given an ArchiveCache, archives are taken from
+/// that instead, and outlive the holder's mappings.
 class BinaryHolder {
-  std::vector<std::unique_ptr<object::Archive>> CurrentArchives;
+  const MappedArchive *CurrentArchive = nullptr;
+  std::unique_ptr<MappedArchive> OwnedArchive;
+  ArchiveCache *Archives;
   std::unique_ptr<MemoryBuffer> CurrentMemoryBuffer;
   std::vector<std::unique_ptr<object::ObjectFile>> CurrentObjectFiles;
   std::unique_ptr<object::MachOUniversalBinary> CurrentFatBinary;
@@ -80,7 +110,8 @@ class BinaryHolder {
   ErrorOr<const object::ObjectFile &> getObjfileForArch(const Triple &T);
 
 public:
-  BinaryHolder(bool Verbose) : Verbose(Verbose) {}
+  BinaryHolder(bool Verbose, ArchiveCache *Archives = nullptr)
+      : Archives(Archives), Verbose(Verbose) {}
 
   /// Get the ObjectFiles designated by the \p Filename. This
   /// might be an archive member specification of the form
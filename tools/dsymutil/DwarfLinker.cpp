@@ -36,6 +36,8 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include <string>
@@ -1115,8 +1117,7 @@ void DwarfStreamer::emitFDE(uint32_t CIEOffset, uint32_t AddrSize,
 class DwarfLinker {
 public:
   DwarfLinker(StringRef OutputFilename, const LinkOptions &Options)
-      : OutputFilename(OutputFilename), Options(Options),
-        BinHolder(Options.Verbose), LastCIEOffset(0) {}
+      : OutputFilename(OutputFilename), Options(Options), LastCIEOffset(0) {}
 
   /// \brief Link the contents of the DebugMap.
   bool link(const DebugMap &);
@@ -1425,9 +1426,27 @@ private:
                                                  const DebugMap &Map);
   /// @}
 
+  /// \brief A debug map object file, mapped in memory, and its parsed
+  /// debug info.
+  struct LinkContext {
+    DebugMapObject &DMO;
+    BinaryHolder BinHolder;
+    const object::ObjectFile *ObjectFile = nullptr;
+    std::unique_ptr<DWARFContextInMemory> DwarfContext;
+    /// The reason the object file couldn't be loaded, if any.
+    std::error_code LoadError;
+
+    LinkContext(DebugMapObject &DMO, bool Verbose, ArchiveCache &Archives)
+        : DMO(DMO), BinHolder(Verbose, &Archives) {}
+  };
+
+  /// \brief Load the object file of \p Context and parse all the DIEs of
+  /// its compile units. This doesn't touch any linker state, so it can
+  /// run concurrently with the link of the previous object files.
+  static void parseObject(LinkContext &Context, const DebugMap &Map);
+
   std::string OutputFilename;
   LinkOptions Options;
-  BinaryHolder BinHolder;
   std::unique_ptr<DwarfStreamer> Streamer;
   uint64_t OutputDebugInfoSize;
   unsigned UnitID; ///< A unique ID that identifies each compile unit.
@@ -3422,79 +3441,165 @@ void DwarfLinker::DIECloner::cloneAllCompileUnits(
   }
 }
 
+void DwarfLinker::parseObject(LinkContext &Context, const DebugMap &Map) {
+  auto ErrOrObjs = Context.BinHolder.GetObjectFiles(
+      Context.DMO.getObjectFilename(), Context.DMO.getTimestamp());
+  if ((Context.LoadError = ErrOrObjs.getError()))
+    return;
+  auto ErrOrObj = Context.BinHolder.Get(Map.getTriple());
+  if ((Context.LoadError = ErrOrObj.getError()))
+    return;
+
+  Context.ObjectFile = &*ErrOrObj;
+  Context.DwarfContext = llvm::make_unique<DWARFContextInMemory>(*ErrOrObj);
+  for (const auto &CU : Context.DwarfContext->compile_units())
+    CU->getUnitDIE(false);
+}
+
 bool DwarfLinker::link(const DebugMap &Map) {
 
   if (!createStreamer(Map.getTriple(), OutputFilename))
     return false;
 
+  // The timers only print anything if they have been started.
+  TimerGroup PhaseTimers("DWARF linker");
+  Timer LoadTimer("Load and parse object files", PhaseTimers);
+  Timer AnalyzeTimer("Analyze DIEs", PhaseTimers);
+  Timer CloneTimer("Clone and emit DIEs", PhaseTimers);
+  Timer FinishTimer("Emit global sections", PhaseTimers);
+  auto Phase = [&](Timer &T) { return Options.Timing ? &T : nullptr; };
+
   // Size of the DIEs (and headers) generated for the linked output.
   OutputDebugInfoSize = 0;
   // A unique ID that identifies each compile unit.
   UnitID = 0;
   DebugMap ModuleMap(Map.getTriple(), Map.getBinaryPath());
 
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
+  // Loading the object files and parsing their DIEs is independent of the
+  // link proper, so with several threads it runs ahead of it on a thread
+  // pool. Everything else, including the ODR type uniquing, happens on
+  // this thread in debug map order: the offsets of the cloned DIEs and
+  // strings, and the choice of the canonical definition of each type,
+  // depend on that order, and the output must not depend on scheduling.
+  // The verbose output of the loading must be interleaved with the rest,
+  // so -verbose forces a serial link.
+  std::vector<DebugMapObject *> Objects;
+  for (const auto &Obj : Map.objects())
+    Objects.push_back(Obj.get());
+  std::unique_ptr<ThreadPool> Pool;
+  if (Options.Threads > 1 && !Options.Verbose && Objects.size() > 1)
+    Pool = llvm::make_unique<ThreadPool>(Options.Threads);
+  // Each object file gets its own BinaryHolder, but the members of an
+  // archive are usually consecutive in the debug map: map every archive
+  // once, for all of them.
+  ArchiveCache Archives;
+
+  // Only parse a few objects ahead of the link to bound memory usage.
+  const size_t Lookahead = 2 * Options.Threads;
+  std::vector<std::unique_ptr<LinkContext>> Contexts(Objects.size());
+  std::vector<std::shared_future<ThreadPool::VoidTy>> Parsed(Objects.size());
+  auto StartParsing = [&](size_t I) {
+    Contexts[I] =
+        llvm::make_unique<LinkContext>(*Objects[I], Options.Verbose, Archives);
+    LinkContext *Context = Contexts[I].get();
+    Parsed[I] = Pool->async([Context, &Map] { parseObject(*Context, Map); });
+  };
+  if (Pool)
+    for (size_t I = 0, E = std::min(Lookahead, Objects.size()); I != E; ++I)
+      StartParsing(I);
+
+  for (size_t I = 0, E = Objects.size(); I != E; ++I) {
+    DebugMapObject &Obj = *Objects[I];
+    CurrentDebugObject = &Obj;
+    if (Pool && I + Lookahead < E)
+      StartParsing(I + Lookahead);
 
     if (Options.Verbose)
-      outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = loadObject(BinHolder, *Obj, Map);
-    if (!ErrOrObj)
+      outs() << "DEBUG MAP OBJECT: " << Obj.getObjectFilename() << "\n";
+
+    std::unique_ptr<LinkContext> Context;
+    {
+      TimeRegion Region(Phase(LoadTimer));
+      if (Pool) {
+        Parsed[I].wait();
+        Context = std::move(Contexts[I]);
+      } else {
+        Context =
+            llvm::make_unique<LinkContext>(Obj, Options.Verbose, Archives);
+        parseObject(*Context, Map);
+      }
+    }
+    if (Context->LoadError) {
+      reportWarning(Twine(Obj.getObjectFilename()) + ": " +
+                    Context->LoadError.message());
       continue;
+    }
+    DWARFContextInMemory &DwarfContext = *Context->DwarfContext;
 
-    // Look for relocations that correspond to debug map entries.
     RelocationManager RelocMgr(*this);
-    if (!RelocMgr.findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
-      if (Options.Verbose)
-        outs() << "No valid relocations found. Skipping.\n";
-      continue;
-    }
+    {
+      TimeRegion Region(Phase(AnalyzeTimer));
+
+      // Look for relocations that correspond to debug map entries.
+      if (!RelocMgr.findValidRelocsInDebugInfo(*Context->ObjectFile, Obj)) {
+        if (Options.Verbose)
+          outs() << "No valid relocations found. Skipping.\n";
+        continue;
+      }
+
+      startDebugObject(DwarfContext, Obj);
 
-    // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
-    startDebugObject(DwarfContext, *Obj);
+      // In a first phase, just read in the debug info and load all clang
+      // modules.
+      for (const auto &CU : DwarfContext.compile_units()) {
+        auto *CUDie = CU->getUnitDIE(false);
+        if (Options.Verbose) {
+          outs() << "Input compilation unit:";
+          CUDie->dump(outs(), CU.get(), 0);
+        }
 
-    // In a first phase, just read in the debug info and load all clang modules.
-    for (const auto &CU : DwarfContext.compile_units()) {
-      auto *CUDie = CU->getUnitDIE(false);
-      if (Options.Verbose) {
-        outs() << "Input compilation unit:";
-        CUDie->dump(outs(), CU.get(), 0);
+        if (!registerModuleReference(*CUDie, *CU, ModuleMap))
+          Units.emplace_back(*CU, UnitID++, !Options.NoODR, "");
       }
 
-      if (!registerModuleReference(*CUDie, *CU, ModuleMap))
-        Units.emplace_back(*CU, UnitID++, !Options.NoODR, "");
+      // Now build the DIE parent links that we will use during the next
+      // phase.
+      for (auto &CurrentUnit : Units)
+        analyzeContextInfo(CurrentUnit.getOrigUnit().getUnitDIE(), 0,
+                           CurrentUnit, &ODRContexts.getRoot(), StringPool,
+                           ODRContexts);
+
+      // Then mark all the DIEs that need to be present in the linked
+      // output and collect some information about them. Note that this
+      // loop can not be merged with the previous one becaue cross-cu
+      // references require the ParentIdx to be setup for every CU in
+      // the object file before calling this.
+      for (auto &CurrentUnit : Units)
+        lookForDIEsToKeep(RelocMgr, *CurrentUnit.getOrigUnit().getUnitDIE(),
+                          Obj, CurrentUnit, 0);
     }
 
-    // Now build the DIE parent links that we will use during the next phase.
-    for (auto &CurrentUnit : Units)
-      analyzeContextInfo(CurrentUnit.getOrigUnit().getUnitDIE(), 0, CurrentUnit,
-                         &ODRContexts.getRoot(), StringPool, ODRContexts);
-
-    // Then mark all the DIEs that need to be present in the linked
-    // output and collect some information about them. Note that this
-    // loop can not be merged with the previous one becaue cross-cu
-    // references require the ParentIdx to be setup for every CU in
-    // the object file before calling this.
-    for (auto &CurrentUnit : Units)
-      lookForDIEsToKeep(RelocMgr, *CurrentUnit.getOrigUnit().getUnitDIE(), *Obj,
-                        CurrentUnit, 0);
-
-    // The calls to applyValidRelocs inside cloneDIE will walk the
-    // reloc array again (in the same way findValidRelocsInDebugInfo()
-    // did). We need to reset the NextValidReloc index to the beginning.
-    RelocMgr.resetValidRelocs();
-    if (RelocMgr.hasValidRelocs())
-      DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
-          .cloneAllCompileUnits(DwarfContext);
-    if (!Options.NoOutput && !Units.empty())
-      patchFrameInfoForObject(*Obj, DwarfContext,
-                              Units[0].getOrigUnit().getAddressByteSize());
-
-    // Clean-up before starting working on the next object.
-    endDebugObject();
+    {
+      TimeRegion Region(Phase(CloneTimer));
+
+      // The calls to applyValidRelocs inside cloneDIE will walk the
+      // reloc array again (in the same way findValidRelocsInDebugInfo()
+      // did). We need to reset the NextValidReloc index to the beginning.
+      RelocMgr.resetValidRelocs();
+      if (RelocMgr.hasValidRelocs())
+        DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
+            .cloneAllCompileUnits(DwarfContext);
+      if (!Options.NoOutput && !Units.empty())
+        patchFrameInfoForObject(Obj, DwarfContext,
+                                Units[0].getOrigUnit().getAddressByteSize());
+
+      // Clean-up before starting working on the next object.
+      endDebugObject();
+    }
   }
 
+  TimeRegion Region(Phase(FinishTimer));
+
   // Emit everything that's global.
   if (!Options.NoOutput) {
     Streamer->emitAbbrevs(Abbreviations);
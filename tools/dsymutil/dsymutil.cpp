@@ -24,8 +24,10 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include <algorithm>
 #include <cstdint>
 #include <string>
+#include <thread>
 
 using namespace llvm::dsymutil;
 
@@ -82,6 +84,19 @@ static opt<bool>
           desc("Do not use ODR (One Definition Rule) for type uniquing."),
           init(false), cat(DsymCategory));
 
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Number of threads to load and parse object files with "
+         "(default: autodetect). The output doesn't depend on it."),
+    init(0), cat(DsymCategory));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads), Prefix);
+
+static opt<bool> TimePhases(
+    "time-phases",
+    desc("Print the time spent in each phase of the DWARF link."),
+    init(false), cat(DsymCategory));
+
 static opt<bool> DumpDebugMap(
     "dump-debug-map",
     desc("Parse and dump the debug map to standard output. Not DWARF link "
@@ -264,6 +279,10 @@ int main(int argc, char **argv) {
   Options.Verbose = Verbose;
   Options.NoOutput = NoOutput;
   Options.NoODR = NoODR;
+  Options.Timing = TimePhases;
+  Options.Threads = NumThreads;
+  if (Options.Threads == 0)
+    Options.Threads = std::max(1U, std::thread::hardware_concurrency());
   Options.PrependPath = OsoPrependPath;
 
   llvm::InitializeAllTargetInfos();
@@ -28,9 +28,11 @@ struct LinkOptions {
   bool Verbose;  ///< Verbosity
   bool NoOutput; ///< Skip emitting output
   bool NoODR;    ///< Do not unique types according to ODR
+  bool Timing;   ///< Print the time spent in each phase of the link
+  unsigned Threads; ///< Number of threads to parse object files with
   std::string PrependPath; ///< -oso-prepend-path
 
-  LinkOptions() : Verbose(false), NoOutput(false) {}
+  LinkOptions() : Verbose(false), NoOutput(false), Timing(false), Threads(1) {}
 };
 
 /// \brief Extract the DebugMaps from the given file.
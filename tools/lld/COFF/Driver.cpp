@@ -373,11 +373,9 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
             : getDefaultDebugType(Args);
   }
 
-  // Create a dummy PDB file to satisfy build sytem rules.
-  if (auto *Arg = Args.getLastArg(OPT_pdb)) {
+  // Handle /pdb
+  if (auto *Arg = Args.getLastArg(OPT_pdb))
     Config->PDBPath = Arg->getValue();
-    createPDB(Config->PDBPath);
-  }
 
   // Handle /noentry
   if (Args.hasArg(OPT_noentry)) {
@@ -761,6 +759,10 @@ void LinkerDriver::link(llvm::ArrayRef<const char *> ArgsArr) {
   // Write the result.
   writeResult(&Symtab);
 
+  // Create a PDB file with the type records of the object files.
+  if (!Config->PDBPath.empty())
+    createPDB(Config->PDBPath, &Symtab);
+
   // Create a symbol map file containing symbol VAs and their names
   // to help debugging.
   if (auto *Arg = Args.getLastArg(OPT_lldmap)) {
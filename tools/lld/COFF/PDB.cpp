@@ -9,8 +9,15 @@
 
 #include "PDB.h"
 #include "Error.h"
+#include "InputFiles.h"
+#include "SymbolTable.h"
+#include "lld/Core/Parallel.h"
+#include "llvm/DebugInfo/CodeView/MemoryTypeTableBuilder.h"
+#include "llvm/DebugInfo/CodeView/TypeStreamMerger.h"
+#include "llvm/DebugInfo/MSF/ByteStream.h"
 #include "llvm/DebugInfo/MSF/MSFBuilder.h"
 #include "llvm/DebugInfo/MSF/MSFCommon.h"
+#include "llvm/DebugInfo/MSF/StreamReader.h"
 #include "llvm/DebugInfo/PDB/Raw/DbiStream.h"
 #include "llvm/DebugInfo/PDB/Raw/DbiStreamBuilder.h"
 #include "llvm/DebugInfo/PDB/Raw/InfoStream.h"
@@ -19,18 +26,122 @@
 #include "llvm/DebugInfo/PDB/Raw/PDBFileBuilder.h"
 #include "llvm/DebugInfo/PDB/Raw/TpiStream.h"
 #include "llvm/DebugInfo/PDB/Raw/TpiStreamBuilder.h"
+#include "llvm/Object/COFF.h"
+#include "llvm/Support/COFF.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/FileOutputBuffer.h"
 #include <memory>
 
 using namespace lld;
+using namespace lld::coff;
 using namespace llvm;
+using namespace llvm::codeview;
 using namespace llvm::support;
 using namespace llvm::support::endian;
 
 static ExitOnError ExitOnErr;
 
-void coff::createPDB(StringRef Path) {
+namespace {
+// A table of deduplicated type records, and the storage for them.
+struct TypeTable {
+  TypeTable() : Builder(Alloc) {}
+
+  BumpPtrAllocator Alloc;
+  MemoryTypeTableBuilder Builder;
+  // Set if a merge into this table failed.
+  bool Failed = false;
+};
+}
+
+// Returns the contents of the .debug$T section of File, without the
+// signature. Returns an empty array if File has no such section.
+static ArrayRef<uint8_t> getDebugTypes(ObjectFile *File) {
+  for (const object::SectionRef &Sec : File->getCOFFObj()->sections()) {
+    StringRef Name;
+    if (auto EC = Sec.getName(Name))
+      fatal(EC, "getSectionName failed: " + File->getName());
+    if (Name != ".debug$T")
+      continue;
+    StringRef Data;
+    if (auto EC = Sec.getContents(Data))
+      fatal(EC, "getSectionContents failed: " + File->getName());
+    if (Data.size() < 4 || read32le(Data.data()) != COFF::DEBUG_SECTION_MAGIC)
+      fatal(".debug$T section of " + File->getName() +
+            " has an unknown signature");
+    return ArrayRef<uint8_t>(Data.bytes_begin() + 4, Data.bytes_end());
+  }
+  return {};
+}
+
+// Merges the type stream in Data into Table. Returns false on failure.
+static bool mergeTypes(TypeTable &Table, ArrayRef<uint8_t> Data) {
+  msf::ByteStream Stream(Data);
+  msf::StreamReader Reader(Stream);
+  CVTypeArray Types;
+  if (auto EC = Reader.readArray(Types, Reader.getLength())) {
+    consumeError(std::move(EC));
+    return false;
+  }
+  return mergeTypeStreams(Table.Builder, Types);
+}
+
+// Merges the type records of all object files, in order, into one table.
+//
+// A table lists its records in the order they are first seen, so merging
+// two tables built from consecutive ranges of files gives the same table as
+// merging the files of both ranges one by one. That lets every file be
+// merged into a table of its own, with the records hashed and deduplicated
+// in parallel, before the tables are merged pairwise, a level at a time,
+// until one is left. Each level halves the number of tables and merges its
+// pairs in parallel. The result, including its type indices, is the same
+// as that of merging the files serially, whatever the number of threads.
+static std::unique_ptr<TypeTable>
+mergeObjectTypes(ArrayRef<ObjectFile *> ObjectFiles) {
+  std::vector<std::pair<ObjectFile *, ArrayRef<uint8_t>>> Inputs;
+  for (ObjectFile *File : ObjectFiles) {
+    ArrayRef<uint8_t> Data = getDebugTypes(File);
+    if (!Data.empty())
+      Inputs.push_back(std::make_pair(File, Data));
+  }
+
+  std::vector<std::unique_ptr<TypeTable>> Tables(Inputs.size());
+  std::vector<size_t> Indices(Inputs.size());
+  for (size_t I = 0; I < Indices.size(); ++I)
+    Indices[I] = I;
+  parallel_for_each(Indices.begin(), Indices.end(), [&](size_t I) {
+    Tables[I] = llvm::make_unique<TypeTable>();
+    Tables[I]->Failed = !mergeTypes(*Tables[I], Inputs[I].second);
+  });
+  for (size_t I = 0; I < Tables.size(); ++I)
+    if (Tables[I]->Failed)
+      fatal("failed to merge the type records of " +
+            Inputs[I].first->getName());
+
+  for (size_t Width = 1; Width < Tables.size(); Width *= 2) {
+    std::vector<size_t> Pairs;
+    for (size_t I = 0; I + Width < Tables.size(); I += 2 * Width)
+      Pairs.push_back(I);
+    parallel_for_each(Pairs.begin(), Pairs.end(), [&](size_t I) {
+      TypeTable &Dest = *Tables[I];
+      std::unique_ptr<TypeTable> Src = std::move(Tables[I + Width]);
+      std::vector<uint8_t> Data;
+      for (StringRef Record : Src->Builder.getRecords())
+        Data.insert(Data.end(), Record.bytes_begin(), Record.bytes_end());
+      Dest.Failed = !mergeTypes(Dest, Data);
+    });
+    // The records were written by a TypeTableBuilder, so they can only fail
+    // to merge because of a bug.
+    for (size_t I : Pairs)
+      if (Tables[I]->Failed)
+        fatal("failed to merge type records");
+  }
+
+  if (Tables.empty())
+    return llvm::make_unique<TypeTable>();
+  return std::move(Tables[0]);
+}
+
+void coff::createPDB(StringRef Path, SymbolTable *Symtab) {
   BumpPtrAllocator Alloc;
   pdb::PDBFileBuilder Builder(Alloc);
   ExitOnErr(Builder.initialize(4096)); // 4096 is blocksize
@@ -51,9 +162,15 @@ void coff::createPDB(StringRef Path) {
 
   InfoBuilder.setVersion(pdb::PdbRaw_ImplVer::PdbImplVC70);
 
-  // Add an empty TPI stream.
+  // Add a TPI stream with the type records of all object files.
   auto &TpiBuilder = Builder.getTpiBuilder();
   TpiBuilder.setVersionHeader(pdb::PdbTpiV80);
+  std::unique_ptr<TypeTable> Types = mergeObjectTypes(Symtab->ObjectFiles);
+  for (StringRef Record : Types->Builder.getRecords()) {
+    ArrayRef<uint8_t> Data(Record.bytes_begin(), Record.bytes_end());
+    auto Kind = static_cast<TypeLeafKind>(read16le(Data.data() + 2));
+    TpiBuilder.addTypeRecord(CVType(Kind, Data));
+  }
 
   // Write to a file.
   ExitOnErr(Builder.commit(Path));
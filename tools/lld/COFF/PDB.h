@@ -14,7 +14,9 @@
 
 namespace lld {
 namespace coff {
-void createPDB(llvm::StringRef Path);
+class SymbolTable;
+
+void createPDB(llvm::StringRef Path, SymbolTable *Symtab);
 }
 }
 
@@ -32,6 +32,8 @@ namespace coff {
 
 class Chunk;
 class Defined;
+class DefinedAbsolute;
+class DefinedRelative;
 class Lazy;
 class SymbolBody;
 struct Symbol;
@@ -1,5 +1,6 @@
 #include "llvm/ExecutionEngine/Orc/OrcABISupport.h"
 #include "llvm/ExecutionEngine/Orc/OrcRemoteTargetServer.h"
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRPCChannel.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/Process.h"
@@ -21,19 +22,35 @@ ExitOnError ExitOnErr;
 
 int main(int argc, char *argv[]) {
 
-  if (argc != 3) {
-    errs() << "Usage: " << argv[0] << " <input fd> <output fd>\n";
+  bool UseShm = argc > 1 && StringRef(argv[1]) == "-shm";
+  if (argc != 3 && !(UseShm && argc == 4)) {
+    errs() << "Usage: " << argv[0] << " <input fd> <output fd>\n"
+           << "       " << argv[0]
+           << " -shm <shared memory fd> [<parent liveness fd>]\n";
     return 1;
   }
 
   ExitOnErr.setBanner(std::string(argv[0]) + ":");
 
-  int InFD;
-  int OutFD;
-  {
+  std::unique_ptr<remote::RPCByteChannel> Channel;
+  if (UseShm) {
+    int ShmFD;
+    int PeerFD = -1;
+    std::istringstream ShmFDStream(argv[2]);
+    ShmFDStream >> ShmFD;
+    if (argc == 4) {
+      std::istringstream PeerFDStream(argv[3]);
+      PeerFDStream >> PeerFD;
+    }
+    Channel = ExitOnErr(remote::SharedMemoryRPCChannel::attach(ShmFD, PeerFD));
+    close(ShmFD);
+  } else {
+    int InFD;
+    int OutFD;
     std::istringstream InFDStream(argv[1]), OutFDStream(argv[2]);
     InFDStream >> InFD;
     OutFDStream >> OutFD;
+    Channel = llvm::make_unique<FDRPCChannel>(InFD, OutFD);
   }
 
   if (sys::DynamicLibrary::LoadLibraryPermanently(nullptr)) {
@@ -53,13 +70,14 @@ int main(int argc, char *argv[]) {
     RTDyldMemoryManager::deregisterEHFramesInProcess(Addr, Size);
   };
 
-  FDRPCChannel Channel(InFD, OutFD);
-  typedef remote::OrcRemoteTargetServer<FDRPCChannel, HostOrcArch> JITServer;
-  JITServer Server(Channel, SymbolLookup, RegisterEHFrames, DeregisterEHFrames);
+  typedef remote::OrcRemoteTargetServer<remote::RPCByteChannel, HostOrcArch>
+    JITServer;
+  JITServer Server(*Channel, SymbolLookup, RegisterEHFrames,
+                   DeregisterEHFrames);
 
   while (1) {
     uint32_t RawId;
-    ExitOnErr(Server.startReceivingFunction(Channel, RawId));
+    ExitOnErr(Server.startReceivingFunction(*Channel, RawId));
     auto Id = static_cast<JITServer::JITFuncId>(RawId);
     switch (Id) {
     case JITServer::TerminateSessionId:
@@ -71,8 +89,5 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  close(InFD);
-  close(OutFD);
-
   return 0;
 }
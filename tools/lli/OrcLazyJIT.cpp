@@ -9,10 +9,17 @@
 
 #include "OrcLazyJIT.h"
 #include "llvm/ExecutionEngine/Orc/OrcABISupport.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <system_error>
+#include <thread>
 
 using namespace llvm;
 
@@ -44,30 +51,54 @@ namespace {
   cl::opt<bool> OrcInlineStubs("orc-lazy-inline-stubs",
                                cl::desc("Try to inline stubs"),
                                cl::init(true), cl::Hidden);
+
+  cl::opt<unsigned>
+  OrcCompileThreads("orc-lazy-compile-threads",
+                    cl::desc("Number of threads to compile functions on "
+                             "eagerly in the background (0 = compile on "
+                             "first call)"),
+                    cl::init(0), cl::Hidden);
+
+  cl::opt<unsigned>
+  OrcTierUpThreshold("orc-lazy-tier-up-threshold",
+                     cl::desc("Compile functions at -O0 with execution "
+                              "counters and recompile them at -O2 in the "
+                              "background once their entry and backedge "
+                              "count reaches this value (0 = disabled)"),
+                     cl::init(0), cl::Hidden);
+
+  cl::opt<bool>
+  OrcTierUpBackground("orc-lazy-tier-up-background",
+                      cl::desc("Poll for hot functions on a background "
+                               "thread. Otherwise they are only recompiled "
+                               "when the program calls __orc_lazy_tier_up()"),
+                      cl::init(true), cl::Hidden);
 }
 
-OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
+OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper(StringRef Tier) {
 
   switch (OrcDumpKind) {
   case DumpKind::NoDump:
     return [](std::unique_ptr<Module> M) { return M; };
 
   case DumpKind::DumpFuncsToStdOut:
-    return [](std::unique_ptr<Module> M) {
-      printf("[ ");
+    return [Tier](std::unique_ptr<Module> M) {
+      // Build the line up first: partitions may be compiled on several
+      // threads at once.
+      std::string Line = Tier.empty() ? "[ " : (Tier + " [ ").str();
 
       for (const auto &F : *M) {
         if (F.isDeclaration())
           continue;
 
         if (F.hasName()) {
-          std::string Name(F.getName());
-          printf("%s ", Name.c_str());
+          Line += F.getName();
+          Line += " ";
         } else
-          printf("<anon> ");
+          Line += "<anon> ";
       }
 
-      printf("]\n");
+      printf("%s]\n", Line.c_str());
       return M;
     };
 
@@ -96,17 +127,104 @@ OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
   llvm_unreachable("Unknown DumpKind");
 }
 
+OrcLazyJIT::CompileLayerT::CompileFtor
+OrcLazyJIT::createCompiler(bool Concurrent) {
+  if (!Concurrent)
+    return orc::SimpleCompiler(*TM);
+
+  // A TargetMachine can only compile one module at a time, so give each
+  // compile a copy of TM of its own, reusing copies that have gone idle.
+  return [this](Module &M) {
+    std::unique_ptr<TargetMachine> CompileTM;
+    {
+      std::lock_guard<std::mutex> Lock(IdleCompileTMsMutex);
+      if (!IdleCompileTMs.empty()) {
+        CompileTM = std::move(IdleCompileTMs.back());
+        IdleCompileTMs.pop_back();
+      }
+    }
+    if (!CompileTM)
+      CompileTM.reset(TM->getTarget().createTargetMachine(
+          TM->getTargetTriple().str(), TM->getTargetCPU(),
+          TM->getTargetFeatureString(), TM->Options,
+          TM->getRelocationModel(), TM->getCodeModel(), TM->getOptLevel()));
+
+    auto Obj = orc::SimpleCompiler(*CompileTM)(M);
+
+    std::lock_guard<std::mutex> Lock(IdleCompileTMsMutex);
+    IdleCompileTMs.push_back(std::move(CompileTM));
+    return Obj;
+  };
+}
+
+void OrcLazyJIT::enableTierUp(std::unique_ptr<TargetMachine> OptTM,
+                              uint64_t HotThreshold) {
+  this->OptTM = std::move(OptTM);
+  Profiler = llvm::make_unique<orc::TierUpProfiler>(HotThreshold);
+  OptCompileLayer = llvm::make_unique<CompileLayerT>(
+      OptObjectLayer, orc::SimpleCompiler(*this->OptTM));
+
+  auto DebugDump = createDebugDumper("tier-1");
+  auto Optimize = [DebugDump](std::unique_ptr<Module> M) {
+    PassManagerBuilder Builder;
+    Builder.OptLevel = 2;
+
+    legacy::FunctionPassManager FPM(M.get());
+    Builder.populateFunctionPassManager(FPM);
+    FPM.doInitialization();
+    for (auto &F : *M)
+      FPM.run(F);
+    FPM.doFinalization();
+
+    legacy::PassManager MPM;
+    Builder.populateModulePassManager(MPM);
+    MPM.run(*M);
+    return DebugDump(std::move(M));
+  };
+
+  // Hot code is resolved against the JIT first (by TierUpCompiler), then
+  // against the C++ runtime overrides and the host process.
+  auto ExternalResolver = orc::createLambdaResolver(
+      [](const std::string &Name) { return JITSymbol(nullptr); },
+      [this](const std::string &Name) -> JITSymbol {
+        if (auto Sym = CXXRuntimeOverrides.searchOverrides(Name))
+          return Sym;
+        if (auto Addr = RTDyldMemoryManager::getSymbolAddressInProcess(Name))
+          return JITSymbol(Addr, JITSymbolFlags::Exported);
+        return JITSymbol(nullptr);
+      });
+
+  TierUp = llvm::make_unique<TierUpCompilerT>(*Profiler, CODLayer,
+                                              *OptCompileLayer, Optimize,
+                                              std::move(ExternalResolver));
+}
+
 // Defined in lli.cpp.
 CodeGenOpt::Level getOptLevel();
 
 
+// Recompile the hot functions of J, and report how many stubs were switched.
+static unsigned tierUp(OrcLazyJIT &J) {
+  unsigned NumSwitched = J.recompileHotFunctions();
+  if (NumSwitched && OrcDumpKind == DumpKind::DumpFuncsToStdOut)
+    printf("tier-up: switched %u stubs to tier-1 code\n", NumSwitched);
+  return NumSwitched;
+}
+
+// The JIT that __orc_lazy_tier_up works on.
+static OrcLazyJIT *TierUpJIT = nullptr;
+
+// Lets the program recompile its hot functions synchronously, so that it
+// knows when it is running tier-1 code. Returns the number of stubs switched.
+static int32_t tierUpHook() { return tierUp(*TierUpJIT); }
+
 template <typename PtrTy>
 static PtrTy fromTargetAddress(JITTargetAddress Addr) {
   return reinterpret_cast<PtrTy>(static_cast<uintptr_t>(Addr));
 }
 
 int llvm::runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms, int ArgC,
-                        char* ArgV[]) {
+                        char* ArgV[], JITEventListener *Listener) {
   // Add the program's symbols into the JIT's search space.
   if (sys::DynamicLibrary::LoadLibraryPermanently(nullptr)) {
     errs() << "Error loading program symbols.\n";
@@ -115,8 +233,9 @@ int llvm::runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms, int ArgC,
 
   // Grab a target machine and try to build a factory function for the
   // target-specific Orc callback manager.
+  // When tiering, the first tier is compiled as quickly as possible.
   EngineBuilder EB;
-  EB.setOptLevel(getOptLevel());
+  EB.setOptLevel(OrcTierUpThreshold ? CodeGenOpt::None : getOptLevel());
   auto TM = std::unique_ptr<TargetMachine>(EB.selectTarget());
   Triple T(TM->getTargetTriple());
   auto CompileCallbackMgr = orc::createLocalCompileCallbackManager(T, 0);
@@ -138,10 +257,27 @@ int llvm::runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms, int ArgC,
     return 1;
   }
 
-  // Everything looks good. Build the JIT.
+  // Everything looks good. Build the JIT. The compile threads must outlive
+  // the JIT, so create them first.
+  std::unique_ptr<ThreadPool> CompileThreads;
+  if (OrcCompileThreads)
+    CompileThreads = llvm::make_unique<ThreadPool>(OrcCompileThreads);
   OrcLazyJIT J(std::move(TM), std::move(CompileCallbackMgr),
                std::move(IndirectStubsMgrBuilder),
-               OrcInlineStubs);
+               OrcInlineStubs, CompileThreads.get());
+
+  if (Listener)
+    J.registerJITEventListener(*Listener);
+
+  if (OrcTierUpThreshold) {
+    EngineBuilder OptEB;
+    OptEB.setOptLevel(CodeGenOpt::Aggressive);
+    J.enableTierUp(std::unique_ptr<TargetMachine>(OptEB.selectTarget()),
+                   OrcTierUpThreshold);
+    TierUpJIT = &J;
+    sys::DynamicLibrary::AddSymbol("__orc_lazy_tier_up",
+                                   reinterpret_cast<void *>(&tierUpHook));
+  }
 
   // Add the module, look up main and run it.
   J.addModuleSet(std::move(Ms));
@@ -152,8 +288,25 @@ int llvm::runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms, int ArgC,
     return 1;
   }
 
+  // Poll for hot functions while main runs.
+  std::atomic<bool> MainDone(false);
+  std::thread TierUpThread;
+  if (OrcTierUpThreshold && OrcTierUpBackground)
+    TierUpThread = std::thread([&J, &MainDone]() {
+      while (!MainDone) {
+        tierUp(J);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+
   typedef int (*MainFnPtr)(int, char*[]);
   auto Main = fromTargetAddress<MainFnPtr>(MainSym.getAddress());
-  return Main(ArgC, ArgV);
+  int Result = Main(ArgC, ArgV);
+
+  if (TierUpThread.joinable()) {
+    MainDone = true;
+    TierUpThread.join();
+  }
+  return Result;
 }
 
@@ -16,21 +16,54 @@
 #define LLVM_TOOLS_LLI_ORCLAZYJIT_H
 
 #include "llvm/ADT/Triple.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
 #include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/Orc/TieredCompilation.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include <map>
+#include <mutex>
 
 namespace llvm {
 
 class OrcLazyJIT {
+private:
+
+  // Tell the registered JIT event listeners about each object that is loaded,
+  // and remember it so that they can be told again once it is finalized.
+  class NotifyObjectLoadedT {
+  public:
+    typedef std::vector<std::unique_ptr<RuntimeDyld::LoadedObjectInfo>>
+        LoadedObjInfoListT;
+
+    NotifyObjectLoadedT(OrcLazyJIT &J) : J(J) {}
+
+    template <typename ObjListT>
+    void operator()(orc::ObjectLinkingLayerBase::ObjSetHandleT H,
+                    const ObjListT &Objects,
+                    const LoadedObjInfoListT &Infos) const {
+      std::vector<const object::ObjectFile *> Objs;
+      for (unsigned I = 0; I < Objects.size(); ++I) {
+        for (JITEventListener *L : J.EventListeners)
+          L->NotifyObjectEmitted(*Objects[I]->getBinary(), *Infos[I]);
+        Objs.push_back(Objects[I]->getBinary());
+      }
+      std::lock_guard<std::mutex> Lock(J.UnfinalizedObjectsMutex);
+      J.UnfinalizedObjects[&*H] = std::move(Objs);
+    }
+
+  private:
+    OrcLazyJIT &J;
+  };
+
 public:
 
   typedef orc::JITCompileCallbackManager CompileCallbackMgr;
-  typedef orc::ObjectLinkingLayer<> ObjLayerT;
+  typedef orc::ObjectLinkingLayer<NotifyObjectLoadedT> ObjLayerT;
   typedef orc::IRCompileLayer<ObjLayerT> CompileLayerT;
   typedef std::function<std::unique_ptr<Module>(std::unique_ptr<Module>)>
     TransformFtor;
@@ -39,18 +72,21 @@ public:
   typedef CODLayerT::IndirectStubsManagerBuilderT
     IndirectStubsManagerBuilder;
   typedef CODLayerT::ModuleSetHandleT ModuleSetHandleT;
+  typedef orc::TierUpCompiler<CODLayerT, CompileLayerT> TierUpCompilerT;
 
   OrcLazyJIT(std::unique_ptr<TargetMachine> TM,
              std::unique_ptr<CompileCallbackMgr> CCMgr,
              IndirectStubsManagerBuilder IndirectStubsMgrBuilder,
-             bool InlineStubs)
+             bool InlineStubs, ThreadPool *CompileThreads = nullptr)
       : TM(std::move(TM)), DL(this->TM->createDataLayout()),
 	CCMgr(std::move(CCMgr)),
-	ObjectLayer(),
-        CompileLayer(ObjectLayer, orc::SimpleCompiler(*this->TM)),
-        IRDumpLayer(CompileLayer, createDebugDumper()),
+	ObjectLayer(NotifyObjectLoadedT(*this), createNotifyFinalized()),
+        CompileLayer(ObjectLayer, createCompiler(CompileThreads != nullptr)),
+        IRDumpLayer(CompileLayer, createTierZeroTransform(createDebugDumper())),
         CODLayer(IRDumpLayer, extractSingleFunction, *this->CCMgr,
-                 std::move(IndirectStubsMgrBuilder), InlineStubs),
+                 std::move(IndirectStubsMgrBuilder), InlineStubs,
+                 CompileThreads),
+        OptObjectLayer(NotifyObjectLoadedT(*this), createNotifyFinalized()),
         CXXRuntimeOverrides(
             [this](const std::string &S) { return mangle(S); }) {}
 
@@ -126,6 +162,24 @@ public:
     return H;
   }
 
+  /// Instrument newly compiled code with execution counters, and allow
+  /// functions whose count reaches HotThreshold to be recompiled with OptTM
+  /// by recompileHotFunctions. Must be called before any modules are added.
+  void enableTierUp(std::unique_ptr<TargetMachine> OptTM,
+                    uint64_t HotThreshold);
+
+  /// Recompile any functions that have become hot since the last call. May be
+  /// called from any thread.
+  unsigned recompileHotFunctions() {
+    std::lock_guard<std::mutex> Lock(TierUpMutex);
+    return TierUp ? TierUp->recompileHotFunctions() : 0;
+  }
+
+  /// Notify L about code loaded from now on. L must outlive the JIT.
+  void registerJITEventListener(JITEventListener &L) {
+    EventListeners.push_back(&L);
+  }
+
   JITSymbol findSymbol(const std::string &Name) {
     return CODLayer.findSymbol(mangle(Name), true);
   }
@@ -151,24 +205,75 @@ private:
     return Partition;
   }
 
-  static TransformFtor createDebugDumper();
+  /// Create the transform for -orc-lazy-debug. Function lists for code
+  /// compiled at a tier other than the first are tagged with Tier.
+  static TransformFtor createDebugDumper(StringRef Tier = "");
+
+  /// Create the compile functor for the first tier. If Concurrent is set it
+  /// may be called from several compile threads at once.
+  CompileLayerT::CompileFtor createCompiler(bool Concurrent);
+
+  TransformFtor createTierZeroTransform(TransformFtor DebugDump) {
+    return [this, DebugDump](std::unique_ptr<Module> M) {
+      if (Profiler)
+        M = Profiler->instrument(std::move(M));
+      return DebugDump(std::move(M));
+    };
+  }
+
+  /// Create the functor that tells the event listeners when the objects of a
+  /// set reported by NotifyObjectLoadedT are finalized.
+  ObjLayerT::NotifyFinalizedFtor createNotifyFinalized() {
+    return [this](orc::ObjectLinkingLayerBase::ObjSetHandleT H) {
+      std::vector<const object::ObjectFile *> Objs;
+      {
+        std::lock_guard<std::mutex> Lock(UnfinalizedObjectsMutex);
+        auto I = UnfinalizedObjects.find(&*H);
+        if (I == UnfinalizedObjects.end())
+          return;
+        Objs = std::move(I->second);
+        UnfinalizedObjects.erase(I);
+      }
+      for (const object::ObjectFile *Obj : Objs)
+        for (JITEventListener *L : EventListeners)
+          L->NotifyObjectFinalized(*Obj);
+    };
+  }
 
   std::unique_ptr<TargetMachine> TM;
   DataLayout DL;
+
+  // Copies of TM not in use by a compile thread.
+  std::mutex IdleCompileTMsMutex;
+  std::vector<std::unique_ptr<TargetMachine>> IdleCompileTMs;
   SectionMemoryManager CCMgrMemMgr;
 
   std::unique_ptr<CompileCallbackMgr> CCMgr;
+  std::vector<JITEventListener *> EventListeners;
+  // Objects reported to the listeners that have not been finalized yet, keyed
+  // on their object set. Compile threads load objects concurrently.
+  std::mutex UnfinalizedObjectsMutex;
+  std::map<const void *, std::vector<const object::ObjectFile *>>
+      UnfinalizedObjects;
   ObjLayerT ObjectLayer;
   CompileLayerT CompileLayer;
   IRDumpLayerT IRDumpLayer;
   CODLayerT CODLayer;
 
+  std::unique_ptr<orc::TierUpProfiler> Profiler;
+  std::unique_ptr<TargetMachine> OptTM;
+  ObjLayerT OptObjectLayer;
+  std::unique_ptr<CompileLayerT> OptCompileLayer;
+  std::unique_ptr<TierUpCompilerT> TierUp;
+  // TierUpCompiler must only be run by one thread at a time.
+  std::mutex TierUpMutex;
+
   orc::LocalCXXRuntimeOverrides CXXRuntimeOverrides;
   std::vector<orc::CtorDtorRunner<CODLayerT>> IRStaticDestructorRunners;
 };
 
 int runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms, int ArgC,
-                  char* ArgV[]);
+                  char* ArgV[], JITEventListener *Listener = nullptr);
 
 } // end namespace llvm
 
@@ -72,7 +72,7 @@ private:
 };
 
 // launch the remote process (see lli.cpp) and return a channel to it.
-std::unique_ptr<FDRPCChannel> launchRemote();
+std::unique_ptr<llvm::orc::remote::RPCByteChannel> launchRemote();
 
 namespace llvm {
 
@@ -28,6 +28,7 @@
 #include "llvm/ExecutionEngine/OrcMCJITReplacement.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/ExecutionEngine/Orc/OrcRemoteTargetClient.h"
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRPCChannel.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
@@ -112,6 +113,13 @@ namespace {
                          "\n\tremote execution will be simulated in-process."),
                 cl::value_desc("filename"), cl::init(""));
 
+  // Talk to the remote process through a shared memory ring buffer rather
+  // than a pair of pipes.
+  cl::opt<bool> RemoteSharedMemory("remote-shm",
+    cl::desc("Use a shared memory channel to communicate with the remote "
+             "process."),
+    cl::init(false));
+
   // Determine optimization level.
   cl::opt<char>
   OptLevel("O",
@@ -173,6 +181,13 @@ namespace {
                            "(must be user writable)"),
                   cl::init(""));
 
+  cl::opt<std::string>
+  PerfJITDir("perf-jit-dir",
+             cl::desc("Describe JIT'd code to the Linux perf tool by writing "
+                      "a perf map and a jitdump file to the given directory "
+                      "(perf looks for the map in /tmp)"),
+             cl::value_desc("directory"), cl::init(""));
+
   cl::opt<std::string>
   FakeArgv0("fake-argv0",
             cl::desc("Override the 'argv[0]' value passed into the executing"
@@ -397,6 +412,18 @@ int main(int argc, char **argv, char * const *envp) {
     return 1;
   }
 
+  std::unique_ptr<JITEventListener> PerfListener;
+  if (!PerfJITDir.empty()) {
+    if (RemoteMCJIT) {
+      errs() << "warning: -perf-jit-dir is not supported with remote mcjit\n";
+    } else {
+      PerfListener.reset(
+          JITEventListener::createPerfJITEventListener(PerfJITDir));
+      if (!PerfListener)
+        errs() << "warning: perf is not supported on this host\n";
+    }
+  }
+
   if (UseJITKind == JITKind::OrcLazy) {
     std::vector<std::unique_ptr<Module>> Ms;
     Ms.push_back(std::move(Owner));
@@ -407,7 +434,7 @@ int main(int argc, char **argv, char * const *envp) {
         return 1;
       }
     }
-    return runOrcLazyJIT(std::move(Ms), argc, argv);
+    return runOrcLazyJIT(std::move(Ms), argc, argv, PerfListener.get());
   }
 
   if (EnableCacheManager) {
@@ -550,6 +577,7 @@ int main(int argc, char **argv, char * const *envp) {
                 JITEventListener::createOProfileJITEventListener());
   EE->RegisterJITEventListener(
                 JITEventListener::createIntelJITEventListener());
+  EE->RegisterJITEventListener(PerfListener.get());
 
   if (!NoLazyCompilation && RemoteMCJIT) {
     errs() << "warning: remote mcjit does not support lazy compilation\n";
@@ -655,7 +683,7 @@ int main(int argc, char **argv, char * const *envp) {
     // MCJIT itself. FIXME.
 
     // Lanch the remote process and get a channel to it.
-    std::unique_ptr<FDRPCChannel> C = launchRemote();
+    std::unique_ptr<orc::remote::RPCByteChannel> C = launchRemote();
     if (!C) {
       errs() << "Failed to launch remote JIT.\n";
       exit(1);
@@ -709,13 +737,76 @@ int main(int argc, char **argv, char * const *envp) {
   return Result;
 }
 
-std::unique_ptr<FDRPCChannel> launchRemote() {
+static std::unique_ptr<char[]> toCString(const std::string &Str) {
+  std::unique_ptr<char[]> CStr(new char[Str.size() + 1]);
+  std::copy(Str.begin(), Str.end(), &CStr[0]);
+  CStr[Str.size()] = '\0';
+  return CStr;
+}
+
+std::unique_ptr<orc::remote::RPCByteChannel> launchRemote() {
 #ifndef LLVM_ON_UNIX
   llvm_unreachable("launchRemote not supported on non-Unix platforms");
 #else
-  int PipeFD[2][2];
   pid_t ChildPID;
 
+  if (RemoteSharedMemory) {
+    // Back the channel with an unlinked temporary file. The child inherits
+    // the descriptor, and the file goes away when both ends are done.
+    int ShmFD;
+    SmallString<64> ShmPath;
+    if (std::error_code EC =
+            sys::fs::createTemporaryFile("lli-remote", "shm", ShmFD, ShmPath)) {
+      errs() << "Error creating shared memory channel: " << EC.message()
+             << "\n";
+      return nullptr;
+    }
+    sys::fs::remove(ShmPath);
+
+    // Neither end writes to these pipes. Each process holds the write end of
+    // one of them for as long as it lives, so that the other end of the
+    // channel sees end-of-file if it dies without closing the channel.
+    int ParentAlive[2], ChildAlive[2];
+    if (pipe(ParentAlive) != 0 || pipe(ChildAlive) != 0)
+      perror("Error creating pipe: ");
+
+    auto C = orc::remote::SharedMemoryRPCChannel::create(
+        ShmFD, orc::remote::SharedMemoryRPCChannel::DefaultRingSize,
+        ChildAlive[0]);
+    if (!C) {
+      logAllUnhandledErrors(C.takeError(), errs(),
+                            "Error creating shared memory channel: ");
+      return nullptr;
+    }
+
+    ChildPID = fork();
+
+    if (ChildPID == 0) {
+      // In the child...
+      close(ParentAlive[1]);
+      close(ChildAlive[0]);
+      std::unique_ptr<char[]> ChildPath = toCString(ChildExecPath);
+      std::unique_ptr<char[]> ChildShm = toCString(utostr(ShmFD));
+      std::unique_ptr<char[]> ChildPeer = toCString(utostr(ParentAlive[0]));
+      char ShmFlag[] = "-shm";
+      char * const args[] = { &ChildPath[0], ShmFlag, &ChildShm[0],
+                              &ChildPeer[0], nullptr };
+      int rc = execv(ChildExecPath.c_str(), args);
+      if (rc != 0)
+        perror("Error executing child process: ");
+      llvm_unreachable("Error executing child process");
+    }
+    // else we're the parent...
+
+    // ParentAlive[1] stays open until we exit.
+    close(ParentAlive[0]);
+    close(ChildAlive[1]);
+    close(ShmFD);
+    return std::move(*C);
+  }
+
+  int PipeFD[2][2];
+
   // Create two pipes.
   if (pipe(PipeFD[0]) != 0 || pipe(PipeFD[1]) != 0)
     perror("Error creating pipe: ");
@@ -731,20 +822,9 @@ std::unique_ptr<FDRPCChannel> launchRemote() {
 
 
     // Execute the child process.
-    std::unique_ptr<char[]> ChildPath, ChildIn, ChildOut;
-    {
-      ChildPath.reset(new char[ChildExecPath.size() + 1]);
-      std::copy(ChildExecPath.begin(), ChildExecPath.end(), &ChildPath[0]);
-      ChildPath[ChildExecPath.size()] = '\0';
-      std::string ChildInStr = utostr(PipeFD[0][0]);
-      ChildIn.reset(new char[ChildInStr.size() + 1]);
-      std::copy(ChildInStr.begin(), ChildInStr.end(), &ChildIn[0]);
-      ChildIn[ChildInStr.size()] = '\0';
-      std::string ChildOutStr = utostr(PipeFD[1][1]);
-      ChildOut.reset(new char[ChildOutStr.size() + 1]);
-      std::copy(ChildOutStr.begin(), ChildOutStr.end(), &ChildOut[0]);
-      ChildOut[ChildOutStr.size()] = '\0';
-    }
+    std::unique_ptr<char[]> ChildPath = toCString(ChildExecPath);
+    std::unique_ptr<char[]> ChildIn = toCString(utostr(PipeFD[0][0]));
+    std::unique_ptr<char[]> ChildOut = toCString(utostr(PipeFD[1][1]));
 
     char * const args[] = { &ChildPath[0], &ChildIn[0], &ChildOut[0], nullptr };
     int rc = execv(ChildExecPath.c_str(), args);
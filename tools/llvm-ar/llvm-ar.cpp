@@ -95,6 +95,12 @@ static cl::opt<Format>
                          clEnumValN(GNU, "gnu", "gnu"),
                          clEnumValN(BSD, "bsd", "bsd"), clEnumValEnd));
 
+static cl::opt<unsigned>
+    NumThreads("num-threads",
+               cl::desc("Number of threads used to read the symbols of large "
+                        "archives (default: 1)"),
+               cl::init(1));
+
 static std::string Options;
 
 // Provide additional help output explaining the operations and modifiers of
@@ -670,7 +676,8 @@ performWriteOperation(ArchiveOperation Operation,
 
   std::pair<StringRef, std::error_code> Result =
       writeArchive(ArchiveName, NewMembersP ? *NewMembersP : NewMembers, Symtab,
-                   Kind, Deterministic, Thin, std::move(OldArchiveBuf));
+                   Kind, Deterministic, Thin, std::move(OldArchiveBuf),
+                   NumThreads);
   failIfError(Result.second, Result.first);
 }
 
@@ -47,6 +47,11 @@ static cl::opt<bool> DisableOutput("disable-output", cl::desc("Disable output"),
 static cl::opt<bool> EmitModuleHash("module-hash", cl::desc("Emit module hash"),
                                     cl::init(false));
 
+static cl::opt<bool>
+    EmitSymtab("emit-symtab",
+               cl::desc("Emit a symbol table for llvm-nm and llvm-ar"),
+               cl::init(true));
+
 static cl::opt<bool> DumpAsm("d", cl::desc("Print assembly as parsed"),
                              cl::Hidden);
 
@@ -81,7 +86,7 @@ static void WriteOutputFile(const Module *M) {
 
   if (Force || !CheckBitcodeOutputToConsole(Out->os(), true))
     WriteBitcodeToFile(M, Out->os(), PreserveBitcodeUseListOrder, nullptr,
-                       EmitModuleHash);
+                       EmitModuleHash, EmitSymtab);
 
   // Declare success.
   Out->keep();
@@ -14,7 +14,9 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/DebugInfo/DIContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFAcceleratorTable.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFGdbIndex.h"
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Object/RelocVisitor.h"
@@ -26,11 +28,13 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstring>
 #include <string>
 #include <system_error>
+#include <thread>
 
 using namespace llvm;
 using namespace object;
@@ -74,6 +78,26 @@ static cl::opt<DIDumpType> DumpType(
         clEnumValN(DIDT_GdbIndex, "gdb_index", ".gdb_index"),
         clEnumValN(DIDT_TUIndex, "tu_index", ".debug_tu_index"), clEnumValEnd));
 
+static cl::opt<unsigned>
+NumThreads("num-threads", cl::init(0),
+           cl::desc("Number of threads to extract DIEs with, when dumping "
+                    "units or searching them without an index "
+                    "(default: autodetect)"));
+static cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                             cl::aliasopt(NumThreads));
+
+static cl::list<std::string>
+Find("find", cl::value_desc("name"),
+     cl::desc("Print the DIEs named <name>, and their parents, "
+              "instead of dumping the sections"));
+
+static cl::list<std::string>
+Lookup("lookup", cl::value_desc("address"),
+       cl::desc("Print the unit, function and line table entry covering "
+                "<address>, instead of dumping the sections"));
+
+static std::vector<uint64_t> LookupAddresses;
+
 static void error(StringRef Filename, std::error_code EC) {
   if (!EC)
     return;
@@ -81,11 +105,189 @@ static void error(StringRef Filename, std::error_code EC) {
   exit(1);
 }
 
+static bool dumpsUnits(DIDumpType Type) {
+  return Type == DIDT_All || Type == DIDT_Info || Type == DIDT_InfoDwo ||
+         Type == DIDT_Types || Type == DIDT_TypesDwo;
+}
+
+/// Extract the DIEs of all units up front, in parallel, unless only one
+/// thread is to be used.
+static void extractAllUnitDIEs(DWARFContext &DICtx) {
+  unsigned Threads = NumThreads;
+  if (Threads == 0)
+    Threads = std::max(1U, std::thread::hardware_concurrency());
+  if (Threads > 1) {
+    ThreadPool Pool(Threads);
+    DICtx.extractAllUnitDIEs(Pool);
+  }
+}
+
+/// Append to DIEOffsets the offsets of the DIEs in CU whose name or linkage
+/// name is Name.
+static void findDIEsInUnit(DWARFCompileUnit &CU, StringRef Name,
+                           SmallVectorImpl<uint32_t> &DIEOffsets) {
+  for (unsigned I = 0, E = CU.getNumDIEs(); I != E; ++I) {
+    const DWARFDebugInfoEntryMinimal *DIE = CU.getDIEAtIndex(I);
+    const char *ShortName = DIE->getName(&CU, DINameKind::ShortName);
+    const char *LinkageName = DIE->getName(&CU, DINameKind::LinkageName);
+    if ((ShortName && Name == ShortName) ||
+        (LinkageName && Name == LinkageName))
+      DIEOffsets.push_back(DIE->getOffset());
+  }
+}
+
+/// Append to DIEOffsets the offsets of the DIEs that a .debug_pubnames style
+/// section lists under Name. GNU style sections have an extra flags byte in
+/// each entry.
+static void lookupPubSection(StringRef Data, bool LittleEndian, bool GnuStyle,
+                             StringRef Name,
+                             SmallVectorImpl<uint32_t> &DIEOffsets) {
+  DataExtractor PubNames(Data, LittleEndian, 0);
+  uint32_t Offset = 0;
+  while (PubNames.isValidOffsetForDataOfSize(Offset, 14)) {
+    uint32_t Length = PubNames.getU32(&Offset);
+    uint32_t SetEnd = Offset + Length;
+    if (SetEnd < Offset)
+      return;
+    PubNames.getU16(&Offset); // Version.
+    uint32_t CUOffset = PubNames.getU32(&Offset);
+    PubNames.getU32(&Offset); // Unit length.
+    while (Offset < SetEnd) {
+      uint32_t DIEOffset = PubNames.getU32(&Offset);
+      if (!DIEOffset)
+        break;
+      if (GnuStyle)
+        PubNames.getU8(&Offset);
+      const char *Str = PubNames.getCStr(&Offset);
+      if (!Str)
+        return;
+      if (Name == Str)
+        DIEOffsets.push_back(CUOffset + DIEOffset);
+    }
+    Offset = SetEnd;
+  }
+}
+
+/// Find the offsets of the DIEs named Name, reading as little of the debug
+/// info as the available indexes allow. An index is trusted to be complete,
+/// so names that it doesn't cover aren't found. Only without any index is
+/// every unit searched.
+static void findDIEs(DWARFContext &DICtx, StringRef Name,
+                     SmallVectorImpl<uint32_t> &DIEOffsets) {
+  bool LittleEndian = DICtx.isLittleEndian();
+
+  // The Apple tables point straight at the DIEs.
+  bool HasIndex = false;
+  for (const DWARFSection *Section :
+       {&DICtx.getAppleNamesSection(), &DICtx.getAppleTypesSection(),
+        &DICtx.getAppleNamespacesSection()}) {
+    DWARFAcceleratorTable Accel(
+        DataExtractor(Section->Data, LittleEndian, 0),
+        DataExtractor(DICtx.getStringSection(), LittleEndian, 0),
+        Section->Relocs);
+    if (!Accel.extract())
+      continue;
+    HasIndex = true;
+    Accel.lookup(Name, DIEOffsets);
+  }
+  if (HasIndex)
+    return;
+
+  // .gdb_index only names the units, which then have to be searched.
+  DWARFGdbIndex &GdbIndex = DICtx.getGdbIndex();
+  if (GdbIndex.HasContent && !GdbIndex.HasError) {
+    SmallVector<uint64_t, 4> CUOffsets;
+    GdbIndex.lookupSymbol(Name, CUOffsets);
+    for (uint64_t CUOffset : CUOffsets)
+      if (DWARFCompileUnit *CU = DICtx.getCompileUnitForOffset(CUOffset))
+        findDIEsInUnit(*CU, Name, DIEOffsets);
+    return;
+  }
+
+  for (auto Section : {std::make_pair(DICtx.getPubNamesSection(), false),
+                       std::make_pair(DICtx.getPubTypesSection(), false),
+                       std::make_pair(DICtx.getGnuPubNamesSection(), true),
+                       std::make_pair(DICtx.getGnuPubTypesSection(), true)}) {
+    if (Section.first.empty())
+      continue;
+    HasIndex = true;
+    lookupPubSection(Section.first, LittleEndian, Section.second, Name,
+                     DIEOffsets);
+  }
+  if (HasIndex)
+    return;
+
+  extractAllUnitDIEs(DICtx);
+  for (const auto &CU : DICtx.compile_units())
+    findDIEsInUnit(*CU, Name, DIEOffsets);
+}
+
+/// Dump the DIE at Offset, preceded by its parents up to the unit DIE. Only
+/// the DIEs on the way to it are decoded if its unit hasn't been extracted.
+static void dumpDIEWithParents(DWARFContext &DICtx, uint32_t Offset) {
+  DWARFCompileUnit *CU = DICtx.getCompileUnitForOffset(Offset);
+  SmallVector<DWARFDebugInfoEntryMinimal, 8> Path;
+  if (!CU || !CU->extractDIEPath(Offset, Path)) {
+    errs() << format("warning: no DIE at offset 0x%8.8x\n", Offset);
+    return;
+  }
+  // Dumping some attributes needs the unit DIE.
+  CU->getUnitDIE();
+  for (unsigned I = 0, E = Path.size(); I != E; ++I)
+    Path[I].dump(outs(), CU, 0, 2 * I);
+}
+
+static void findName(DWARFContext &DICtx, StringRef Name) {
+  SmallVector<uint32_t, 4> DIEOffsets;
+  findDIEs(DICtx, Name, DIEOffsets);
+  std::sort(DIEOffsets.begin(), DIEOffsets.end());
+  DIEOffsets.erase(std::unique(DIEOffsets.begin(), DIEOffsets.end()),
+                   DIEOffsets.end());
+  if (DIEOffsets.empty())
+    errs() << "warning: no DIE named '" << Name << "'\n";
+  for (uint32_t Offset : DIEOffsets)
+    dumpDIEWithParents(DICtx, Offset);
+}
+
+static void lookupAddress(DWARFContext &DICtx, uint64_t Address) {
+  // The unit comes from .debug_aranges when there is one.
+  DWARFCompileUnit *CU = DICtx.getCompileUnitForAddress(Address);
+  if (!CU) {
+    errs() << format("warning: no unit covers address 0x%" PRIx64 "\n",
+                     Address);
+    return;
+  }
+
+  // Print the innermost (possibly inlined) function, or just the unit.
+  DWARFDebugInfoEntryInlinedChain Chain =
+      CU->getInlinedChainForAddress(Address);
+  dumpDIEWithParents(DICtx, Chain.DIEs.empty()
+                                ? CU->getUnitDIE()->getOffset()
+                                : Chain.DIEs[0].getOffset());
+
+  DILineInfo Line = DICtx.getLineInfoForAddress(Address);
+  if (Line.Line)
+    outs() << "\nLine info: file '" << Line.FileName << "', line "
+           << Line.Line << ", column " << Line.Column << '\n';
+}
+
 static void DumpObjectFile(ObjectFile &Obj, Twine Filename) {
-  std::unique_ptr<DIContext> DICtx(new DWARFContextInMemory(Obj));
+  std::unique_ptr<DWARFContext> DICtx(new DWARFContextInMemory(Obj));
 
   outs() << Filename.str() << ":\tfile format " << Obj.getFileFormatName()
          << "\n\n";
+  if (!Find.empty() || !LookupAddresses.empty()) {
+    for (const auto &Name : Find)
+      findName(*DICtx, Name);
+    for (uint64_t Address : LookupAddresses)
+      lookupAddress(*DICtx, Address);
+    return;
+  }
+
+  // The units are dumped in order, but their DIEs can be extracted up front
+  // in parallel.
+  if (dumpsUnits(DumpType))
+    extractAllUnitDIEs(*DICtx);
   // Dump the complete DWARF structure.
   DICtx->dump(outs(), DumpType);
 }
@@ -153,6 +355,15 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm dwarf dumper\n");
 
+  for (StringRef Address : Lookup) {
+    uint64_t Value;
+    if (Address.getAsInteger(0, Value)) {
+      errs() << "error: invalid address '" << Address << "'\n";
+      return EXIT_FAILURE;
+    }
+    LookupAddresses.push_back(Value);
+  }
+
   // Defaults to a.out if no filenames specified.
   if (InputFilenames.size() == 0)
     InputFilenames.push_back("a.out");
@@ -4,51 +4,78 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/MC/MCSection.h"
 #include "llvm/MC/MCStreamer.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/StringSaver.h"
 #include <cassert>
 
 namespace llvm {
 class DWPStringPool {
+public:
+  /// A string to look up in the pool, along with its hash. Hashing is most
+  /// of the cost of pooling a string, so it is done when the input the
+  /// string comes from is parsed, which may happen on another thread.
+  struct Entry {
+    StringRef Str;
+    unsigned Hash;
+
+    Entry(StringRef Str, unsigned Hash) : Str(Str), Hash(Hash) {}
+    explicit Entry(StringRef Str)
+        : Str(Str), Hash((unsigned)hash_value(Str)) {}
+  };
 
-  struct CStrDenseMapInfo {
-    static inline const char *getEmptyKey() {
-      return reinterpret_cast<const char *>(~static_cast<uintptr_t>(0));
+private:
+  struct EntryDenseMapInfo {
+    static inline Entry getEmptyKey() {
+      return Entry(StringRef(reinterpret_cast<const char *>(
+                                 ~static_cast<uintptr_t>(0)), 0), 0);
     }
-    static inline const char *getTombstoneKey() {
-      return reinterpret_cast<const char *>(~static_cast<uintptr_t>(1));
+    static inline Entry getTombstoneKey() {
+      return Entry(StringRef(reinterpret_cast<const char *>(
+                                 ~static_cast<uintptr_t>(1)), 0), 0);
     }
-    static unsigned getHashValue(const char *Val) {
-      assert(Val != getEmptyKey() && "Cannot hash the empty key!");
-      assert(Val != getTombstoneKey() && "Cannot hash the tombstone key!");
-      return (unsigned)hash_value(StringRef(Val));
+    static bool isSpecial(const Entry &Val) {
+      return Val.Str.data() == getEmptyKey().Str.data() ||
+             Val.Str.data() == getTombstoneKey().Str.data();
     }
-    static bool isEqual(const char *LHS, const char *RHS) {
-      if (RHS == getEmptyKey())
-        return LHS == getEmptyKey();
-      if (RHS == getTombstoneKey())
-        return LHS == getTombstoneKey();
-      return strcmp(LHS, RHS) == 0;
+    static unsigned getHashValue(const Entry &Val) {
+      assert(!isSpecial(Val) && "Cannot hash the empty or tombstone key!");
+      return Val.Hash;
+    }
+    static bool isEqual(const Entry &LHS, const Entry &RHS) {
+      if (isSpecial(LHS) || isSpecial(RHS))
+        return LHS.Str.data() == RHS.Str.data();
+      return LHS.Hash == RHS.Hash && LHS.Str == RHS.Str;
     }
   };
 
   MCStreamer &Out;
   MCSection *Sec;
-  DenseMap<const char *, uint32_t, CStrDenseMapInfo> Pool;
+  DenseMap<Entry, uint32_t, EntryDenseMapInfo> Pool;
+  BumpPtrAllocator Alloc;
+  StringSaver Saver;
   uint32_t Offset = 0;
 
 public:
-  DWPStringPool(MCStreamer &Out, MCSection *Sec) : Out(Out), Sec(Sec) {}
+  DWPStringPool(MCStreamer &Out, MCSection *Sec)
+      : Out(Out), Sec(Sec), Saver(Alloc) {}
 
-  uint32_t getOffset(const char *Str, unsigned Length) {
-    assert(strlen(Str) + 1 == Length && "Ensure length hint is correct");
+  uint32_t getOffset(const Entry &E) {
+    assert(E.Hash == (unsigned)hash_value(E.Str) && "Ensure hash is correct");
 
-    auto Pair = Pool.insert(std::make_pair(Str, Offset));
-    if (Pair.second) {
-      Out.SwitchSection(Sec);
-      Out.EmitBytes(StringRef(Str, Length));
-      Offset += Length;
-    }
+    auto I = Pool.find(E);
+    if (I != Pool.end())
+      return I->second;
+
+    // The pool outlives the inputs that its strings come from, so it keeps
+    // its own copy of each of them.
+    StringRef Saved(Saver.save(E.Str), E.Str.size());
+    Pool.insert(std::make_pair(Entry(Saved, E.Hash), Offset));
+    Out.SwitchSection(Sec);
+    Out.EmitBytes(StringRef(Saved.data(), Saved.size() + 1));
 
-    return Pair.first->second;
+    uint32_t StrOffset = Offset;
+    Offset += Saved.size() + 1;
+    return StrOffset;
   }
 };
 }
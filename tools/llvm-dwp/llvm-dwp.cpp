@@ -37,11 +37,14 @@
 #include "llvm/Support/Options.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
+#include <algorithm>
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -56,9 +59,19 @@ static opt<std::string> OutputFilename(Required, "o",
                                        value_desc("filename"),
                                        cat(DwpCategory));
 
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Number of threads to read input files with (default: autodetect)"),
+    init(0), cat(DwpCategory));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads), Prefix);
+
+typedef std::pair<uint32_t, DWPStringPool::Entry> InputString;
+
 static void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
                                    MCSection *StrOffsetSection,
                                    StringRef CurStrSection,
+                                   ArrayRef<InputString> CurStrings,
                                    StringRef CurStrOffsetSection) {
   // Could possibly produce an error or warning if one of these was non-null but
   // the other was null.
@@ -67,16 +80,10 @@ static void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
 
   DenseMap<uint32_t, uint32_t> OffsetRemapping;
 
-  DataExtractor Data(CurStrSection, true, 0);
-  uint32_t LocalOffset = 0;
-  uint32_t PrevOffset = 0;
-  while (const char *s = Data.getCStr(&LocalOffset)) {
-    OffsetRemapping[PrevOffset] =
-        Strings.getOffset(s, LocalOffset - PrevOffset);
-    PrevOffset = LocalOffset;
-  }
+  for (const InputString &S : CurStrings)
+    OffsetRemapping[S.first] = Strings.getOffset(S.second);
 
-  Data = DataExtractor(CurStrOffsetSection, true, 0);
+  DataExtractor Data(CurStrOffsetSection, true, 0);
 
   Out.SwitchSection(StrOffsetSection);
 
@@ -380,36 +387,90 @@ static Error handleCompressedSection(
   return Error();
 }
 
-static Error handleSection(
-    const StringMap<std::pair<MCSection *, DWARFSectionKind>> &KnownSections,
-    const MCSection *StrSection, const MCSection *StrOffsetSection,
-    const MCSection *TypesSection, const MCSection *CUIndexSection,
-    const MCSection *TUIndexSection, const SectionRef &Section, MCStreamer &Out,
-    std::deque<SmallString<32>> &UncompressedSections,
-    uint32_t (&ContributionOffsets)[8], UnitIndexEntry &CurEntry,
-    StringRef &CurStrSection, StringRef &CurStrOffsetSection,
-    std::vector<StringRef> &CurTypesSection, StringRef &InfoSection,
-    StringRef &AbbrevSection, StringRef &CurCUIndexSection,
-    StringRef &CurTUIndexSection) {
-  if (Section.isBSS())
-    return Error();
+/// An input file, with everything about it that can be worked out without
+/// looking at the other inputs. Inputs are read ahead of time, possibly on
+/// other threads, and released as soon as they have been written out.
+class InputFile {
+public:
+  /// Set if the input couldn't be read.
+  Error Err;
+
+  OwningBinary<ObjectFile> Binary;
+  /// The names and contents of the input's sections, in order, with the
+  /// leading '.', '_' or 'z' of the names stripped and compressed sections
+  /// uncompressed.
+  std::vector<std::pair<StringRef, StringRef>> Sections;
+  /// The strings of the input's string section, with their offsets in it
+  /// and precomputed hashes.
+  std::vector<InputString> Strings;
+
+  InputFile(StringRef Input) {
+    ErrorAsOutParameter ErrAsOutParam(&Err);
+    Err = read(Input);
+  }
+  // Inputs read ahead of one that failed are dropped, errors and all.
+  ~InputFile() { consumeError(std::move(Err)); }
 
-  if (Section.isVirtual())
-    return Error();
+private:
+  std::deque<SmallString<32>> UncompressedSections;
+
+  Error read(StringRef Input);
+};
+
+Error InputFile::read(StringRef Input) {
+  auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
+  if (!ErrOrObj)
+    return ErrOrObj.takeError();
+  Binary = std::move(*ErrOrObj);
 
-  StringRef Name;
-  if (std::error_code Err = Section.getName(Name))
-    return errorCodeToError(Err);
+  StringRef StrSection;
+  for (const auto &Section : Binary.getBinary()->sections()) {
+    if (Section.isBSS())
+      continue;
+
+    if (Section.isVirtual())
+      continue;
 
-  Name = Name.substr(Name.find_first_not_of("._"));
+    StringRef Name;
+    if (std::error_code Err = Section.getName(Name))
+      return errorCodeToError(Err);
 
-  StringRef Contents;
-  if (auto Err = Section.getContents(Contents))
-    return errorCodeToError(Err);
+    Name = Name.substr(Name.find_first_not_of("._"));
 
-  if (auto Err = handleCompressedSection(UncompressedSections, Name, Contents))
-    return Err;
+    StringRef Contents;
+    if (auto Err = Section.getContents(Contents))
+      return errorCodeToError(Err);
 
+    if (auto Err =
+            handleCompressedSection(UncompressedSections, Name, Contents))
+      return Err;
+
+    if (Name == "debug_str.dwo")
+      StrSection = Contents;
+    Sections.push_back(std::make_pair(Name, Contents));
+  }
+
+  DataExtractor Data(StrSection, true, 0);
+  uint32_t LocalOffset = 0;
+  uint32_t PrevOffset = 0;
+  while (const char *S = Data.getCStr(&LocalOffset)) {
+    StringRef Str(S, LocalOffset - PrevOffset - 1);
+    Strings.push_back(std::make_pair(PrevOffset, DWPStringPool::Entry(Str)));
+    PrevOffset = LocalOffset;
+  }
+  return Error();
+}
+
+static Error handleSection(
+    const StringMap<std::pair<MCSection *, DWARFSectionKind>> &KnownSections,
+    const MCSection *StrSection, const MCSection *StrOffsetSection,
+    const MCSection *TypesSection, const MCSection *CUIndexSection,
+    const MCSection *TUIndexSection, StringRef Name, StringRef Contents,
+    MCStreamer &Out, uint32_t (&ContributionOffsets)[8],
+    UnitIndexEntry &CurEntry, StringRef &CurStrSection,
+    StringRef &CurStrOffsetSection, std::vector<StringRef> &CurTypesSection,
+    StringRef &InfoSection, StringRef &AbbrevSection,
+    StringRef &CurCUIndexSection, StringRef &CurTUIndexSection) {
   auto SectionPair = KnownSections.find(Name);
   if (SectionPair == KnownSections.end())
     return Error();
@@ -462,7 +523,8 @@ buildDuplicateError(const std::pair<uint64_t, UnitIndexEntry> &PrevE,
       " and " + buildDWODescription(ID.Name, DWPName, ID.DWOName));
 }
 
-static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
+static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs,
+                   unsigned Threads) {
   const auto &MCOFI = *Out.getContext().getObjectFileInfo();
   MCSection *const StrSection = MCOFI.getDwarfStrDWOSection();
   MCSection *const StrOffsetSection = MCOFI.getDwarfStrOffDWOSection();
@@ -487,18 +549,45 @@ static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
 
   DWPStringPool Strings(Out, StrSection);
 
-  SmallVector<OwningBinary<object::ObjectFile>, 128> Objects;
-  Objects.reserve(Inputs.size());
-
-  std::deque<SmallString<32>> UncompressedSections;
-
-  for (const auto &Input : Inputs) {
-    auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
-    if (!ErrOrObj)
-      return ErrOrObj.takeError();
+  // Reading the inputs, which includes uncompressing their sections and
+  // hashing their strings, doesn't depend on the output, so with several
+  // threads it runs on a thread pool, a bounded number of inputs ahead of
+  // the output. Everything else happens in input order on this thread, so
+  // that the output doesn't depend on scheduling. Each input is released
+  // once it has been written out: only the pooled strings and the index
+  // entries are kept for the whole run.
+  const size_t Lookahead = 2 * Threads;
+  std::vector<std::unique_ptr<InputFile>> Files(Inputs.size());
+  std::vector<std::shared_future<ThreadPool::VoidTy>> Read(Inputs.size());
+  std::unique_ptr<ThreadPool> Pool;
+  if (Threads > 1 && Inputs.size() > 1)
+    Pool = llvm::make_unique<ThreadPool>(Threads);
+  auto StartReading = [&](size_t I) {
+    std::unique_ptr<InputFile> *File = &Files[I];
+    StringRef Input = Inputs[I];
+    Read[I] = Pool->async(
+        [File, Input] { *File = llvm::make_unique<InputFile>(Input); });
+  };
+  if (Pool)
+    for (size_t I = 0, E = std::min(Lookahead, Inputs.size()); I != E; ++I)
+      StartReading(I);
+
+  for (size_t InputIdx = 0, E = Inputs.size(); InputIdx != E; ++InputIdx) {
+    StringRef Input = Inputs[InputIdx];
+    if (Pool && InputIdx + Lookahead < E)
+      StartReading(InputIdx + Lookahead);
+
+    std::unique_ptr<InputFile> File;
+    if (Pool) {
+      Read[InputIdx].wait();
+      File = std::move(Files[InputIdx]);
+    } else {
+      File = llvm::make_unique<InputFile>(Input);
+    }
+    if (File->Err)
+      return std::move(File->Err);
 
-    auto &Obj = *ErrOrObj->getBinary();
-    Objects.push_back(std::move(*ErrOrObj));
+    auto &Obj = *File->Binary.getBinary();
 
     UnitIndexEntry CurEntry = {};
 
@@ -510,20 +599,20 @@ static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
     StringRef CurCUIndexSection;
     StringRef CurTUIndexSection;
 
-    for (const auto &Section : Obj.sections())
+    for (const auto &Section : File->Sections)
       if (auto Err = handleSection(
               KnownSections, StrSection, StrOffsetSection, TypesSection,
-              CUIndexSection, TUIndexSection, Section, Out,
-              UncompressedSections, ContributionOffsets, CurEntry,
-              CurStrSection, CurStrOffsetSection, CurTypesSection, InfoSection,
-              AbbrevSection, CurCUIndexSection, CurTUIndexSection))
+              CUIndexSection, TUIndexSection, Section.first, Section.second,
+              Out, ContributionOffsets, CurEntry, CurStrSection,
+              CurStrOffsetSection, CurTypesSection, InfoSection, AbbrevSection,
+              CurCUIndexSection, CurTUIndexSection))
         return Err;
 
     if (InfoSection.empty())
       continue;
 
     writeStringsAndOffsets(Out, Strings, StrOffsetSection, CurStrSection,
-                           CurStrOffsetSection);
+                           File->Strings, CurStrOffsetSection);
 
     if (CurCUIndexSection.empty()) {
       Expected<CompileUnitIdentifiers> EID = getCUIdentifiers(
@@ -675,7 +764,11 @@ int main(int argc, char **argv) {
   if (!MS)
     return error("no object streamer for target " + TripleName, Context);
 
-  if (auto Err = write(*MS, InputFiles)) {
+  unsigned Threads = NumThreads;
+  if (Threads == 0)
+    Threads = std::max(1U, std::thread::hardware_concurrency());
+
+  if (auto Err = write(*MS, InputFiles, Threads)) {
     logAllUnhandledErrors(std::move(Err), errs(), "error: ");
     return 1;
   }
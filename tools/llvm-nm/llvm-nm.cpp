@@ -267,10 +267,9 @@ static bool compareSymbolName(const NMSymbol &A, const NMSymbol &B) {
 static char isSymbolList64Bit(SymbolicFile &Obj) {
   if (isa<IRObjectFile>(Obj)) {
     IRObjectFile *IRobj = dyn_cast<IRObjectFile>(&Obj);
-    Module &M = IRobj->getModule();
-    if (M.getTargetTriple().empty())
+    if (IRobj->getTargetTriple().empty())
       return false;
-    Triple T(M.getTargetTriple());
+    Triple T(IRobj->getTargetTriple());
     return T.isArch64Bit();
   }
   if (isa<COFFObjectFile>(Obj))
@@ -884,6 +883,9 @@ static char getSymbolNMTypeChar(const GlobalValue &GV) {
 }
 
 static char getSymbolNMTypeChar(IRObjectFile &Obj, basic_symbol_iterator I) {
+  if (!Obj.hasModule())
+    return Obj.getSymtabSymbol(I->getRawDataRefImpl()).isFunction() ? 't'
+                                                                    : 'd';
   const GlobalValue *GV = Obj.getSymbolGV(I->getRawDataRefImpl());
   return !GV ? 't' : getSymbolNMTypeChar(*GV);
 }
@@ -997,9 +999,14 @@ dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
       continue;
     if (WithoutAliases) {
       if (IRObjectFile *IR = dyn_cast<IRObjectFile>(&Obj)) {
-        const GlobalValue *GV = IR->getSymbolGV(Sym.getRawDataRefImpl());
-        if (GV && isa<GlobalAlias>(GV))
-          continue;
+        if (!IR->hasModule()) {
+          if (IR->getSymtabSymbol(Sym.getRawDataRefImpl()).isAlias())
+            continue;
+        } else {
+          const GlobalValue *GV = IR->getSymbolGV(Sym.getRawDataRefImpl());
+          if (GV && isa<GlobalAlias>(GV))
+            continue;
+        }
       }
     }
     // If a "-s segname sectname" option was specified and this is a Mach-O
@@ -1028,7 +1035,7 @@ dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
     if (EC && MachO)
       OS << "bad string index";
     else
-      error(EC);
+      error(EC, Obj.getFileName());
     OS << '\0';
     S.Sym = Sym;
     SymbolList.push_back(S);
@@ -1075,6 +1082,29 @@ static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
   return true;
 }
 
+// Like createBinary, but reads the symbols of bitcode files from their symbol
+// table, if they have one, instead of loading their module.
+static Expected<std::unique_ptr<Binary>>
+createSymbolBinary(MemoryBufferRef Buffer, LLVMContext *Context) {
+  if (Context && sys::fs::identify_magic(Buffer.getBuffer()) ==
+                     sys::fs::file_magic::bitcode) {
+    Expected<std::unique_ptr<IRObjectFile>> ObjOrErr =
+        IRObjectFile::createFromSymtab(Buffer);
+    if (ObjOrErr)
+      return std::move(*ObjOrErr);
+    consumeError(ObjOrErr.takeError());
+  }
+  return createBinary(Buffer, Context);
+}
+
+static Expected<std::unique_ptr<Binary>>
+createSymbolBinary(const Archive::Child &C, LLVMContext *Context) {
+  Expected<MemoryBufferRef> BufferOrErr = C.getMemoryBufferRef();
+  if (!BufferOrErr)
+    return BufferOrErr.takeError();
+  return createSymbolBinary(*BufferOrErr, Context);
+}
+
 static void dumpSymbolNamesFromFile(std::string &Filename) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
       MemoryBuffer::getFileOrSTDIN(Filename);
@@ -1082,7 +1112,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
     return;
 
   LLVMContext Context;
-  Expected<std::unique_ptr<Binary>> BinaryOrErr = createBinary(
+  Expected<std::unique_ptr<Binary>> BinaryOrErr = createSymbolBinary(
       BufferOrErr.get()->getMemBufferRef(), NoLLVMBitcode ? nullptr : &Context);
   if (!BinaryOrErr) {
     error(BinaryOrErr.takeError(), Filename);
@@ -1115,7 +1145,8 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
     {
       Error Err;
       for (auto &C : A->children(Err)) {
-        Expected<std::unique_ptr<Binary>> ChildOrErr = C.getAsBinary(&Context);
+        Expected<std::unique_ptr<Binary>> ChildOrErr =
+            createSymbolBinary(C, &Context);
         if (!ChildOrErr) {
           if (auto E = isNotObjectErrorInvalidFileType(ChildOrErr.takeError()))
             error(std::move(E), Filename, C);
@@ -1181,7 +1212,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
               Error Err;
               for (auto &C : A->children(Err)) {
                 Expected<std::unique_ptr<Binary>> ChildOrErr =
-                    C.getAsBinary(&Context);
+                    createSymbolBinary(C, &Context);
                 if (!ChildOrErr) {
                   if (auto E = isNotObjectErrorInvalidFileType(
                                        ChildOrErr.takeError())) {
@@ -1252,7 +1283,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
             Error Err;
             for (auto &C : A->children(Err)) {
               Expected<std::unique_ptr<Binary>> ChildOrErr =
-                  C.getAsBinary(&Context);
+                  createSymbolBinary(C, &Context);
               if (!ChildOrErr) {
                 if (auto E = isNotObjectErrorInvalidFileType(
                                      ChildOrErr.takeError()))
@@ -1319,7 +1350,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
         Error Err;
         for (auto &C : A->children(Err)) {
           Expected<std::unique_ptr<Binary>> ChildOrErr =
-            C.getAsBinary(&Context);
+            createSymbolBinary(C, &Context);
           if (!ChildOrErr) {
             if (auto E = isNotObjectErrorInvalidFileType(
                                  ChildOrErr.takeError()))
@@ -56,11 +56,13 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <system_error>
+#include <thread>
 #include <utility>
 #include <unordered_map>
 
@@ -212,6 +214,11 @@ cl::opt<unsigned long long>
 cl::opt<unsigned long long>
     StopAddress("stop-address", cl::desc("Stop disassembly at address"),
                 cl::value_desc("address"), cl::init(UINT64_MAX));
+
+static cl::opt<unsigned>
+    NumThreads("num-threads", cl::init(1),
+               cl::desc("Number of threads to disassemble with "
+                        "(0: autodetect)"));
 static StringRef ToolName;
 
 namespace {
@@ -1198,6 +1205,35 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   for (std::pair<const SectionRef, SectionSymbolsTy> &SecSyms : AllSymbols)
     array_pod_sort(SecSyms.second.begin(), SecSyms.second.end());
 
+  // The sorted symbols of each section in SectionAddresses, used to symbolize
+  // branch targets without looking the section up in AllSymbols.
+  std::vector<const SectionSymbolsTy *> SectionAddressSymbols;
+  for (const std::pair<uint64_t, SectionRef> &SecAddr : SectionAddresses)
+    SectionAddressSymbols.push_back(&AllSymbols[SecAddr.second]);
+
+  // Sections without inline relocations are split into runs of symbols that
+  // are disassembled into separate buffers on a thread pool. Relocations are
+  // printed in address order across symbol boundaries, the ARM disassemblers
+  // track IT blocks from one instruction to the next, and the source printer
+  // is not thread safe, so those cases always use a single thread.
+  unsigned Threads = NumThreads;
+  if (Threads == 0)
+    Threads = std::max(1U, std::thread::hardware_concurrency());
+  Triple::ArchType Arch = Triple(TripleName).getArch();
+  if (PrintSource || PrintLines || Arch == Triple::arm ||
+      Arch == Triple::armeb || Arch == Triple::thumb ||
+      Arch == Triple::thumbeb)
+    Threads = 1;
+
+  // Debug output from the disassembler goes to DebugOut. Runs on the thread
+  // pool buffer it and print it in order, like their disassembly.
+#ifndef NDEBUG
+  bool DebugDisAsm = DebugFlag;
+#else
+  bool DebugDisAsm = false;
+#endif
+  raw_ostream &DebugOut = DebugDisAsm ? dbgs() : nulls();
+
   for (const SectionRef &Section : ToolSectionFilter(*Obj)) {
     if (!DisassembleAll && (!Section.isText() || Section.isVirtual()))
       continue;
@@ -1266,278 +1302,354 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
                                                             : ELF::STT_OBJECT));
     }
 
-    SmallString<40> Comments;
-    raw_svector_ostream CommentStream(Comments);
-
     StringRef BytesStr;
     error(Section.getContents(BytesStr));
     ArrayRef<uint8_t> Bytes(reinterpret_cast<const uint8_t *>(BytesStr.data()),
                             BytesStr.size());
 
-    uint64_t Size;
-    uint64_t Index;
-
-    std::vector<RelocationRef>::const_iterator rel_cur = Rels.begin();
-    std::vector<RelocationRef>::const_iterator rel_end = Rels.end();
-    // Disassemble symbol by symbol.
-    for (unsigned si = 0, se = Symbols.size(); si != se; ++si) {
-      uint64_t Start = std::get<0>(Symbols[si]) - SectionAddr;
-      // The end is either the section end or the beginning of the next
-      // symbol.
-      uint64_t End =
-          (si == se - 1) ? SectSize : std::get<0>(Symbols[si + 1]) - SectionAddr;
-      // Don't try to disassemble beyond the end of section contents.
-      if (End > SectSize)
-        End = SectSize;
-      // If this symbol has the same address as the next symbol, then skip it.
-      if (Start >= End)
-        continue;
-
-      // Check if we need to skip symbol
-      // Skip if the symbol's data is not between StartAddress and StopAddress
-      if (End + SectionAddr < StartAddress ||
-          Start + SectionAddr > StopAddress) {
-        continue;
-      }
-
-      // Stop disassembly at the stop address specified
-      if (End + SectionAddr > StopAddress)
-        End = StopAddress - SectionAddr;
+    // Disassemble the symbols [SymBegin, SymEnd) of this section to OS.
+    auto DisassembleSymbols = [&](unsigned SymBegin, unsigned SymEnd,
+                                  MCDisassembler &DisAsm, MCInstPrinter &IP,
+                                  SourcePrinter *SP, raw_ostream &OS,
+                                  raw_ostream &DebugOut) {
+      SmallString<40> Comments;
+      raw_svector_ostream CommentStream(Comments);
+
+      uint64_t Size;
+      uint64_t Index;
+
+      std::vector<RelocationRef>::const_iterator rel_cur = Rels.begin();
+      std::vector<RelocationRef>::const_iterator rel_end = Rels.end();
+      // Disassemble symbol by symbol.
+      for (unsigned si = SymBegin, se = Symbols.size(); si != SymEnd; ++si) {
+        uint64_t Start = std::get<0>(Symbols[si]) - SectionAddr;
+        // The end is either the section end or the beginning of the next
+        // symbol.
+        uint64_t End = (si == se - 1)
+                           ? SectSize
+                           : std::get<0>(Symbols[si + 1]) - SectionAddr;
+        // Don't try to disassemble beyond the end of section contents.
+        if (End > SectSize)
+          End = SectSize;
+        // If this symbol has the same address as the next symbol, then skip it.
+        if (Start >= End)
+          continue;
 
-      if (Obj->isELF() && Obj->getArch() == Triple::amdgcn) {
-        // make size 4 bytes folded
-        End = Start + ((End - Start) & ~0x3ull);
-        if (std::get<2>(Symbols[si]) == ELF::STT_AMDGPU_HSA_KERNEL) {
-          // skip amd_kernel_code_t at the begining of kernel symbol (256 bytes)
-          Start += 256;
-        }
-        if (si == se - 1 ||
-            std::get<2>(Symbols[si + 1]) == ELF::STT_AMDGPU_HSA_KERNEL) {
-          // cut trailing zeroes at the end of kernel
-          // cut up to 256 bytes
-          const uint64_t EndAlign = 256;
-          const auto Limit = End - (std::min)(EndAlign, End - Start);
-          while (End > Limit &&
-            *reinterpret_cast<const support::ulittle32_t*>(&Bytes[End - 4]) == 0)
-            End -= 4;
+        // Check if we need to skip symbol
+        // Skip if the symbol's data is not between StartAddress and StopAddress
+        if (End + SectionAddr < StartAddress ||
+            Start + SectionAddr > StopAddress) {
+          continue;
         }
-      }
 
-      outs() << '\n' << std::get<1>(Symbols[si]) << ":\n";
+        // Stop disassembly at the stop address specified
+        if (End + SectionAddr > StopAddress)
+          End = StopAddress - SectionAddr;
+
+        if (Obj->isELF() && Obj->getArch() == Triple::amdgcn) {
+          // make size 4 bytes folded
+          End = Start + ((End - Start) & ~0x3ull);
+          if (std::get<2>(Symbols[si]) == ELF::STT_AMDGPU_HSA_KERNEL) {
+            // skip amd_kernel_code_t at the begining of kernel symbol
+            // (256 bytes)
+            Start += 256;
+          }
+          if (si == se - 1 ||
+              std::get<2>(Symbols[si + 1]) == ELF::STT_AMDGPU_HSA_KERNEL) {
+            // cut trailing zeroes at the end of kernel
+            // cut up to 256 bytes
+            const uint64_t EndAlign = 256;
+            const auto Limit = End - (std::min)(EndAlign, End - Start);
+            while (End > Limit &&
+                   *reinterpret_cast<const support::ulittle32_t *>(
+                       &Bytes[End - 4]) == 0)
+              End -= 4;
+          }
+        }
 
-#ifndef NDEBUG
-      raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
-#else
-      raw_ostream &DebugOut = nulls();
-#endif
+        OS << '\n' << std::get<1>(Symbols[si]) << ":\n";
 
-      for (Index = Start; Index < End; Index += Size) {
-        MCInst Inst;
+        for (Index = Start; Index < End; Index += Size) {
+          MCInst Inst;
 
-        if (Index + SectionAddr < StartAddress ||
-            Index + SectionAddr > StopAddress) {
-          // skip byte by byte till StartAddress is reached
-          Size = 1;
-          continue;
-        }
-        // AArch64 ELF binaries can interleave data and text in the
-        // same section. We rely on the markers introduced to
-        // understand what we need to dump. If the data marker is within a
-        // function, it is denoted as a word/short etc
-        if (isArmElf(Obj) && std::get<2>(Symbols[si]) != ELF::STT_OBJECT &&
-            !DisassembleAll) {
-          uint64_t Stride = 0;
-
-          auto DAI = std::lower_bound(DataMappingSymsAddr.begin(),
-                                      DataMappingSymsAddr.end(), Index);
-          if (DAI != DataMappingSymsAddr.end() && *DAI == Index) {
-            // Switch to data.
-            while (Index < End) {
-              outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-              outs() << "\t";
-              if (Index + 4 <= End) {
-                Stride = 4;
-                dumpBytes(Bytes.slice(Index, 4), outs());
-                outs() << "\t.word\t";
-                uint32_t Data = 0;
-                if (Obj->isLittleEndian()) {
-                  const auto Word =
-                      reinterpret_cast<const support::ulittle32_t *>(
-                          Bytes.data() + Index);
-                  Data = *Word;
-                } else {
-                  const auto Word = reinterpret_cast<const support::ubig32_t *>(
-                      Bytes.data() + Index);
-                  Data = *Word;
-                }
-                outs() << "0x" << format("%08" PRIx32, Data);
-              } else if (Index + 2 <= End) {
-                Stride = 2;
-                dumpBytes(Bytes.slice(Index, 2), outs());
-                outs() << "\t\t.short\t";
-                uint16_t Data = 0;
-                if (Obj->isLittleEndian()) {
-                  const auto Short =
-                      reinterpret_cast<const support::ulittle16_t *>(
-                          Bytes.data() + Index);
-                  Data = *Short;
+          if (Index + SectionAddr < StartAddress ||
+              Index + SectionAddr > StopAddress) {
+            // skip byte by byte till StartAddress is reached
+            Size = 1;
+            continue;
+          }
+          // AArch64 ELF binaries can interleave data and text in the
+          // same section. We rely on the markers introduced to
+          // understand what we need to dump. If the data marker is within a
+          // function, it is denoted as a word/short etc
+          if (isArmElf(Obj) && std::get<2>(Symbols[si]) != ELF::STT_OBJECT &&
+              !DisassembleAll) {
+            uint64_t Stride = 0;
+
+            auto DAI = std::lower_bound(DataMappingSymsAddr.begin(),
+                                        DataMappingSymsAddr.end(), Index);
+            if (DAI != DataMappingSymsAddr.end() && *DAI == Index) {
+              // Switch to data.
+              while (Index < End) {
+                OS << format("%8" PRIx64 ":", SectionAddr + Index);
+                OS << "\t";
+                if (Index + 4 <= End) {
+                  Stride = 4;
+                  dumpBytes(Bytes.slice(Index, 4), OS);
+                  OS << "\t.word\t";
+                  uint32_t Data = 0;
+                  if (Obj->isLittleEndian()) {
+                    const auto Word =
+                        reinterpret_cast<const support::ulittle32_t *>(
+                            Bytes.data() + Index);
+                    Data = *Word;
+                  } else {
+                    const auto Word =
+                        reinterpret_cast<const support::ubig32_t *>(
+                            Bytes.data() + Index);
+                    Data = *Word;
+                  }
+                  OS << "0x" << format("%08" PRIx32, Data);
+                } else if (Index + 2 <= End) {
+                  Stride = 2;
+                  dumpBytes(Bytes.slice(Index, 2), OS);
+                  OS << "\t\t.short\t";
+                  uint16_t Data = 0;
+                  if (Obj->isLittleEndian()) {
+                    const auto Short =
+                        reinterpret_cast<const support::ulittle16_t *>(
+                            Bytes.data() + Index);
+                    Data = *Short;
+                  } else {
+                    const auto Short =
+                        reinterpret_cast<const support::ubig16_t *>(
+                            Bytes.data() + Index);
+                    Data = *Short;
+                  }
+                  OS << "0x" << format("%04" PRIx16, Data);
                 } else {
-                  const auto Short =
-                      reinterpret_cast<const support::ubig16_t *>(Bytes.data() +
-                                                                  Index);
-                  Data = *Short;
+                  Stride = 1;
+                  dumpBytes(Bytes.slice(Index, 1), OS);
+                  OS << "\t\t.byte\t";
+                  OS << "0x" << format("%02" PRIx8, Bytes.slice(Index, 1)[0]);
                 }
-                outs() << "0x" << format("%04" PRIx16, Data);
-              } else {
-                Stride = 1;
-                dumpBytes(Bytes.slice(Index, 1), outs());
-                outs() << "\t\t.byte\t";
-                outs() << "0x" << format("%02" PRIx8, Bytes.slice(Index, 1)[0]);
+                Index += Stride;
+                OS << "\n";
+                auto TAI = std::lower_bound(TextMappingSymsAddr.begin(),
+                                            TextMappingSymsAddr.end(), Index);
+                if (TAI != TextMappingSymsAddr.end() && *TAI == Index)
+                  break;
               }
-              Index += Stride;
-              outs() << "\n";
-              auto TAI = std::lower_bound(TextMappingSymsAddr.begin(),
-                                          TextMappingSymsAddr.end(), Index);
-              if (TAI != TextMappingSymsAddr.end() && *TAI == Index)
-                break;
             }
           }
-        }
 
-        // If there is a data symbol inside an ELF text section and we are only
-        // disassembling text (applicable all architectures),
-        // we are in a situation where we must print the data and not
-        // disassemble it.
-        if (Obj->isELF() && std::get<2>(Symbols[si]) == ELF::STT_OBJECT &&
-            !DisassembleAll && Section.isText()) {
-          // print out data up to 8 bytes at a time in hex and ascii
-          uint8_t AsciiData[9] = {'\0'};
-          uint8_t Byte;
-          int NumBytes = 0;
-
-          for (Index = Start; Index < End; Index += 1) {
-            if (((SectionAddr + Index) < StartAddress) ||
-                ((SectionAddr + Index) > StopAddress))
-              continue;
-            if (NumBytes == 0) {
-              outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-              outs() << "\t";
-            }
-            Byte = Bytes.slice(Index)[0];
-            outs() << format(" %02x", Byte);
-            AsciiData[NumBytes] = isprint(Byte) ? Byte : '.';
-
-            uint8_t IndentOffset = 0;
-            NumBytes++;
-            if (Index == End - 1 || NumBytes > 8) {
-              // Indent the space for less than 8 bytes data.
-              // 2 spaces for byte and one for space between bytes
-              IndentOffset = 3 * (8 - NumBytes);
-              for (int Excess = 8 - NumBytes; Excess < 8; Excess++)
-                AsciiData[Excess] = '\0';
-              NumBytes = 8;
-            }
-            if (NumBytes == 8) {
-              AsciiData[8] = '\0';
-              outs() << std::string(IndentOffset, ' ') << "         ";
-              outs() << reinterpret_cast<char *>(AsciiData);
-              outs() << '\n';
-              NumBytes = 0;
+          // If there is a data symbol inside an ELF text section and we are
+          // only disassembling text (applicable all architectures), we are in a
+          // situation where we must print the data and not disassemble it.
+          if (Obj->isELF() && std::get<2>(Symbols[si]) == ELF::STT_OBJECT &&
+              !DisassembleAll && Section.isText()) {
+            // print out data up to 8 bytes at a time in hex and ascii
+            uint8_t AsciiData[9] = {'\0'};
+            uint8_t Byte;
+            int NumBytes = 0;
+
+            for (Index = Start; Index < End; Index += 1) {
+              if (((SectionAddr + Index) < StartAddress) ||
+                  ((SectionAddr + Index) > StopAddress))
+                continue;
+              if (NumBytes == 0) {
+                OS << format("%8" PRIx64 ":", SectionAddr + Index);
+                OS << "\t";
+              }
+              Byte = Bytes.slice(Index)[0];
+              OS << format(" %02x", Byte);
+              AsciiData[NumBytes] = isprint(Byte) ? Byte : '.';
+
+              uint8_t IndentOffset = 0;
+              NumBytes++;
+              if (Index == End - 1 || NumBytes > 8) {
+                // Indent the space for less than 8 bytes data.
+                // 2 spaces for byte and one for space between bytes
+                IndentOffset = 3 * (8 - NumBytes);
+                for (int Excess = 8 - NumBytes; Excess < 8; Excess++)
+                  AsciiData[Excess] = '\0';
+                NumBytes = 8;
+              }
+              if (NumBytes == 8) {
+                AsciiData[8] = '\0';
+                OS << std::string(IndentOffset, ' ') << "         ";
+                OS << reinterpret_cast<char *>(AsciiData);
+                OS << '\n';
+                NumBytes = 0;
+              }
             }
           }
-        }
-        if (Index >= End)
-          break;
-
-        // Disassemble a real instruction or a data when disassemble all is
-        // provided
-        bool Disassembled = DisAsm->getInstruction(Inst, Size, Bytes.slice(Index),
-                                                   SectionAddr + Index, DebugOut,
-                                                   CommentStream);
-        if (Size == 0)
-          Size = 1;
-
-        PIP.printInst(*IP, Disassembled ? &Inst : nullptr,
-                      Bytes.slice(Index, Size), SectionAddr + Index, outs(), "",
-                      *STI, &SP);
-        outs() << CommentStream.str();
-        Comments.clear();
-
-        // Try to resolve the target of a call, tail call, etc. to a specific
-        // symbol.
-        if (MIA && (MIA->isCall(Inst) || MIA->isUnconditionalBranch(Inst) ||
-                    MIA->isConditionalBranch(Inst))) {
-          uint64_t Target;
-          if (MIA->evaluateBranch(Inst, SectionAddr + Index, Size, Target)) {
-            // In a relocatable object, the target's section must reside in
-            // the same section as the call instruction or it is accessed
-            // through a relocation.
-            //
-            // In a non-relocatable object, the target may be in any section.
-            //
-            // N.B. We don't walk the relocations in the relocatable case yet.
-            auto *TargetSectionSymbols = &Symbols;
-            if (!Obj->isRelocatableObject()) {
-              auto SectionAddress = std::upper_bound(
-                  SectionAddresses.begin(), SectionAddresses.end(), Target,
-                  [](uint64_t LHS,
-                      const std::pair<uint64_t, SectionRef> &RHS) {
-                    return LHS < RHS.first;
-                  });
-              if (SectionAddress != SectionAddresses.begin()) {
-                --SectionAddress;
-                TargetSectionSymbols = &AllSymbols[SectionAddress->second];
-              } else {
-                TargetSectionSymbols = nullptr;
+          if (Index >= End)
+            break;
+
+          // Disassemble a real instruction or a data when disassemble all is
+          // provided
+          bool Disassembled = DisAsm.getInstruction(
+              Inst, Size, Bytes.slice(Index), SectionAddr + Index, DebugOut,
+              CommentStream);
+          if (Size == 0)
+            Size = 1;
+
+          PIP.printInst(IP, Disassembled ? &Inst : nullptr,
+                        Bytes.slice(Index, Size), SectionAddr + Index, OS, "",
+                        *STI, SP);
+          OS << CommentStream.str();
+          Comments.clear();
+
+          // Try to resolve the target of a call, tail call, etc. to a specific
+          // symbol.
+          if (MIA && (MIA->isCall(Inst) || MIA->isUnconditionalBranch(Inst) ||
+                      MIA->isConditionalBranch(Inst))) {
+            uint64_t Target;
+            if (MIA->evaluateBranch(Inst, SectionAddr + Index, Size, Target)) {
+              // In a relocatable object, the target's section must reside in
+              // the same section as the call instruction or it is accessed
+              // through a relocation.
+              //
+              // In a non-relocatable object, the target may be in any section.
+              //
+              // N.B. We don't walk the relocations in the relocatable case yet.
+              const SectionSymbolsTy *TargetSectionSymbols = &Symbols;
+              if (!Obj->isRelocatableObject()) {
+                auto SectionAddress = std::upper_bound(
+                    SectionAddresses.begin(), SectionAddresses.end(), Target,
+                    [](uint64_t LHS,
+                        const std::pair<uint64_t, SectionRef> &RHS) {
+                      return LHS < RHS.first;
+                    });
+                if (SectionAddress != SectionAddresses.begin()) {
+                  --SectionAddress;
+                  TargetSectionSymbols = SectionAddressSymbols
+                      [SectionAddress - SectionAddresses.begin()];
+                } else {
+                  TargetSectionSymbols = nullptr;
+                }
               }
-            }
 
-            // Find the first symbol in the section whose offset is less than
-            // or equal to the target.
-            if (TargetSectionSymbols) {
-              auto TargetSym = std::upper_bound(
-                  TargetSectionSymbols->begin(), TargetSectionSymbols->end(),
-                  Target, [](uint64_t LHS,
-                             const std::tuple<uint64_t, StringRef, uint8_t> &RHS) {
-                    return LHS < std::get<0>(RHS);
-                  });
-              if (TargetSym != TargetSectionSymbols->begin()) {
-                --TargetSym;
-                uint64_t TargetAddress = std::get<0>(*TargetSym);
-                StringRef TargetName = std::get<1>(*TargetSym);
-                outs() << " <" << TargetName;
-                uint64_t Disp = Target - TargetAddress;
-                if (Disp)
-                  outs() << "+0x" << utohexstr(Disp);
-                outs() << '>';
+              // Find the first symbol in the section whose offset is less than
+              // or equal to the target.
+              if (TargetSectionSymbols) {
+                auto TargetSym = std::upper_bound(
+                    TargetSectionSymbols->begin(), TargetSectionSymbols->end(),
+                    Target,
+                    [](uint64_t LHS,
+                       const std::tuple<uint64_t, StringRef, uint8_t> &RHS) {
+                      return LHS < std::get<0>(RHS);
+                    });
+                if (TargetSym != TargetSectionSymbols->begin()) {
+                  --TargetSym;
+                  uint64_t TargetAddress = std::get<0>(*TargetSym);
+                  StringRef TargetName = std::get<1>(*TargetSym);
+                  OS << " <" << TargetName;
+                  uint64_t Disp = Target - TargetAddress;
+                  if (Disp)
+                    OS << "+0x" << utohexstr(Disp);
+                  OS << '>';
+                }
               }
             }
           }
-        }
-        outs() << "\n";
-
-        // Print relocation for instruction.
-        while (rel_cur != rel_end) {
-          bool hidden = getHidden(*rel_cur);
-          uint64_t addr = rel_cur->getOffset();
-          SmallString<16> name;
-          SmallString<32> val;
+          OS << "\n";
+
+          // Print relocation for instruction.
+          while (rel_cur != rel_end) {
+            bool hidden = getHidden(*rel_cur);
+            uint64_t addr = rel_cur->getOffset();
+            SmallString<16> name;
+            SmallString<32> val;
+
+            // If this relocation is hidden, skip it.
+            if (hidden || ((SectionAddr + addr) < StartAddress)) {
+              ++rel_cur;
+              continue;
+            }
 
-          // If this relocation is hidden, skip it.
-          if (hidden || ((SectionAddr + addr) < StartAddress)) {
+            // Stop when rel_cur's address is past the current instruction.
+            if (addr >= Index + Size) break;
+            rel_cur->getTypeName(name);
+            error(getRelocationValueString(*rel_cur, val));
+            OS << format(Fmt.data(), SectionAddr + addr) << name << "\t"
+               << val << "\n";
             ++rel_cur;
-            continue;
           }
-
-          // Stop when rel_cur's address is past the current instruction.
-          if (addr >= Index + Size) break;
-          rel_cur->getTypeName(name);
-          error(getRelocationValueString(*rel_cur, val));
-          outs() << format(Fmt.data(), SectionAddr + addr) << name
-                 << "\t" << val << "\n";
-          ++rel_cur;
         }
       }
+    };
+
+    if (Threads == 1 || !Rels.empty()) {
+      DisassembleSymbols(0, Symbols.size(), *DisAsm, *IP, &SP, outs(),
+                         DebugOut);
+      continue;
+    }
+
+    // Split the symbols into runs covering roughly equal parts of the section
+    // and disassemble each run into its own buffer. The buffers are printed in
+    // order as they complete.
+    std::vector<std::pair<unsigned, unsigned>> Runs;
+    uint64_t RunSize = std::max<uint64_t>(SectSize / (Threads * 8), 4096);
+    unsigned RunBegin = 0;
+    for (unsigned si = 1, se = Symbols.size(); si != se; ++si) {
+      if (std::get<0>(Symbols[si]) - std::get<0>(Symbols[RunBegin]) <
+          RunSize)
+        continue;
+      Runs.emplace_back(RunBegin, si);
+      RunBegin = si;
+    }
+    Runs.emplace_back(RunBegin, Symbols.size());
+
+    // A section too small to split is disassembled like the serial path does.
+    if (Runs.size() == 1) {
+      DisassembleSymbols(0, Symbols.size(), *DisAsm, *IP, &SP, outs(),
+                         DebugOut);
+      continue;
+    }
+
+    std::vector<std::string> Buffers(Runs.size());
+    std::vector<std::string> DebugBuffers(Runs.size());
+    std::vector<char> Cloned(Runs.size());
+    std::vector<std::shared_future<ThreadPool::VoidTy>> Futures;
+    ThreadPool Pool(std::min<size_t>(Threads, Runs.size()));
+    for (unsigned I = 0, E = Runs.size(); I != E; ++I) {
+      Futures.push_back(Pool.async([&, I] {
+        // The disassembler and the instruction printer keep state between
+        // instructions, so each run gets its own. A run whose copies can't
+        // be created is left for the serial loop below.
+        MCContext RunCtx(AsmInfo.get(), MRI.get(), MOFI.get());
+        std::unique_ptr<MCDisassembler> RunDisAsm(
+            TheTarget->createMCDisassembler(*STI, RunCtx));
+        std::unique_ptr<MCInstPrinter> RunIP(TheTarget->createMCInstPrinter(
+            Triple(TripleName), AsmPrinterVariant, *AsmInfo, *MII, *MRI));
+        if (!RunDisAsm || !RunIP)
+          return;
+        Cloned[I] = true;
+        RunIP->setPrintImmHex(PrintImmHex);
+        raw_string_ostream OS(Buffers[I]);
+        raw_string_ostream DebugOS(DebugBuffers[I]);
+        DisassembleSymbols(Runs[I].first, Runs[I].second, *RunDisAsm, *RunIP,
+                           nullptr, OS, DebugDisAsm ? DebugOS : nulls());
+      }));
+    }
+    bool Warned = false;
+    for (unsigned I = 0, E = Runs.size(); I != E; ++I) {
+      Futures[I].wait();
+      if (!Cloned[I]) {
+        if (!Warned)
+          errs() << ToolName << ": warning: cannot create a disassembler for "
+                 << "a worker thread; disassembling serially\n";
+        Warned = true;
+        DisassembleSymbols(Runs[I].first, Runs[I].second, *DisAsm, *IP, &SP,
+                           outs(), DebugOut);
+        continue;
+      }
+      DebugOut << DebugBuffers[I];
+      outs() << Buffers[I];
+      std::string().swap(Buffers[I]);
+      std::string().swap(DebugBuffers[I]);
     }
   }
 }
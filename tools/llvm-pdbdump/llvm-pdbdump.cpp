@@ -30,6 +30,7 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Config/config.h"
 #include "llvm/DebugInfo/MSF/ByteStream.h"
+#include "llvm/DebugInfo/MSF/MappedBlockStream.h"
 #include "llvm/DebugInfo/MSF/MSFBuilder.h"
 #include "llvm/DebugInfo/PDB/GenericError.h"
 #include "llvm/DebugInfo/PDB/IPDBEnumChildren.h"
@@ -45,11 +46,13 @@
 #include "llvm/DebugInfo/PDB/Raw/DbiStreamBuilder.h"
 #include "llvm/DebugInfo/PDB/Raw/InfoStream.h"
 #include "llvm/DebugInfo/PDB/Raw/InfoStreamBuilder.h"
+#include "llvm/DebugInfo/PDB/Raw/ModStream.h"
 #include "llvm/DebugInfo/PDB/Raw/PDBFile.h"
 #include "llvm/DebugInfo/PDB/Raw/PDBFileBuilder.h"
 #include "llvm/DebugInfo/PDB/Raw/RawConstants.h"
 #include "llvm/DebugInfo/PDB/Raw/RawError.h"
 #include "llvm/DebugInfo/PDB/Raw/RawSession.h"
+#include "llvm/DebugInfo/PDB/Raw/SymbolStream.h"
 #include "llvm/DebugInfo/PDB/Raw/TpiStream.h"
 #include "llvm/DebugInfo/PDB/Raw/TpiStreamBuilder.h"
 #include "llvm/Support/COM.h"
@@ -65,6 +68,7 @@
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/ScopedPrinter.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -84,6 +88,10 @@ cl::SubCommand
 cl::SubCommand
     PdbToYamlSubcommand("pdb2yaml",
                         "Generate a detailed YAML description of a PDB File");
+cl::SubCommand
+    BenchSubcommand("bench",
+                    "Time iteration over the symbol and type records of a "
+                    "PDB file");
 
 cl::OptionCategory TypeCategory("Symbol Type Options");
 cl::OptionCategory FilterCategory("Filtering Options");
@@ -298,6 +306,16 @@ cl::list<std::string> InputFilename(cl::Positional,
                                     cl::desc("<input PDB file>"), cl::Required,
                                     cl::sub(PdbToYamlSubcommand));
 }
+
+namespace bench {
+cl::opt<unsigned> Iterations("iterations",
+                             cl::desc("Number of times to read the records"),
+                             cl::sub(BenchSubcommand), cl::init(1));
+
+cl::list<std::string> InputFilenames(cl::Positional,
+                                     cl::desc("<input PDB files>"),
+                                     cl::OneOrMore, cl::sub(BenchSubcommand));
+}
 }
 
 static ExitOnError ExitOnErr;
@@ -400,6 +418,68 @@ static void dumpRaw(StringRef Path) {
   ExitOnErr(O->dump());
 }
 
+// Reads every symbol and type record of the PDB file at Path, as many times
+// as requested, and prints how long that took.  Module symbol streams are
+// opened anew on each iteration, so the time includes setting them up.
+static void benchmark(StringRef Path) {
+  std::unique_ptr<IPDBSession> Session;
+  ExitOnErr(loadDataForPDB(PDB_ReaderType::Raw, Path, Session));
+
+  RawSession *RS = static_cast<RawSession *>(Session.get());
+  PDBFile &File = RS->getPDBFile();
+  DbiStream &Dbi = ExitOnErr(File.getPDBDbiStream());
+  TpiStream &Tpi = ExitOnErr(File.getPDBTpiStream());
+  SymbolStream &Globals = ExitOnErr(File.getPDBSymbolStream());
+
+  uint64_t NumRecords = 0;
+  uint64_t NumBytes = 0;
+  uint64_t NumBytesCopied = 0;
+  bool HadError = false;
+  double Start = TimeRecord::getCurrentTime().getWallTime();
+  for (unsigned I = 0; I < opts::bench::Iterations; ++I) {
+    for (const auto &Sym : Globals.getSymbols(&HadError)) {
+      ++NumRecords;
+      NumBytes += Sym.length();
+    }
+    for (const auto &Type : Tpi.types(&HadError)) {
+      ++NumRecords;
+      NumBytes += Type.length();
+    }
+    for (const auto &Modi : Dbi.modules()) {
+      uint16_t StreamIdx = Modi.Info.getModuleStreamIndex();
+      if (StreamIdx >= File.getNumStreams())
+        continue;
+      auto Data = MappedBlockStream::createIndexedStream(
+          File.getMsfLayout(), File.getMsfBuffer(), StreamIdx);
+      const MappedBlockStream &Stream = *Data;
+      ModStream ModS(Modi.Info, std::move(Data));
+      ExitOnErr(ModS.reload());
+      for (const auto &Sym : ModS.symbols(&HadError)) {
+        ++NumRecords;
+        NumBytes += Sym.length();
+      }
+      NumBytesCopied += Stream.getNumBytesCopied();
+    }
+    if (HadError)
+      ExitOnErr(make_error<RawError>(raw_error_code::corrupt_file,
+                                     "PDB contained a corrupt record"));
+  }
+  double Seconds = TimeRecord::getCurrentTime().getWallTime() - Start;
+
+  unsigned Iterations = std::max(1U, unsigned(opts::bench::Iterations));
+  outs() << Path << ":\n";
+  outs() << "  Iterations: " << opts::bench::Iterations << "\n";
+  outs() << "  Records: " << NumRecords / Iterations << "\n";
+  outs() << "  Record bytes: " << NumBytes / Iterations << "\n";
+  outs() << "  Module stream bytes copied: " << NumBytesCopied / Iterations
+         << "\n";
+  outs() << "  Seconds per iteration: "
+         << format("%.6f", Seconds / Iterations) << "\n";
+  if (Seconds > 0)
+    outs() << "  Records per second: "
+           << format("%.0f", NumRecords / Seconds) << "\n";
+}
+
 static void dumpPretty(StringRef Path) {
   std::unique_ptr<IPDBSession> Session;
 
@@ -608,6 +688,9 @@ int main(int argc_, const char *argv_[]) {
   } else if (opts::RawSubcommand) {
     std::for_each(opts::raw::InputFilenames.begin(),
                   opts::raw::InputFilenames.end(), dumpRaw);
+  } else if (opts::BenchSubcommand) {
+    std::for_each(opts::bench::InputFilenames.begin(),
+                  opts::bench::InputFilenames.end(), benchmark);
   }
 
   outs().flush();
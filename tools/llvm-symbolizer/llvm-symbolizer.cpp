@@ -86,6 +86,16 @@ static cl::opt<int> ClPrintSourceContextLines(
     "print-source-context-lines", cl::init(0),
     cl::desc("Print N number of source file context"));
 
+static cl::opt<std::string>
+    ClIndexCacheDir("index-cache-dir", cl::init(""),
+                    cl::desc("Symbolize code through address indices, "
+                             "cached in this directory by build ID"));
+
+static cl::opt<unsigned long long>
+    ClCacheSize("cache-size", cl::init(0),
+                cl::desc("Approximate memory budget in bytes for cached "
+                         "debug info and indices (0 = unlimited)"));
+
 template<typename T>
 static bool error(Expected<T> &ResOrErr) {
   if (ResOrErr)
@@ -149,6 +159,8 @@ int main(int argc, char **argv) {
   cl::ParseCommandLineOptions(argc, argv, "llvm-symbolizer\n");
   LLVMSymbolizer::Options Opts(ClPrintFunctions, ClUseSymbolTable, ClDemangle,
                                ClUseRelativeAddress, ClDefaultArch);
+  Opts.IndexCacheDir = ClIndexCacheDir;
+  Opts.MaxCacheSize = ClCacheSize;
 
   for (const auto &hint : ClDsymHint) {
     if (sys::path::extension(hint) == ".dSYM") {
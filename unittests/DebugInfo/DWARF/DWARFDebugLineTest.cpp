@@ -0,0 +1,257 @@
+//===- llvm/unittest/DebugInfo/DWARFDebugLineTest.cpp ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/DWARF/DWARFDebugLine.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Dwarf.h"
+#include "gtest/gtest.h"
+#include <string>
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
+using namespace llvm;
+using namespace dwarf;
+
+namespace {
+
+void addU8(std::string &S, uint8_t V) { S.push_back(V); }
+
+void addU16(std::string &S, uint16_t V) {
+  addU8(S, V);
+  addU8(S, V >> 8);
+}
+
+void addU32(std::string &S, uint32_t V) {
+  addU16(S, V);
+  addU16(S, V >> 16);
+}
+
+void addU64(std::string &S, uint64_t V) {
+  addU32(S, V);
+  addU32(S, V >> 32);
+}
+
+void addSetAddress(std::string &S, uint64_t Address) {
+  addU8(S, 0);
+  addU8(S, 9);
+  addU8(S, DW_LNE_set_address);
+  addU64(S, Address);
+}
+
+void addEndSequence(std::string &S) {
+  addU8(S, 0);
+  addU8(S, 1);
+  addU8(S, DW_LNE_end_sequence);
+}
+
+// A little-endian DWARF 2 line table for the line number program Program.
+std::string createLineTable(StringRef Program) {
+  std::string Prologue;
+  addU8(Prologue, 1);   // minimum_instruction_length
+  addU8(Prologue, 1);   // default_is_stmt
+  addU8(Prologue, -5);  // line_base
+  addU8(Prologue, 14);  // line_range
+  addU8(Prologue, 13);  // opcode_base
+  for (uint8_t Length : {0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1})
+    addU8(Prologue, Length);
+  addU8(Prologue, 0); // No include directories.
+  Prologue += StringRef("a.c\0\0\0\0", 7);
+  addU8(Prologue, 0);
+
+  std::string Table;
+  addU32(Table, 2 + 4 + Prologue.size() + Program.size());
+  addU16(Table, 2);
+  addU32(Table, Prologue.size());
+  return Table + Prologue + Program.str();
+}
+
+// A line table with two sequences, and a file defined between them.
+std::string createLineTable() {
+  std::string Program;
+  addSetAddress(Program, 0x1000);
+  addU8(Program, DW_LNS_copy);           // 0x1000, line 1.
+  addU8(Program, 13 + (1 + 5) + 14 * 4); // 0x1004, line 2.
+  addU8(Program, DW_LNS_advance_pc);
+  addU8(Program, 4);
+  addEndSequence(Program); // 0x1008.
+
+  addU8(Program, 0);
+  addU8(Program, 8);
+  addU8(Program, DW_LNE_define_file);
+  Program += StringRef("b.c\0\0\0", 7);
+
+  addSetAddress(Program, 0x2000);
+  addU8(Program, DW_LNS_set_file);
+  addU8(Program, 2);
+  addU8(Program, DW_LNS_advance_line);
+  addU8(Program, 9);
+  addU8(Program, DW_LNS_copy);           // 0x2000, line 10.
+  addU8(Program, 13 + (0 + 5) + 14 * 2); // 0x2002, line 10.
+  addU8(Program, DW_LNS_advance_pc);
+  addU8(Program, 2);
+  addEndSequence(Program); // 0x2004.
+  return createLineTable(Program);
+}
+
+TEST(DWARFDebugLine, LazyTableMatchesEagerTable) {
+  std::string Data = createLineTable();
+  DataExtractor Extractor(Data, true, 8);
+  RelocAddrMap Relocs;
+
+  DWARFDebugLine::LineTable Eager;
+  uint32_t Offset = 0;
+  ASSERT_TRUE(Eager.parse(Extractor, &Relocs, &Offset));
+  EXPECT_EQ(Data.size(), Offset);
+  EXPECT_FALSE(Eager.isLazy());
+
+  DWARFDebugLine::LineTable Lazy;
+  Offset = 0;
+  ASSERT_TRUE(Lazy.parseLazily(Extractor, &Relocs, &Offset));
+  EXPECT_EQ(Data.size(), Offset);
+  EXPECT_TRUE(Lazy.isLazy());
+
+  // The lazy table only keeps the sequences.
+  EXPECT_EQ(6U, Eager.Rows.size());
+  EXPECT_TRUE(Lazy.Rows.empty());
+  EXPECT_EQ(6U, Eager.getNumRows());
+  EXPECT_EQ(6U, Lazy.getNumRows());
+  ASSERT_EQ(2U, Lazy.Sequences.size());
+  EXPECT_EQ(0x1000U, Lazy.Sequences[0].LowPC);
+  EXPECT_EQ(0x1008U, Lazy.Sequences[0].HighPC);
+  EXPECT_EQ(0x2000U, Lazy.Sequences[1].LowPC);
+  EXPECT_EQ(0x2004U, Lazy.Sequences[1].HighPC);
+  // Decoding a sequence again doesn't define its files twice.
+  EXPECT_EQ(2U, Lazy.Prologue.FileNames.size());
+
+  for (uint64_t Address : {0xfffU, 0x1000U, 0x1003U, 0x1004U, 0x1007U,
+                           0x1008U, 0x2000U, 0x2003U, 0x2004U}) {
+    uint32_t Index = Eager.lookupAddress(Address);
+    EXPECT_EQ(Index, Lazy.lookupAddress(Address));
+    if (Index == Eager.UnknownRowIndex)
+      continue;
+    DWARFDebugLine::Row Row = Lazy.getRow(Index);
+    EXPECT_EQ(Eager.Rows[Index].Address, Row.Address);
+    EXPECT_EQ(Eager.Rows[Index].Line, Row.Line);
+    EXPECT_EQ(Eager.Rows[Index].File, Row.File);
+  }
+  EXPECT_EQ(Lazy.UnknownRowIndex, Lazy.lookupAddress(0x1008));
+  EXPECT_EQ(1U, Lazy.lookupAddress(0x1005));
+  EXPECT_EQ(2U, Lazy.getRow(1).Line);
+  EXPECT_EQ(4U, Lazy.lookupAddress(0x2003));
+  EXPECT_EQ(10U, Lazy.getRow(4).Line);
+  EXPECT_EQ(2U, Lazy.getRow(4).File);
+  EXPECT_TRUE(Lazy.getRow(5).EndSequence);
+
+  std::vector<uint32_t> EagerRows, LazyRows;
+  EXPECT_TRUE(Eager.lookupAddressRange(0x1002, 0x1000, EagerRows));
+  EXPECT_TRUE(Lazy.lookupAddressRange(0x1002, 0x1000, LazyRows));
+  EXPECT_EQ(EagerRows, LazyRows);
+}
+
+TEST(DWARFDebugLine, LazyTableReachesRowsOutsideValidSequences) {
+  std::string Program;
+  // An empty, and so invalid, sequence.
+  addSetAddress(Program, 0x3000);
+  addU8(Program, DW_LNS_copy); // 0x3000, line 1.
+  addEndSequence(Program);     // 0x3000.
+  // A valid one.
+  addSetAddress(Program, 0x1000);
+  addU8(Program, DW_LNS_copy);           // 0x1000, line 1.
+  addU8(Program, 13 + (1 + 5) + 14 * 4); // 0x1004, line 2.
+  addEndSequence(Program);               // 0x1004.
+  // Rows that are never terminated.
+  addSetAddress(Program, 0x4000);
+  addU8(Program, DW_LNS_copy);           // 0x4000, line 1.
+  addU8(Program, 13 + (2 + 5) + 14 * 8); // 0x4008, line 3.
+  std::string Data = createLineTable(Program);
+  DataExtractor Extractor(Data, true, 8);
+  RelocAddrMap Relocs;
+
+  DWARFDebugLine::LineTable Eager;
+  uint32_t Offset = 0;
+  ASSERT_TRUE(Eager.parse(Extractor, &Relocs, &Offset));
+  DWARFDebugLine::LineTable Lazy;
+  Offset = 0;
+  ASSERT_TRUE(Lazy.parseLazily(Extractor, &Relocs, &Offset));
+
+  // Only the valid sequence is used for lookups, but every row is there.
+  EXPECT_EQ(1U, Lazy.Sequences.size());
+  ASSERT_EQ(7U, Eager.Rows.size());
+  ASSERT_EQ(7U, Lazy.getNumRows());
+  for (uint32_t Index = 0; Index != 7; ++Index) {
+    DWARFDebugLine::Row Row = Lazy.getRow(Index);
+    EXPECT_EQ(Eager.Rows[Index].Address, Row.Address) << "row " << Index;
+    EXPECT_EQ(Eager.Rows[Index].Line, Row.Line) << "row " << Index;
+    EXPECT_EQ(Eager.Rows[Index].EndSequence, Row.EndSequence)
+        << "row " << Index;
+  }
+  EXPECT_EQ(0x3000U, Lazy.getRow(1).Address);
+  EXPECT_EQ(0x4008U, Lazy.getRow(6).Address);
+  EXPECT_EQ(3U, Lazy.getRow(6).Line);
+}
+
+TEST(DWARFDebugLine, GetOrParseLineTableLazyIsOptIn) {
+  std::string Data = createLineTable();
+  RelocAddrMap Relocs;
+
+  DWARFDebugLine Line(&Relocs);
+  const DWARFDebugLine::LineTable *LT =
+      Line.getOrParseLineTable(DataExtractor(Data, true, 8), 0);
+  ASSERT_TRUE(LT);
+  EXPECT_FALSE(LT->isLazy());
+  EXPECT_EQ(6U, LT->Rows.size());
+  EXPECT_EQ(LT, Line.getLineTable(0));
+
+  DWARFDebugLine LazyLine(&Relocs);
+  LT = LazyLine.getOrParseLineTable(DataExtractor(Data, true, 8), 0,
+                                    /*Lazy=*/true);
+  ASSERT_TRUE(LT);
+  EXPECT_TRUE(LT->isLazy());
+  EXPECT_TRUE(LT->Rows.empty());
+  EXPECT_EQ(LT, LazyLine.getLineTable(0));
+
+  DILineInfo Result;
+  EXPECT_TRUE(LT->getFileLineInfoForAddress(
+      0x2001, nullptr, DILineInfoSpecifier::FileLineInfoKind::Default,
+      Result));
+  EXPECT_EQ("b.c", Result.FileName);
+  EXPECT_EQ(10U, Result.Line);
+}
+
+#if LLVM_ENABLE_THREADS
+TEST(DWARFDebugLine, ConcurrentLazyLookups) {
+  std::string Data = createLineTable();
+  DataExtractor Extractor(Data, true, 8);
+  RelocAddrMap Relocs;
+  DWARFDebugLine::LineTable Lazy;
+  uint32_t Offset = 0;
+  ASSERT_TRUE(Lazy.parseLazily(Extractor, &Relocs, &Offset));
+
+  // Lookups in both sequences keep decoding them again from every thread.
+  std::vector<std::thread> Threads;
+  std::vector<unsigned> Failures(4);
+  for (unsigned T = 0; T != Failures.size(); ++T)
+    Threads.emplace_back([&, T] {
+      for (unsigned I = 0; I != 1000; ++I) {
+        if (Lazy.lookupAddress(0x2003) != 4 || Lazy.getRow(4).Line != 10)
+          ++Failures[T];
+        if (Lazy.lookupAddress(0x1000) != 0 ||
+            Lazy.getRow(0).Address != 0x1000)
+          ++Failures[T];
+      }
+    });
+  for (auto &Thread : Threads)
+    Thread.join();
+  for (unsigned F : Failures)
+    EXPECT_EQ(0U, F);
+}
+#endif
+
+} // end anonymous namespace
@@ -229,6 +229,58 @@ TEST(MappedBlockStreamTest, UnalignedOverlappingReadFail) {
   EXPECT_EQ(10U, S->getNumBytesCopied());
 }
 
+// Tests that the longest contiguous chunk at an offset extends to the end of
+// the run of contiguous blocks, but not past the end of the stream.
+TEST(MappedBlockStreamTest, LongestContiguousChunk) {
+  DiscontiguousStream F(BlocksAry, DataAry);
+  auto S = MappedBlockStream::createStream(F.block_size(), F.block_count(),
+                                           F.layout(), F);
+  ArrayRef<uint8_t> Buffer;
+  EXPECT_NO_ERROR(S->readLongestContiguousChunk(1U, Buffer));
+  EXPECT_EQ(makeArrayRef(DataAry + 1, 2), Buffer);
+  EXPECT_NO_ERROR(S->readLongestContiguousChunk(4U, Buffer));
+  EXPECT_EQ(makeArrayRef(DataAry + 4, 1), Buffer);
+  EXPECT_NO_ERROR(S->readLongestContiguousChunk(6U, Buffer));
+  EXPECT_EQ(makeArrayRef(DataAry + 6, 4), Buffer);
+  EXPECT_ERROR(S->readLongestContiguousChunk(10U, Buffer));
+
+  // A stream ref reads from its own offset, and stops at its own end.
+  ReadableStreamRef Ref(*S, 6U, 3U);
+  EXPECT_NO_ERROR(Ref.readLongestContiguousChunk(1U, Buffer));
+  EXPECT_EQ(makeArrayRef(DataAry + 7, 2), Buffer);
+  EXPECT_EQ(0U, S->getNumBytesCopied());
+}
+
+// Tests that a reader returns references into the stream for successive
+// reads within a contiguous run of blocks, including zero terminated strings.
+TEST(MappedBlockStreamTest, ZeroCopyReadsFromChunk) {
+  static const uint32_t Blocks[] = {3, 4, 5, 6, 0, 1, 2, 7};
+  uint8_t Data[] = {'e', 'f', 0, 'g', 'h', 'i', 'j', 0};
+  DiscontiguousStream F(Blocks, Data);
+  auto S = MappedBlockStream::createStream(F.block_size(), F.block_count(),
+                                           F.layout(), F);
+  StreamReader R(*S);
+  StringRef Str;
+  EXPECT_NO_ERROR(R.readFixedString(Str, 2));
+  EXPECT_EQ(StringRef("gh"), Str);
+  EXPECT_EQ(Data + 3, Str.bytes_begin());
+  EXPECT_NO_ERROR(R.readFixedString(Str, 2));
+  EXPECT_EQ(StringRef("ij"), Str);
+  EXPECT_EQ(Data + 5, Str.bytes_begin());
+  EXPECT_NO_ERROR(R.readZeroString(Str));
+  EXPECT_EQ(StringRef("ef"), Str);
+  EXPECT_EQ(Data, Str.bytes_begin());
+  EXPECT_EQ(7U, R.getOffset());
+  EXPECT_EQ(0U, S->getNumBytesCopied());
+
+  // A string which crosses a discontiguity is copied.
+  R.setOffset(0);
+  EXPECT_NO_ERROR(R.readZeroString(Str));
+  EXPECT_EQ(StringRef("ghijef"), Str);
+  EXPECT_EQ(7U, R.getOffset());
+  EXPECT_EQ(6U, S->getNumBytesCopied());
+}
+
 TEST(MappedBlockStreamTest, WriteBeyondEndOfStream) {
   static uint8_t Data[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J'};
   static uint8_t LargeBuffer[] = {'0', '1', '2', '3', '4', '5',
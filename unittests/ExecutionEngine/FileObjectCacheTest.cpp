@@ -0,0 +1,114 @@
+//===- FileObjectCacheTest.cpp - Unit tests for FileObjectCache -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class FileObjectCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("jit-cache", CacheDir));
+  }
+
+  void TearDown() override {
+    std::error_code EC;
+    for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+         I.increment(EC))
+      sys::fs::remove(I->path());
+    sys::fs::remove(CacheDir);
+  }
+
+  // Create a module named ModuleID declaring a single function FnName.
+  std::unique_ptr<Module> createModule(StringRef ModuleID, StringRef FnName) {
+    auto M = make_unique<Module>(ModuleID, Context);
+    Function::Create(FunctionType::get(Type::getVoidTy(Context), false),
+                     GlobalValue::ExternalLinkage, FnName, M.get());
+    return M;
+  }
+
+  LLVMContext Context;
+  SmallString<128> CacheDir;
+};
+
+TEST_F(FileObjectCacheTest, MissThenHit) {
+  FileObjectCache Cache(CacheDir, "config");
+  auto M = createModule("first", "foo");
+
+  EXPECT_FALSE(Cache.getObject(M.get()));
+  auto Obj = MemoryBuffer::getMemBuffer("fake object");
+  Cache.notifyObjectCompiled(M.get(), Obj->getMemBufferRef());
+
+  // A second cache instance sharing the directory (e.g. the next run of the
+  // JIT) finds the entry, even though the module has a different name.
+  FileObjectCache NextRun(CacheDir, "config");
+  auto SameIR = createModule("second", "foo");
+  auto Cached = NextRun.getObject(SameIR.get());
+  ASSERT_TRUE(!!Cached) << "Expected a cache hit for identical IR";
+  EXPECT_EQ(Cached->getBuffer(), "fake object");
+  EXPECT_EQ(NextRun.getNumHits(), 1U);
+  EXPECT_EQ(NextRun.getNumMisses(), 0U);
+}
+
+TEST_F(FileObjectCacheTest, KeyCoversIRAndConfig) {
+  FileObjectCache Cache(CacheDir, "config");
+  auto M = createModule("m", "foo");
+  EXPECT_FALSE(Cache.getObject(M.get()));
+  auto Obj = MemoryBuffer::getMemBuffer("fake object");
+  Cache.notifyObjectCompiled(M.get(), Obj->getMemBufferRef());
+
+  auto OtherIR = createModule("m", "bar");
+  EXPECT_FALSE(Cache.getObject(OtherIR.get()))
+      << "Different IR should not share a cache entry";
+
+  FileObjectCache OtherConfig(CacheDir, "other config");
+  EXPECT_FALSE(OtherConfig.getObject(M.get()))
+      << "Different target configuration should not share a cache entry";
+}
+
+TEST_F(FileObjectCacheTest, LookupLeavesModuleUnchanged) {
+  FileObjectCache Cache(CacheDir, "config");
+  auto M = createModule("m", "foo");
+  M->setSourceFileName("source.ll");
+  EXPECT_FALSE(Cache.getObject(M.get()));
+  EXPECT_EQ("source.ll", M->getSourceFileName());
+
+  // The source file name still isn't part of the key.
+  auto Obj = MemoryBuffer::getMemBuffer("fake object");
+  Cache.notifyObjectCompiled(M.get(), Obj->getMemBufferRef());
+  auto Renamed = createModule("m", "foo");
+  Renamed->setSourceFileName("other.ll");
+  EXPECT_TRUE(!!Cache.getObject(Renamed.get()));
+}
+
+TEST_F(FileObjectCacheTest, KeyComputedBeforeCompilation) {
+  FileObjectCache Cache(CacheDir, "config");
+  auto M = createModule("m", "foo");
+  std::string EntryPath = Cache.getEntryPath(*M);
+
+  EXPECT_FALSE(Cache.getObject(M.get()));
+  // Simulate the JIT changing the IR while compiling it.
+  M->getFunction("foo")->setName("foo.renamed");
+  auto Obj = MemoryBuffer::getMemBuffer("fake object");
+  Cache.notifyObjectCompiled(M.get(), Obj->getMemBufferRef());
+
+  EXPECT_TRUE(sys::fs::exists(EntryPath))
+      << "Object should be stored under the key of the uncompiled IR";
+}
+}
@@ -11,9 +11,11 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Target/TargetMachine.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -226,4 +228,26 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+TEST_F(MCJITObjectCacheTest, FileObjectCacheConfigCoversCodeGenOptions) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<TargetMachine> TM(EngineBuilder().selectTarget());
+  ASSERT_TRUE(!!TM);
+  std::string Config = FileObjectCache::getTargetConfig(*TM);
+
+  TM->Options.UnsafeFPMath = !TM->Options.UnsafeFPMath;
+  EXPECT_NE(Config, FileObjectCache::getTargetConfig(*TM));
+  TM->Options.UnsafeFPMath = !TM->Options.UnsafeFPMath;
+  EXPECT_EQ(Config, FileObjectCache::getTargetConfig(*TM));
+
+  TM->Options.MCOptions.DwarfVersion = 2;
+  EXPECT_NE(Config, FileObjectCache::getTargetConfig(*TM));
+  TM->Options.MCOptions.DwarfVersion = 0;
+
+  CodeGenOpt::Level OptLevel = TM->getOptLevel();
+  TM->setOptLevel(OptLevel == CodeGenOpt::None ? CodeGenOpt::Aggressive
+                                               : CodeGenOpt::None);
+  EXPECT_NE(Config, FileObjectCache::getTargetConfig(*TM));
+}
+
 } // end anonymous namespace
@@ -0,0 +1,252 @@
+//===- PerfJITEventListenerTest.cpp - Tests for the perf JIT listener -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This test suite JITs a function with MCJIT and checks the perf map and
+// jitdump files that the perf JIT event listener writes for it.
+//
+//===----------------------------------------------------------------------===//
+
+#include "MCJITTestBase.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "gtest/gtest.h"
+#include <cstring>
+
+using namespace llvm;
+
+namespace {
+
+class PerfJITEventListenerTest : public testing::Test, public MCJITTestBase {
+protected:
+  void SetUp() override {
+    M.reset(createEmptyModule("<main>"));
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("perf-jit-test", Dir));
+  }
+
+  void TearDown() override {
+    std::error_code EC;
+    std::vector<std::string> Files;
+    for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+         I.increment(EC))
+      Files.push_back(I->path());
+    for (auto &File : Files)
+      sys::fs::remove(File);
+    sys::fs::remove(Dir);
+  }
+
+  // Read the one file in Dir whose name starts with Prefix.
+  std::unique_ptr<MemoryBuffer> readOutputFile(StringRef Prefix) {
+    std::error_code EC;
+    for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+         I.increment(EC))
+      if (sys::path::filename(I->path()).startswith(Prefix)) {
+        auto BufOrErr = MemoryBuffer::getFile(I->path());
+        if (BufOrErr)
+          return std::move(*BufOrErr);
+      }
+    return nullptr;
+  }
+
+  SmallString<128> Dir;
+};
+
+// jitdump files are written in the host's byte order.
+uint32_t read32(const char *P) {
+  return support::endian::read<uint32_t, support::native, 1>(P);
+}
+
+uint64_t read64(const char *P) {
+  return support::endian::read<uint64_t, support::native, 1>(P);
+}
+
+struct JITDumpRecord {
+  uint32_t Type;
+  StringRef Body;
+};
+
+std::vector<JITDumpRecord> readJITDumpRecords(StringRef Data) {
+  std::vector<JITDumpRecord> Records;
+  uint32_t HeaderSize = read32(Data.data() + 8);
+  for (size_t Pos = HeaderSize; Pos + 16 <= Data.size();) {
+    JITDumpRecord R;
+    R.Type = read32(Data.data() + Pos);
+    uint32_t Size = read32(Data.data() + Pos + 4);
+    if (Size < 16 || Pos + Size > Data.size())
+      break;
+    R.Body = Data.substr(Pos + 16, Size - 16);
+    Records.push_back(R);
+    Pos += Size;
+  }
+  return Records;
+}
+
+// Return the number of code load records for Name in the jitdump Data, and
+// check that each of them holds the code that is now at its address.
+unsigned checkCodeLoads(StringRef Data, StringRef Name, uint64_t Addr) {
+  unsigned NumLoads = 0;
+  for (auto &R : readJITDumpRecords(Data)) {
+    if (R.Type != 0) // JIT_CODE_LOAD
+      continue;
+    EXPECT_LE(40U, R.Body.size());
+    if (R.Body.size() < 40)
+      continue;
+    const char *P = R.Body.data();
+    uint64_t CodeAddr = read64(P + 16);
+    uint64_t CodeSize = read64(P + 24);
+    if (StringRef(P + 40) != Name)
+      continue;
+    ++NumLoads;
+    EXPECT_EQ(Addr, CodeAddr);
+    EXPECT_EQ(40U + Name.size() + 1 + CodeSize, R.Body.size());
+    if (40U + Name.size() + 1 + CodeSize != R.Body.size())
+      continue;
+    EXPECT_EQ(0, memcmp(P + 40 + Name.size() + 1, (const void *)CodeAddr,
+                        CodeSize))
+        << "Code bytes in jitdump do not match the JIT'd code of " << Name;
+  }
+  return NumLoads;
+}
+
+TEST_F(PerfJITEventListenerTest, PerfMapAndJITDump) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<JITEventListener> Listener(
+      JITEventListener::createPerfJITEventListener(Dir));
+  if (!Listener)
+    return;
+
+  Function *F = insertAddFunction(M.get());
+  createJIT(std::move(M));
+  TheJIT->RegisterJITEventListener(Listener.get());
+  uint64_t Addr = TheJIT->getFunctionAddress(F->getName().str());
+  ASSERT_NE(0U, Addr) << "Unable to get pointer to function from JIT";
+
+  // The perf map names the function's address range.
+  auto PerfMap = readOutputFile("perf-");
+  ASSERT_TRUE(!!PerfMap) << "No perf map was written";
+  bool FoundInMap = false;
+  SmallVector<StringRef, 4> Lines;
+  PerfMap->getBuffer().split(Lines, '\n', -1, false);
+  for (StringRef Line : Lines) {
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, ' ', 2);
+    ASSERT_EQ(3U, Fields.size()) << "Malformed perf map line: " << Line;
+    uint64_t Start, Size;
+    EXPECT_FALSE(Fields[0].getAsInteger(16, Start));
+    EXPECT_FALSE(Fields[1].getAsInteger(16, Size));
+    if (Fields[2] == "add") {
+      FoundInMap = true;
+      EXPECT_EQ(Addr, Start);
+      EXPECT_NE(0U, Size);
+    }
+  }
+  EXPECT_TRUE(FoundInMap) << "Function missing from perf map";
+
+  // The jitdump file has a code load record with the function's code.
+  auto JITDump = readOutputFile("jit-");
+  ASSERT_TRUE(!!JITDump) << "No jitdump file was written";
+  StringRef Data = JITDump->getBuffer();
+  ASSERT_LE(40U, Data.size());
+  EXPECT_EQ(0x4A695444U, read32(Data.data())) << "Bad jitdump magic";
+
+  EXPECT_EQ(1U, checkCodeLoads(Data, "add", Addr))
+      << "Function missing from jitdump";
+
+  // Destroying the listener closes the jitdump.
+  TheJIT.reset();
+  Listener.reset();
+  JITDump = readOutputFile("jit-");
+  ASSERT_TRUE(!!JITDump);
+  auto Records = readJITDumpRecords(JITDump->getBuffer());
+  ASSERT_FALSE(Records.empty());
+  EXPECT_EQ(3U, Records.back().Type) << "Missing JIT_CODE_CLOSE record";
+}
+
+TEST_F(PerfJITEventListenerTest, CodeIsRecordedAfterRelocation) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<JITEventListener> Listener(
+      JITEventListener::createPerfJITEventListener(Dir));
+  if (!Listener)
+    return;
+
+  // The call from caller to add needs a relocation, so the jitdump only
+  // matches the code in memory if it was written after relocation.
+  Function *Add = insertAddFunction(M.get());
+  Function *Caller =
+      insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), Add);
+  createJIT(std::move(M));
+  TheJIT->RegisterJITEventListener(Listener.get());
+  uint64_t Addr = TheJIT->getFunctionAddress(Caller->getName().str());
+  ASSERT_NE(0U, Addr) << "Unable to get pointer to function from JIT";
+
+  int32_t (*CallerPtr)(int32_t, int32_t) =
+      (int32_t(*)(int32_t, int32_t))Addr;
+  EXPECT_EQ(5, CallerPtr(2, 3));
+
+  auto JITDump = readOutputFile("jit-");
+  ASSERT_TRUE(!!JITDump) << "No jitdump file was written";
+  EXPECT_EQ(1U, checkCodeLoads(JITDump->getBuffer(), "caller", Addr))
+      << "Function missing from jitdump";
+
+  // The JIT notifies the listener when it frees the object.
+  TheJIT.reset();
+}
+
+TEST_F(PerfJITEventListenerTest, ListenersShareFiles) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  std::unique_ptr<JITEventListener> Listener1(
+      JITEventListener::createPerfJITEventListener(Dir));
+  std::unique_ptr<JITEventListener> Listener2(
+      JITEventListener::createPerfJITEventListener(Dir));
+  if (!Listener1 || !Listener2)
+    return;
+
+  // Creating the second listener must not truncate what the first writes.
+  Function *F = insertAddFunction(M.get());
+  createJIT(std::move(M));
+  TheJIT->RegisterJITEventListener(Listener1.get());
+  TheJIT->RegisterJITEventListener(Listener2.get());
+  uint64_t Addr = TheJIT->getFunctionAddress(F->getName().str());
+  ASSERT_NE(0U, Addr) << "Unable to get pointer to function from JIT";
+
+  auto JITDump = readOutputFile("jit-");
+  ASSERT_TRUE(!!JITDump) << "No jitdump file was written";
+  EXPECT_EQ(2U, checkCodeLoads(JITDump->getBuffer(), "add", Addr));
+
+  // The files are closed along with the last listener that uses them.
+  TheJIT.reset();
+  Listener1.reset();
+  JITDump = readOutputFile("jit-");
+  ASSERT_TRUE(!!JITDump);
+  auto Records = readJITDumpRecords(JITDump->getBuffer());
+  ASSERT_FALSE(Records.empty());
+  EXPECT_NE(3U, Records.back().Type) << "Shared jitdump closed too early";
+
+  Listener2.reset();
+  JITDump = readOutputFile("jit-");
+  ASSERT_TRUE(!!JITDump);
+  StringRef Data = JITDump->getBuffer();
+  Records = readJITDumpRecords(Data);
+  ASSERT_FALSE(Records.empty());
+  EXPECT_EQ(3U, Records.back().Type) << "Missing JIT_CODE_CLOSE record";
+
+  // Both listeners wrote into one well-formed file with a single header.
+  size_t RecordBytes = 0;
+  for (auto &R : Records)
+    RecordBytes += 16 + R.Body.size();
+  EXPECT_EQ(Data.size(), 40U + RecordBytes);
+}
+
+} // end anonymous namespace
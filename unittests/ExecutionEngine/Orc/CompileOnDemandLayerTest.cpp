@@ -9,7 +9,12 @@
 
 #include "OrcTestCommon.h"
 #include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
+#include "llvm/ExecutionEngine/Orc/NullResolver.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/ThreadPool.h"
 #include "gtest/gtest.h"
+#include <condition_variable>
+#include <mutex>
 
 using namespace llvm;
 using namespace llvm::orc;
@@ -48,6 +53,70 @@ public:
   }
 };
 
+class FakeTrampolineCallbackManager : public orc::JITCompileCallbackManager {
+public:
+  FakeTrampolineCallbackManager() : JITCompileCallbackManager(0) {}
+
+  size_t getNumActiveCallbacks() const { return ActiveTrampolines.size(); }
+
+private:
+  void grow() override {
+    for (unsigned I = 0; I < 16; ++I)
+      AvailableTrampolines.push_back(NextTrampolineAddr++);
+  }
+
+  JITTargetAddress NextTrampolineAddr = 0x1000;
+};
+
+// Records the current value of each stub's implementation pointer.
+class RecordingStubsManager : public orc::IndirectStubsManager {
+public:
+  Error createStub(StringRef StubName, JITTargetAddress InitAddr,
+                   JITSymbolFlags Flags) override {
+    Pointers[StubName] = InitAddr;
+    return Error::success();
+  }
+
+  Error createStubs(const StubInitsMap &StubInits) override {
+    for (auto &Entry : StubInits)
+      Pointers[Entry.first()] = Entry.second.first;
+    return Error::success();
+  }
+
+  JITSymbol findStub(StringRef Name, bool ExportedStubsOnly) override {
+    if (!Pointers.count(Name))
+      return nullptr;
+    return JITSymbol(0x2000, JITSymbolFlags::Exported);
+  }
+
+  JITSymbol findPointer(StringRef Name) override { return nullptr; }
+
+  Error updatePointer(StringRef Name, JITTargetAddress NewAddr) override {
+    Pointers[Name] = NewAddr;
+    return Error::success();
+  }
+
+  Error removeStub(StringRef Name) override {
+    Pointers.erase(Name);
+    return Error::success();
+  }
+
+  StringMap<JITTargetAddress> Pointers;
+};
+
+// Hands out increasing module set handles.
+class CountingModuleSetAdder {
+public:
+  CountingModuleSetAdder(int &NextHandle) : NextHandle(NextHandle) {}
+
+  template <typename... Args> int operator()(Args &&...) {
+    return NextHandle++;
+  }
+
+private:
+  int &NextHandle;
+};
+
 TEST(CompileOnDemandLayerTest, FindSymbol) {
   auto MockBaseLayer = createMockBaseLayer<int>(
       DoNothingAndReturn<int>(0), DoNothingAndReturn<void>(),
@@ -70,4 +139,281 @@ TEST(CompileOnDemandLayerTest, FindSymbol) {
   EXPECT_TRUE(!!Sym) << "CompileOnDemand::findSymbol should call findSymbol in "
                         "the base layer.";
 }
+
+TEST(CompileOnDemandLayerTest, BackgroundCompile) {
+  LLVMContext Context;
+  ModuleBuilder MB(Context, "", "dummy");
+  for (const char *Name : {"foo", "bar"}) {
+    Function *F = MB.createFunctionDecl<void()>(Name);
+    IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+    Builder.CreateRetVoid();
+  }
+
+  int NextHandle = 0;
+  auto MockBaseLayer = createMockBaseLayer<int>(
+      CountingModuleSetAdder(NextHandle), DoNothingAndReturn<void>(),
+      DoNothingAndReturn<JITSymbol>(nullptr),
+      [](int H, const std::string &Name, bool) {
+        return JITSymbol(0x10000 + H, JITSymbolFlags::Exported);
+      });
+
+  typedef decltype(MockBaseLayer) MockBaseLayerT;
+  FakeTrampolineCallbackManager CallbackMgr;
+  RecordingStubsManager *StubsMgr = nullptr;
+  ThreadPool CompileThreads(1);
+
+  llvm::orc::CompileOnDemandLayer<MockBaseLayerT> COD(
+      MockBaseLayer, [](Function &F) { return std::set<Function *>{&F}; },
+      CallbackMgr,
+      [&StubsMgr]() {
+        auto SM = llvm::make_unique<RecordingStubsManager>();
+        StubsMgr = SM.get();
+        return SM;
+      },
+      false, &CompileThreads);
+
+  std::vector<std::unique_ptr<Module>> Ms;
+  Ms.push_back(MB.takeModule());
+  COD.addModuleSet(std::move(Ms), llvm::make_unique<SectionMemoryManager>(),
+                   llvm::make_unique<NullResolver>());
+  CompileThreads.wait();
+
+  ASSERT_TRUE(StubsMgr) << "Stubs manager was not created";
+  EXPECT_GE(StubsMgr->Pointers["foo"], 0x10000U)
+      << "Stub for foo was not switched to its compiled body";
+  EXPECT_GE(StubsMgr->Pointers["bar"], 0x10000U)
+      << "Stub for bar was not switched to its compiled body";
+  EXPECT_NE(StubsMgr->Pointers["foo"], StubsMgr->Pointers["bar"]);
+
+  auto Metrics = COD.getCompileMetrics();
+  EXPECT_EQ(Metrics.size(), 2U) << "Expected one metrics record per function";
+  for (auto &M : Metrics)
+    EXPECT_TRUE(M.CompiledInBackground) << M.Name << " compiled on demand";
+}
+
+#if LLVM_ENABLE_THREADS
+// Hands out increasing module set handles, waiting (for a bounded time) in
+// each call until another call is running too, and records the largest
+// number of calls seen running at once.
+class OverlapDetectingModuleSetAdder {
+public:
+  struct State {
+    std::mutex M;
+    std::condition_variable CV;
+    int NextHandle = 0;
+    unsigned Running = 0;
+    unsigned MaxRunning = 0;
+  };
+
+  OverlapDetectingModuleSetAdder(State &S) : S(S) {}
+
+  template <typename... Args> int operator()(Args &&...) {
+    std::unique_lock<std::mutex> Lock(S.M);
+    S.MaxRunning = std::max(S.MaxRunning, ++S.Running);
+    S.CV.notify_all();
+    S.CV.wait_for(Lock, std::chrono::seconds(10),
+                  [this]() { return S.MaxRunning > 1; });
+    --S.Running;
+    return S.NextHandle++;
+  }
+
+private:
+  State &S;
+};
+
+TEST(CompileOnDemandLayerTest, BackgroundCompilesRunInParallel) {
+  LLVMContext Context;
+  ModuleBuilder MB(Context, "", "dummy");
+  for (const char *Name : {"foo", "bar"}) {
+    Function *F = MB.createFunctionDecl<void()>(Name);
+    IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+    Builder.CreateRetVoid();
+  }
+
+  OverlapDetectingModuleSetAdder::State AdderState;
+  auto MockBaseLayer = createMockBaseLayer<int>(
+      OverlapDetectingModuleSetAdder(AdderState), DoNothingAndReturn<void>(),
+      DoNothingAndReturn<JITSymbol>(nullptr),
+      [](int H, const std::string &Name, bool) {
+        return JITSymbol(0x10000 + H, JITSymbolFlags::Exported);
+      });
+
+  typedef decltype(MockBaseLayer) MockBaseLayerT;
+  FakeTrampolineCallbackManager CallbackMgr;
+  ThreadPool CompileThreads(2);
+
+  llvm::orc::CompileOnDemandLayer<MockBaseLayerT> COD(
+      MockBaseLayer, [](Function &F) { return std::set<Function *>{&F}; },
+      CallbackMgr, [] { return llvm::make_unique<RecordingStubsManager>(); },
+      false, &CompileThreads);
+
+  std::vector<std::unique_ptr<Module>> Ms;
+  Ms.push_back(MB.takeModule());
+  COD.addModuleSet(std::move(Ms), llvm::make_unique<SectionMemoryManager>(),
+                   llvm::make_unique<NullResolver>());
+  CompileThreads.wait();
+
+  EXPECT_EQ(AdderState.MaxRunning, 2U)
+      << "Partitions were not compiled concurrently";
+  EXPECT_EQ(COD.getCompileMetrics().size(), 2U);
+}
+#endif
+
+TEST(CompileOnDemandLayerTest, RemoveModuleSetReleasesResources) {
+  LLVMContext Context;
+  auto MakeModule = [&]() {
+    ModuleBuilder MB(Context, "", "dummy");
+    for (const char *Name : {"foo", "bar"}) {
+      Function *F = MB.createFunctionDecl<void()>(Name);
+      IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+      Builder.CreateRetVoid();
+    }
+    std::vector<std::unique_ptr<Module>> Ms;
+    Ms.push_back(MB.takeModule());
+    return Ms;
+  };
+
+  int NextHandle = 0;
+  std::vector<int> RemovedHandles;
+  auto MockBaseLayer = createMockBaseLayer<int>(
+      CountingModuleSetAdder(NextHandle),
+      [&RemovedHandles](int H) { RemovedHandles.push_back(H); },
+      DoNothingAndReturn<JITSymbol>(nullptr),
+      [](int H, const std::string &Name, bool) {
+        return JITSymbol(0x10000 + H, JITSymbolFlags::Exported);
+      });
+
+  typedef decltype(MockBaseLayer) MockBaseLayerT;
+  FakeTrampolineCallbackManager CallbackMgr;
+  RecordingStubsManager *StubsMgr = nullptr;
+  unsigned NumStubsMgrs = 0;
+
+  llvm::orc::CompileOnDemandLayer<MockBaseLayerT> COD(
+      MockBaseLayer, [](Function &F) { return std::set<Function *>{&F}; },
+      CallbackMgr,
+      [&StubsMgr, &NumStubsMgrs]() {
+        auto SM = llvm::make_unique<RecordingStubsManager>();
+        StubsMgr = SM.get();
+        ++NumStubsMgrs;
+        return SM;
+      },
+      false);
+
+  auto H = COD.addModuleSet(MakeModule(),
+                            llvm::make_unique<SectionMemoryManager>(),
+                            llvm::make_unique<NullResolver>());
+  EXPECT_EQ(CallbackMgr.getNumActiveCallbacks(), 2U)
+      << "Expected one compile callback per function";
+
+  // Call foo through its trampoline; bar is never called.
+  JITTargetAddress FooTrampoline = StubsMgr->Pointers["foo"];
+  JITTargetAddress BarTrampoline = StubsMgr->Pointers["bar"];
+  EXPECT_GE(CallbackMgr.executeCompileCallback(FooTrampoline), 0x10000U)
+      << "Calling foo did not compile it";
+  EXPECT_EQ(CallbackMgr.getNumActiveCallbacks(), 1U);
+  EXPECT_EQ(NextHandle, 1) << "Expected one partition in the base layer";
+
+  COD.removeModuleSet(H);
+  EXPECT_EQ(CallbackMgr.getNumActiveCallbacks(), 0U)
+      << "Callback for bar was not released";
+  EXPECT_EQ(RemovedHandles, std::vector<int>{0})
+      << "Partition for foo was not removed from the base layer";
+  EXPECT_TRUE(StubsMgr->Pointers.empty()) << "Stubs were not removed";
+
+  // The trampolines and the stubs manager are recycled for the next module
+  // set.
+  COD.addModuleSet(MakeModule(), llvm::make_unique<SectionMemoryManager>(),
+                   llvm::make_unique<NullResolver>());
+  EXPECT_EQ(NumStubsMgrs, 1U) << "Stubs manager was not reused";
+  std::set<JITTargetAddress> Reused = {StubsMgr->Pointers["foo"],
+                                       StubsMgr->Pointers["bar"]};
+  EXPECT_EQ(Reused, (std::set<JITTargetAddress>{FooTrampoline, BarTrampoline}))
+      << "Released trampolines were not reused";
+}
+
+TEST(CompileOnDemandLayerTest, RedefineFunctions) {
+  LLVMContext Context;
+  auto MakeModule = [&](std::initializer_list<const char *> Names) {
+    ModuleBuilder MB(Context, "", "dummy");
+    for (const char *Name : Names) {
+      Function *F = MB.createFunctionDecl<void()>(Name);
+      IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+      Builder.CreateRetVoid();
+    }
+    return MB.takeModule();
+  };
+
+  int NextHandle = 0;
+  std::vector<int> RemovedHandles;
+  auto MockBaseLayer = createMockBaseLayer<int>(
+      CountingModuleSetAdder(NextHandle),
+      [&RemovedHandles](int H) { RemovedHandles.push_back(H); },
+      DoNothingAndReturn<JITSymbol>(nullptr),
+      [](int H, const std::string &Name, bool) {
+        return JITSymbol(0x10000 + H, JITSymbolFlags::Exported);
+      });
+
+  typedef decltype(MockBaseLayer) MockBaseLayerT;
+  FakeTrampolineCallbackManager CallbackMgr;
+  RecordingStubsManager *StubsMgr = nullptr;
+
+  llvm::orc::CompileOnDemandLayer<MockBaseLayerT> COD(
+      MockBaseLayer, [](Function &F) { return std::set<Function *>{&F}; },
+      CallbackMgr,
+      [&StubsMgr]() {
+        auto SM = llvm::make_unique<RecordingStubsManager>();
+        StubsMgr = SM.get();
+        return SM;
+      },
+      false);
+
+  std::vector<std::unique_ptr<Module>> Ms;
+  Ms.push_back(MakeModule({"foo", "bar"}));
+  auto H = COD.addModuleSet(std::move(Ms),
+                            llvm::make_unique<SectionMemoryManager>(),
+                            llvm::make_unique<NullResolver>());
+
+  // Compile foo by calling it, then replace it.
+  EXPECT_EQ(CallbackMgr.executeCompileCallback(StubsMgr->Pointers["foo"]),
+            0x10000U);
+  EXPECT_FALSE(!!COD.redefineFunctions(H, MakeModule({"foo"})));
+  EXPECT_EQ(NextHandle, 2) << "Expected only the new foo to be compiled";
+  EXPECT_EQ(StubsMgr->Pointers["foo"], 0x10001U)
+      << "Stub for foo does not point at its new body";
+  EXPECT_EQ(CallbackMgr.getNumActiveCallbacks(), 1U);
+
+  // Replacing bar before it was ever called releases its compile callback.
+  EXPECT_FALSE(!!COD.redefineFunctions(H, MakeModule({"bar"})));
+  EXPECT_EQ(StubsMgr->Pointers["bar"], 0x10002U)
+      << "Stub for bar does not point at its new body";
+  EXPECT_EQ(CallbackMgr.getNumActiveCallbacks(), 0U)
+      << "Callback for the old bar was not released";
+
+  // Functions that aren't in the module set can't be redefined.
+  auto Err = COD.redefineFunctions(H, MakeModule({"foo", "baz"}));
+  EXPECT_TRUE(!!Err) << "Redefining an unknown function should fail";
+  consumeError(std::move(Err));
+  EXPECT_EQ(NextHandle, 3) << "Failed redefinition was compiled";
+  EXPECT_EQ(StubsMgr->Pointers["foo"], 0x10001U)
+      << "Failed redefinition changed a stub";
+
+  // Redefinitions must be external functions, and nothing else.
+  auto Internal = MakeModule({"foo"});
+  Internal->getFunction("foo")->setLinkage(GlobalValue::InternalLinkage);
+  EXPECT_EQ(toString(COD.redefineFunctions(H, std::move(Internal))),
+            "Redefined function foo must have external linkage");
+  auto WithGlobal = MakeModule({"foo"});
+  new GlobalVariable(*WithGlobal, Type::getInt32Ty(Context), false,
+                     GlobalValue::ExternalLinkage,
+                     ConstantInt::get(Type::getInt32Ty(Context), 0), "g");
+  EXPECT_EQ(toString(COD.redefineFunctions(H, std::move(WithGlobal))),
+            "Redefinitions must only define functions");
+  EXPECT_EQ(NextHandle, 3) << "Rejected redefinition was compiled";
+  EXPECT_EQ(StubsMgr->Pointers["foo"], 0x10001U)
+      << "Rejected redefinition changed a stub";
+
+  COD.removeModuleSet(H);
+  EXPECT_EQ(RemovedHandles, (std::vector<int>{0, 1, 2}))
+      << "Redefinitions were not removed from the base layer";
+}
 }
@@ -10,6 +10,7 @@
 #include "OrcTestCommon.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/Support/Host.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -46,4 +47,30 @@ TEST(IndirectionUtilsTest, MakeStub) {
     << "makeStub should propagate byval attr on 2nd argument.";
 }
 
+TEST(IndirectionUtilsTest, RemoveStub) {
+  Triple TT(sys::getProcessTriple());
+  auto CreateStubsMgr = orc::createLocalIndirectStubsManagerBuilder(TT);
+  if (!CreateStubsMgr)
+    return;
+  auto StubsMgr = CreateStubsMgr();
+
+  EXPECT_FALSE(!!StubsMgr->createStub("foo", 0x1000, JITSymbolFlags::Exported));
+  auto FooStub = StubsMgr->findStub("foo", false);
+  ASSERT_TRUE(!!FooStub) << "Stub for foo was not created";
+  JITTargetAddress FooAddr = FooStub.getAddress();
+
+  EXPECT_FALSE(!!StubsMgr->removeStub("foo"));
+  EXPECT_FALSE(!!StubsMgr->findStub("foo", false))
+    << "Stub for foo was not removed";
+
+  EXPECT_FALSE(!!StubsMgr->createStub("bar", 0x2000, JITSymbolFlags::Exported));
+  auto BarStub = StubsMgr->findStub("bar", false);
+  ASSERT_TRUE(!!BarStub) << "Stub for bar was not created";
+  EXPECT_EQ(BarStub.getAddress(), FooAddr) << "Stub memory was not reused";
+
+  auto Err = StubsMgr->removeStub("foo");
+  EXPECT_TRUE(!!Err) << "Removed a stub that does not exist";
+  consumeError(std::move(Err));
+}
+
 }
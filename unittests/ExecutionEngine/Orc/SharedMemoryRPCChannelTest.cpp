@@ -0,0 +1,226 @@
+//===- SharedMemoryRPCChannelTest.cpp - Unit tests for shm RPC channels ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRPCChannel.h"
+#include "llvm/ExecutionEngine/Orc/RPCUtils.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#ifdef LLVM_ON_UNIX
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+using namespace llvm::orc;
+using namespace llvm::orc::remote;
+
+namespace {
+
+class SharedMemoryRPCChannelTest : public testing::Test,
+                                   public RPC<RPCByteChannel> {
+public:
+  enum FuncId : uint32_t {
+    IntIntId = RPCFunctionIdTraits<FuncId>::FirstValidId,
+    StringSizeId
+  };
+
+  typedef Function<IntIntId, int32_t(int32_t)> IntInt;
+  typedef Function<StringSizeId, uint64_t(std::string)> StringSize;
+
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createTemporaryFile("orc-rpc-test", "shm", FD, Path));
+  }
+
+  void TearDown() override {
+    sys::Process::SafelyCloseFileDescriptor(FD);
+    sys::fs::remove(Path);
+  }
+
+  // Create both ends of a channel in this process.
+  void createChannels(uint64_t RingSize) {
+    auto C = SharedMemoryRPCChannel::create(FD, RingSize);
+    ASSERT_TRUE(!!C) << "Could not create channel region";
+    Creator = std::move(*C);
+    auto A = SharedMemoryRPCChannel::attach(FD);
+    ASSERT_TRUE(!!A) << "Could not attach to channel region";
+    Attacher = std::move(*A);
+  }
+
+  int FD;
+  SmallString<64> Path;
+  std::unique_ptr<SharedMemoryRPCChannel> Creator, Attacher;
+};
+
+} // end anonymous namespace
+
+TEST_F(SharedMemoryRPCChannelTest, TestAttachRejectsUnknownRegion) {
+  ASSERT_FALSE(sys::fs::resize_file(FD, 1 << 16));
+  auto A = SharedMemoryRPCChannel::attach(FD);
+  EXPECT_FALSE(!!A) << "Attached to a file that was never initialized";
+  consumeError(A.takeError());
+
+  auto C = SharedMemoryRPCChannel::create(FD, 1000);
+  EXPECT_FALSE(!!C) << "Created a channel with a non power of two ring";
+  consumeError(C.takeError());
+}
+
+TEST_F(SharedMemoryRPCChannelTest, TestTransferLargerThanRing) {
+  createChannels(4096);
+
+  // Push several times the ring's capacity through it, in chunks that don't
+  // line up with the ring size.
+  std::vector<char> Data(100000);
+  for (unsigned I = 0; I != Data.size(); ++I)
+    Data[I] = static_cast<char>(I * 7 + I / 251);
+
+  std::thread Writer([&]() {
+    for (unsigned Pos = 0; Pos < Data.size(); Pos += 1000) {
+      unsigned Size = std::min<unsigned>(1000, Data.size() - Pos);
+      EXPECT_FALSE(!!Creator->appendBytes(&Data[Pos], Size));
+      EXPECT_FALSE(!!Creator->send());
+    }
+  });
+
+  std::vector<char> Received(Data.size());
+  for (unsigned Pos = 0; Pos < Received.size(); Pos += 777) {
+    unsigned Size = std::min<unsigned>(777, Received.size() - Pos);
+    EXPECT_FALSE(!!Attacher->readBytes(&Received[Pos], Size));
+  }
+  Writer.join();
+
+  EXPECT_EQ(Data, Received) << "Data corrupted in transfer";
+}
+
+TEST_F(SharedMemoryRPCChannelTest, TestReadAfterClose) {
+  createChannels(4096);
+
+  EXPECT_FALSE(!!Attacher->appendBytes("abc", 3));
+  // Destroying the writer publishes anything that was not yet sent.
+  Attacher.reset();
+
+  char Buf[3];
+  EXPECT_FALSE(!!Creator->readBytes(Buf, 3)) << "Could not drain channel";
+  EXPECT_EQ(StringRef(Buf, 3), "abc");
+
+  auto Err = Creator->readBytes(Buf, 1);
+  EXPECT_TRUE(!!Err) << "Read from closed channel succeeded";
+  consumeError(std::move(Err));
+}
+
+#ifdef LLVM_ON_UNIX
+TEST_F(SharedMemoryRPCChannelTest, TestPeerKilled) {
+  // The child holds the only write end of this pipe until it dies.
+  int Alive[2];
+  ASSERT_EQ(pipe(Alive), 0);
+  auto C = SharedMemoryRPCChannel::create(FD, 4096, Alive[0]);
+  ASSERT_TRUE(!!C) << "Could not create channel region";
+  Creator = std::move(*C);
+
+  pid_t Child = fork();
+  ASSERT_NE(Child, -1);
+  if (Child == 0) {
+    // Send a little data, then die without destroying the channel, so the
+    // region is never marked closed.
+    auto A = SharedMemoryRPCChannel::attach(FD);
+    if (!A) {
+      consumeError(A.takeError());
+      _exit(1);
+    }
+    consumeError((*A)->appendBytes("abc", 3));
+    consumeError((*A)->send());
+    raise(SIGKILL);
+    _exit(1);
+  }
+  close(Alive[1]);
+
+  char Buf[3];
+  EXPECT_FALSE(!!Creator->readBytes(Buf, 3)) << "Could not drain channel";
+  EXPECT_EQ(StringRef(Buf, 3), "abc");
+
+  auto Err = Creator->readBytes(Buf, 1);
+  EXPECT_TRUE(!!Err) << "Read from a dead peer succeeded";
+  consumeError(std::move(Err));
+
+  // Nobody drains the ring any more, so a write that overflows it must fail
+  // rather than wait.
+  std::vector<char> Data(3 * 4096);
+  Err = Creator->appendBytes(Data.data(), Data.size());
+  EXPECT_TRUE(!!Err) << "Write to a dead peer succeeded";
+  consumeError(std::move(Err));
+
+  int Status;
+  ASSERT_EQ(waitpid(Child, &Status, 0), Child);
+  EXPECT_TRUE(WIFSIGNALED(Status)) << "Child did not get killed";
+}
+#endif
+
+TEST_F(SharedMemoryRPCChannelTest, TestAsyncIntInt) {
+  createChannels(4096);
+
+  // Make an async call.
+  auto ResOrErr = callNBWithSeq<IntInt>(*Creator, 21);
+  EXPECT_TRUE(!!ResOrErr) << "Simple call over channel failed";
+
+  {
+    // Expect a call to IntInt.
+    auto EC = expect<IntInt>(*Attacher, [&](int32_t I) -> Expected<int32_t> {
+      EXPECT_EQ(I, 21) << "Int serialization broken";
+      return 2 * I;
+    });
+    EXPECT_FALSE(EC) << "Simple expect over channel failed";
+  }
+
+  {
+    // Wait for the result.
+    auto EC = waitForResult(*Creator, ResOrErr->second, handleNone);
+    EXPECT_FALSE(EC) << "Could not read result.";
+  }
+
+  // Verify that the function returned ok.
+  auto Val = ResOrErr->first.get();
+  EXPECT_TRUE(!!Val) << "Remote int function failed to execute.";
+  EXPECT_EQ(*Val, 42) << "Remote int function return wrong value.";
+}
+
+TEST_F(SharedMemoryRPCChannelTest, TestCallLargerThanRing) {
+  createChannels(1024);
+
+  // The argument doesn't fit in the ring, so the call can only complete if
+  // the server drains it concurrently.
+  std::string Arg(10000, 'x');
+  std::thread Server([&]() {
+    auto EC = expect<StringSize>(
+        *Attacher, [&](std::string S) -> Expected<uint64_t> {
+          EXPECT_EQ(S, Arg) << "String serialization broken";
+          return S.size();
+        });
+    EXPECT_FALSE(EC) << "Large expect over channel failed";
+  });
+
+  auto ResOrErr = callNBWithSeq<StringSize>(*Creator, Arg);
+  EXPECT_TRUE(!!ResOrErr) << "Large call over channel failed";
+  Server.join();
+
+  {
+    auto EC = waitForResult(*Creator, ResOrErr->second, handleNone);
+    EXPECT_FALSE(EC) << "Could not read result.";
+  }
+
+  auto Val = ResOrErr->first.get();
+  EXPECT_TRUE(!!Val) << "Remote function failed to execute.";
+  EXPECT_EQ(*Val, Arg.size()) << "Remote function returned wrong value.";
+}
@@ -0,0 +1,98 @@
+//===----- TieredCompilationTest.cpp - Unit tests for tier-up support -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/Orc/TieredCompilation.h"
+#include "llvm/IR/InstIterator.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+// Count the atomic loads in F, which is how counter increments are emitted.
+unsigned countCounterLoads(Function &F) {
+  unsigned NumLoads = 0;
+  for (auto &I : instructions(F))
+    if (auto *LI = dyn_cast<LoadInst>(&I))
+      if (LI->isAtomic())
+        ++NumLoads;
+  return NumLoads;
+}
+
+// Build "void loop(i32 %n)" containing a single counted loop.
+std::unique_ptr<Module> createLoopModule(LLVMContext &Context) {
+  ModuleBuilder MB(Context, "", "loop");
+  Function *F = MB.createFunctionDecl<void(int32_t)>("loop");
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  BasicBlock *Loop = BasicBlock::Create(Context, "loop", F);
+  BasicBlock *Exit = BasicBlock::Create(Context, "exit", F);
+
+  IRBuilder<> Builder(Entry);
+  Builder.CreateBr(Loop);
+
+  Builder.SetInsertPoint(Loop);
+  PHINode *I = Builder.CreatePHI(Builder.getInt32Ty(), 2);
+  Value *INext = Builder.CreateAdd(I, Builder.getInt32(1));
+  I->addIncoming(Builder.getInt32(0), Entry);
+  I->addIncoming(INext, Loop);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(INext, &*F->arg_begin()), Exit,
+                       Loop);
+
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRetVoid();
+  return MB.takeModule();
+}
+
+TEST(TieredCompilationTest, InstrumentEntryAndBackedges) {
+  LLVMContext Context;
+  TierUpProfiler Profiler(1000);
+
+  auto M = Profiler.instrument(createLoopModule(Context));
+  Function *F = M->getFunction("loop");
+  EXPECT_EQ(countCounterLoads(*F), 2U)
+      << "Expected one counter at entry and one at the loop header";
+  EXPECT_TRUE(Profiler.takeHotModules().empty())
+      << "Uncalled function should not be hot";
+}
+
+TEST(TieredCompilationTest, IgnoreModulesWithoutBodies) {
+  LLVMContext Context;
+  ModuleBuilder MB(Context, "", "decls");
+  MB.createFunctionDecl<void()>("external");
+
+  TierUpProfiler Profiler(0);
+  Profiler.instrument(MB.takeModule());
+  EXPECT_TRUE(Profiler.takeHotModules().empty())
+      << "Declaration-only module should not be profiled";
+}
+
+TEST(TieredCompilationTest, HotModuleSnapshot) {
+  LLVMContext Context;
+  // With a zero threshold everything is hot as soon as it is instrumented.
+  TierUpProfiler Profiler(0);
+  Profiler.instrument(createLoopModule(Context));
+
+  auto Hot = Profiler.takeHotModules();
+  ASSERT_EQ(Hot.size(), 1U);
+  ASSERT_EQ(Hot[0].FunctionNames.size(), 1U);
+  EXPECT_EQ(Hot[0].FunctionNames[0], "loop");
+  EXPECT_TRUE(Profiler.takeHotModules().empty())
+      << "Hot modules should only be handed out once";
+
+  LLVMContext OptContext;
+  auto M = TierUpProfiler::loadHotModule(Hot[0], OptContext);
+  ASSERT_TRUE(!!M) << "Failed to load saved bitcode";
+  Function *F = (*M)->getFunction("loop");
+  ASSERT_TRUE(F && !F->isDeclaration());
+  EXPECT_EQ(countCounterLoads(*F), 0U)
+      << "Saved IR should not contain counters";
+}
+}
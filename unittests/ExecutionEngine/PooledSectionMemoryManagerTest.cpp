@@ -0,0 +1,180 @@
+//===- PooledSectionMemoryManagerTest.cpp - Pooled memory manager tests ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledSectionMemoryManager.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(PooledSectionMemoryManagerTest, BasicAllocations) {
+  SectionMemoryPool Pool;
+  std::unique_ptr<PooledSectionMemoryManager> MemMgr(
+      new PooledSectionMemoryManager(Pool));
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", true);
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 64, 3, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 4, "", false);
+
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, code2);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  EXPECT_NE((uint8_t*)nullptr, data2);
+  EXPECT_EQ(0U, (uintptr_t)code2 % 64);
+
+  // Initialize the data
+  for (unsigned i = 0; i < 256; ++i) {
+    code1[i] = 1;
+    code2[i] = 2;
+    data1[i] = 3;
+    data2[i] = 4;
+  }
+
+  // Verify the data (this is checking for overlaps in the addresses)
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(2, code2[i]);
+    EXPECT_EQ(3, data1[i]);
+    EXPECT_EQ(4, data2[i]);
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  // One slab per permission class, aligned for huge pages.
+  EXPECT_EQ(3U, Pool.getNumSlabs());
+  EXPECT_EQ(0U, (uintptr_t)code1 % SectionMemoryPool::HugePageSize);
+}
+
+TEST(PooledSectionMemoryManagerTest, PermissionClassesDontShareHugePages) {
+  const size_t HugePageSize = SectionMemoryPool::HugePageSize;
+  SectionMemoryPool Pool;
+  PooledSectionMemoryManager MemMgr1(Pool);
+  PooledSectionMemoryManager MemMgr2(Pool);
+
+  uint8_t *Code[] = {MemMgr1.allocateCodeSection(256, 0, 1, ""),
+                     MemMgr2.allocateCodeSection(256, 0, 1, "")};
+  uint8_t *ROData[] = {MemMgr1.allocateDataSection(256, 0, 2, "", true),
+                       MemMgr2.allocateDataSection(256, 0, 2, "", true)};
+  uint8_t *RWData[] = {MemMgr1.allocateDataSection(256, 0, 3, "", false),
+                       MemMgr2.allocateDataSection(256, 0, 3, "", false)};
+
+  // Blocks of the same class are packed into the same huge page, and blocks
+  // of different classes never are.
+  for (uint8_t **Class : {Code, ROData, RWData})
+    EXPECT_EQ((uintptr_t)Class[0] / HugePageSize,
+              (uintptr_t)Class[1] / HugePageSize);
+  EXPECT_NE((uintptr_t)Code[0] / HugePageSize,
+            (uintptr_t)ROData[0] / HugePageSize);
+  EXPECT_NE((uintptr_t)Code[0] / HugePageSize,
+            (uintptr_t)RWData[0] / HugePageSize);
+  EXPECT_NE((uintptr_t)ROData[0] / HugePageSize,
+            (uintptr_t)RWData[0] / HugePageSize);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr1.finalizeMemory(&Error));
+  EXPECT_FALSE(MemMgr2.finalizeMemory(&Error));
+}
+
+TEST(PooledSectionMemoryManagerTest, SharedPool) {
+  SectionMemoryPool Pool;
+  PooledSectionMemoryManager MemMgr1(Pool);
+  PooledSectionMemoryManager MemMgr2(Pool);
+
+  uint8_t *code1 = MemMgr1.allocateCodeSection(0x1000, 0, 1, "");
+  uint8_t *code2 = MemMgr2.allocateCodeSection(0x1000, 0, 1, "");
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, code2);
+
+  // Each memory manager gets its own block from the same slab.
+  EXPECT_EQ(1U, Pool.getNumSlabs());
+  uintptr_t Distance = code1 < code2 ? code2 - code1 : code1 - code2;
+  EXPECT_LE(PooledSectionMemoryManager::MinBlockSize, Distance);
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr1.finalizeMemory(&Error));
+  EXPECT_FALSE(MemMgr2.finalizeMemory(&Error));
+}
+
+TEST(PooledSectionMemoryManagerTest, FinalizeMovesToFreshPage) {
+  static const size_t PageSize = sys::Process::getPageSize();
+  SectionMemoryPool Pool;
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  uint8_t *code1 = MemMgr.allocateCodeSection(100, 0, 1, "");
+  uint8_t *data1 = MemMgr.allocateDataSection(100, 0, 2, "", true);
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+
+  // Sections allocated after finalization must not share a page with
+  // finalized ones, and must be writable.
+  uint8_t *code2 = MemMgr.allocateCodeSection(100, 0, 3, "");
+  uint8_t *data2 = MemMgr.allocateDataSection(100, 0, 4, "", true);
+  EXPECT_NE((uintptr_t)code1 / PageSize, (uintptr_t)code2 / PageSize);
+  EXPECT_NE((uintptr_t)data1 / PageSize, (uintptr_t)data2 / PageSize);
+  for (unsigned i = 0; i < 100; ++i) {
+    code2[i] = 1;
+    data2[i] = 2;
+  }
+
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+}
+
+TEST(PooledSectionMemoryManagerTest, RecycleOnDestruction) {
+  SectionMemoryPool Pool;
+
+  {
+    PooledSectionMemoryManager MemMgr(Pool);
+    uint8_t *code = MemMgr.allocateCodeSection(0x10000, 0, 1, "");
+    EXPECT_NE((uint8_t*)nullptr, code);
+    std::string Error;
+    EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  }
+  // Freed blocks are coalesced, so all of the slab is free again.
+  size_t FreeBytes = Pool.getNumFreeBytes();
+  EXPECT_EQ(16 * SectionMemoryPool::HugePageSize, FreeBytes);
+
+  {
+    PooledSectionMemoryManager MemMgr(Pool);
+    uint8_t *code = MemMgr.allocateCodeSection(0x10000, 0, 1, "");
+    EXPECT_NE((uint8_t*)nullptr, code);
+    // Recycled code memory is writable again.
+    for (unsigned i = 0; i < 0x10000; ++i)
+      code[i] = 1;
+    std::string Error;
+    EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  }
+
+  EXPECT_EQ(1U, Pool.getNumSlabs());
+  EXPECT_EQ(FreeBytes, Pool.getNumFreeBytes());
+}
+
+TEST(PooledSectionMemoryManagerTest, LargeAllocations) {
+  SectionMemoryPool Pool(SectionMemoryPool::HugePageSize);
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  uint8_t *data1 = MemMgr.allocateDataSection(0x100000, 0, 1, "", false);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  EXPECT_EQ(1U, Pool.getNumSlabs());
+
+  // Sections larger than the free space get a new slab, sized to fit.
+  uint8_t *code1 = MemMgr.allocateCodeSection(0x300000, 0, 2, "");
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_EQ(2U, Pool.getNumSlabs());
+  code1[0x2fffff] = 1;
+  data1[0xfffff] = 2;
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+}
+
+} // end anonymous namespace
@@ -347,6 +347,19 @@ TEST_P(MappedMemoryTest, UnalignedNear) {
   EXPECT_FALSE(Memory::releaseMappedMemory(M1));
 }
 
+TEST_P(MappedMemoryTest, AdviseHugePages) {
+  std::error_code EC;
+  MemoryBlock M1 = Memory::allocateMappedMemory(4 * PageSize, nullptr, Flags,
+                                                EC);
+  EXPECT_EQ(std::error_code(), EC);
+
+  // The hint is advisory, so it should succeed whether or not large pages
+  // are available.
+  EXPECT_FALSE(Memory::adviseHugePages(M1));
+
+  EXPECT_FALSE(Memory::releaseMappedMemory(M1));
+}
+
 // Note that Memory::MF_WRITE is not supported exclusively across
 // operating systems and architectures and can imply MF_READ|MF_WRITE
 unsigned MemoryFlags[] = {